@@ -69,17 +69,24 @@ outdir := ./../../../build/$(releasetype)-$(toolchain)-$(platform)/
 objdir := $(outdir)obj/$(project)/
 objects := \
 $(addprefix $(objdir), \
+allpairs.obj \
 arbor.obj \
 avisimpl.obj \
 barnhut.obj \
+bhutpool.obj \
 bhutquad.obj \
 dllmain.obj \
+flattree.obj \
 graph.obj \
 graphwnd.obj \
+hierarchy.obj \
 miscutil.obj \
 newdel.obj \
+physics.obj \
+springs.obj \
 stladdon.obj \
 strgutil.obj \
+thrdpool.obj \
 vector.obj \
 wi.obj)
 resources := $(addprefix $(objdir), $(project).res)
@@ -368,16 +375,45 @@ $(objdir)%.res: %.rc
 	$(rc) $(rcflags) -Fo$@ $<
 
 # Names of include files can be duplicated, therefore I have to use full paths.
+$(objdir)allpairs.obj: \
+$(srcdir)barnhut/allpairs.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/vector.h \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/barnhut.h \
+$(srcdir)ns/miscutil.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/sse.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
 $(objdir)arbor.obj: \
+$(srcdir)barnhut/allpairs.h \
+$(srcdir)barnhut/barnhut.h \
+$(srcdir)barnhut/bhutpool.h \
+$(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)barnhut/flattree.h \
 $(srcdir)dlllayer/arbor.h \
 $(srcdir)dlllayer/arborvis.h \
 $(srcdir)graph/edge.h \
 $(srcdir)graph/graph.h \
+$(srcdir)graph/hierarchy.h \
+$(srcdir)graph/params.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/random.h \
+$(srcdir)graph/snapshot.h \
+$(srcdir)graph/springs.h \
 $(srcdir)graph/vector.h \
 $(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/atladd.h \
+$(srcdir)ns/barnhut.h \
 $(srcdir)ns/dxu.h \
+$(srcdir)ns/miscutil.h \
 $(srcdir)ns/stladd.h \
 $(srcdir)ns/wapi.h \
 $(srcdir)sdkver.h \
@@ -386,6 +422,7 @@ $(srcdir)service/com/impl.h \
 $(srcdir)service/functype.h \
 $(srcdir)service/sse.h \
 $(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
 $(srcdir)service/winapi/chkerror.h \
 $(srcdir)service/winapi/directx/dx.h \
 $(srcdir)service/winapi/heap.h \
@@ -399,14 +436,28 @@ $(srcdir)ui/window/child/onscreen/graphwnd.h \
 $(srcdir)ui/window/wi.h
 
 $(objdir)avisimpl.obj: \
+$(srcdir)barnhut/allpairs.h \
+$(srcdir)barnhut/barnhut.h \
+$(srcdir)barnhut/bhutpool.h \
+$(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)barnhut/flattree.h \
 $(srcdir)dlllayer/arborvis.h \
 $(srcdir)graph/edge.h \
 $(srcdir)graph/graph.h \
+$(srcdir)graph/hierarchy.h \
+$(srcdir)graph/params.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/random.h \
+$(srcdir)graph/snapshot.h \
+$(srcdir)graph/springs.h \
 $(srcdir)graph/vector.h \
 $(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/atladd.h \
+$(srcdir)ns/barnhut.h \
 $(srcdir)ns/dxu.h \
+$(srcdir)ns/miscutil.h \
 $(srcdir)ns/stladd.h \
 $(srcdir)ns/wapi.h \
 $(srcdir)sdkver.h \
@@ -415,6 +466,7 @@ $(srcdir)service/com/impl.h \
 $(srcdir)service/functype.h \
 $(srcdir)service/sse.h \
 $(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
 $(srcdir)service/winapi/chkerror.h \
 $(srcdir)service/winapi/directx/dx.h \
 $(srcdir)service/winapi/heap.h \
@@ -429,9 +481,11 @@ $(srcdir)ui/window/wi.h
 
 $(objdir)barnhut.obj: \
 $(srcdir)barnhut/barnhut.h \
+$(srcdir)barnhut/bhutpool.h \
 $(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)graph/physics.h \
 $(srcdir)graph/vector.h \
-$(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/barnhut.h \
 $(srcdir)ns/stladd.h \
@@ -441,10 +495,22 @@ $(srcdir)service/stladdon.h \
 $(srcdir)service/winapi/heap.h \
 $(srcdir)service/winapi/uh.h
 
+$(objdir)bhutpool.obj: \
+$(srcdir)barnhut/bhutpool.h \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/barnhut.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
 $(objdir)bhutquad.obj: \
+$(srcdir)barnhut/bhutpool.h \
 $(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)graph/physics.h \
 $(srcdir)graph/vector.h \
-$(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/barnhut.h \
 $(srcdir)ns/stladd.h \
@@ -456,39 +522,82 @@ $(srcdir)service/winapi/uh.h
 
 $(objdir)dllmain.obj: $(srcdir)sdkver.h
 
+$(objdir)flattree.obj: \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)barnhut/flattree.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/vector.h \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/barnhut.h \
+$(srcdir)ns/miscutil.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/sse.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
 $(objdir)graph.obj: \
+$(srcdir)barnhut/allpairs.h \
 $(srcdir)barnhut/barnhut.h \
+$(srcdir)barnhut/bhutpool.h \
 $(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)barnhut/flattree.h \
 $(srcdir)graph/edge.h \
 $(srcdir)graph/graph.h \
+$(srcdir)graph/hierarchy.h \
+$(srcdir)graph/params.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/random.h \
+$(srcdir)graph/snapshot.h \
+$(srcdir)graph/springs.h \
 $(srcdir)graph/vector.h \
 $(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/barnhut.h \
+$(srcdir)ns/miscutil.h \
 $(srcdir)ns/stladd.h \
 $(srcdir)ns/wapi.h \
 $(srcdir)service/functype.h \
 $(srcdir)service/sse.h \
 $(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
+$(srcdir)service/winapi/file.h \
 $(srcdir)service/winapi/heap.h \
 $(srcdir)service/winapi/srwlock.h \
 $(srcdir)service/winapi/uh.h
 
 $(objdir)graphwnd.obj: \
+$(srcdir)barnhut/allpairs.h \
+$(srcdir)barnhut/barnhut.h \
+$(srcdir)barnhut/bhutpool.h \
+$(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)barnhut/flattree.h \
 $(srcdir)graph/edge.h \
 $(srcdir)graph/graph.h \
+$(srcdir)graph/hierarchy.h \
+$(srcdir)graph/params.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/random.h \
+$(srcdir)graph/snapshot.h \
+$(srcdir)graph/springs.h \
 $(srcdir)graph/vector.h \
 $(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/atladd.h \
+$(srcdir)ns/barnhut.h \
 $(srcdir)ns/dxu.h \
+$(srcdir)ns/miscutil.h \
 $(srcdir)ns/stladd.h \
 $(srcdir)ns/wapi.h \
 $(srcdir)service/com/comptr.h \
-$(srcdir)service/com/comptr.h \
 $(srcdir)service/functype.h \
 $(srcdir)service/sse.h \
 $(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
 $(srcdir)service/winapi/chkerror.h \
 $(srcdir)service/winapi/directx/dx.h \
 $(srcdir)service/winapi/heap.h \
@@ -500,6 +609,22 @@ $(srcdir)ui/window/child/cwi.h \
 $(srcdir)ui/window/child/onscreen/graphwnd.h \
 $(srcdir)ui/window/wi.h
 
+$(objdir)hierarchy.obj: \
+$(srcdir)graph/hierarchy.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/random.h \
+$(srcdir)graph/springs.h \
+$(srcdir)graph/vector.h \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/miscutil.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/sse.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
 $(objdir)miscutil.obj: \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/miscutil.h \
@@ -519,6 +644,30 @@ $(srcdir)service/stladdon.h \
 $(srcdir)service/winapi/heap.h \
 $(srcdir)service/winapi/uh.h
 
+$(objdir)physics.obj: \
+$(srcdir)graph/physics.h \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/sse.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
+$(objdir)springs.obj: \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/springs.h \
+$(srcdir)graph/vector.h \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/miscutil.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/sse.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
 $(objdir)stladdon.obj: \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/stladd.h \
@@ -539,19 +688,44 @@ $(srcdir)service/strgutil.h \
 $(srcdir)service/winapi/heap.h \
 $(srcdir)service/winapi/uh.h
 
+$(objdir)thrdpool.obj: \
+$(srcdir)ns/arbor.h \
+$(srcdir)ns/miscutil.h \
+$(srcdir)ns/stladd.h \
+$(srcdir)ns/wapi.h \
+$(srcdir)service/stladdon.h \
+$(srcdir)service/thrdpool.h \
+$(srcdir)service/winapi/heap.h \
+$(srcdir)service/winapi/uh.h
+
 $(objdir)vector.obj: \
+$(srcdir)graph/random.h \
 $(srcdir)graph/vector.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)service/sse.h
 
 $(objdir)wi.obj: \
+$(srcdir)barnhut/allpairs.h \
+$(srcdir)barnhut/barnhut.h \
+$(srcdir)barnhut/bhutpool.h \
+$(srcdir)barnhut/bhutquad.h \
+$(srcdir)barnhut/bhutstack.h \
+$(srcdir)barnhut/flattree.h \
 $(srcdir)graph/edge.h \
 $(srcdir)graph/graph.h \
+$(srcdir)graph/hierarchy.h \
+$(srcdir)graph/params.h \
+$(srcdir)graph/physics.h \
+$(srcdir)graph/random.h \
+$(srcdir)graph/snapshot.h \
+$(srcdir)graph/springs.h \
 $(srcdir)graph/vector.h \
 $(srcdir)graph/vertex.h \
 $(srcdir)ns/arbor.h \
 $(srcdir)ns/atladd.h \
+$(srcdir)ns/barnhut.h \
 $(srcdir)ns/dxu.h \
+$(srcdir)ns/miscutil.h \
 $(srcdir)ns/stladd.h \
 $(srcdir)ns/wapi.h \
 $(srcdir)service/com/comptr.h \
@@ -559,6 +733,7 @@ $(srcdir)service/functype.h \
 $(srcdir)service/sse.h \
 $(srcdir)service/stladdon.h \
 $(srcdir)service/strgutil.h \
+$(srcdir)service/thrdpool.h \
 $(srcdir)service/winapi/chkerror.h \
 $(srcdir)service/winapi/directx/dx.h \
 $(srcdir)service/winapi/heap.h \
@@ -353,7 +353,8 @@ $(objdir)dtsample.obj: \
 $(arborsrcdir)dlllayer/arbor.h \
 $(arborsrcdir)dlllayer/arborvis.h \
 $(arborsrcdir)graph/edge.h \
-$(arborsrcdir)graph/vector.h \
+$(arborsrcdir)graph/params.h \
+$(arborsrcdir)graph/physics.h \
 $(arborsrcdir)graph/vertex.h \
 $(arborsrcdir)ns/arbor.h \
 $(arborsrcdir)ns/stladd.h \
@@ -390,7 +391,8 @@ $(objdir)dtsmpwnd.obj: \
 $(arborsrcdir)dlllayer/arbor.h \
 $(arborsrcdir)dlllayer/arborvis.h \
 $(arborsrcdir)graph/edge.h \
-$(arborsrcdir)graph/vector.h \
+$(arborsrcdir)graph/params.h \
+$(arborsrcdir)graph/physics.h \
 $(arborsrcdir)graph/vertex.h \
 $(arborsrcdir)ns/arbor.h \
 $(arborsrcdir)ns/stladd.h \
@@ -4,6 +4,7 @@ msvc := msvc
 # Projects
 arborgvt := arborgvt
 dtsample := dtsample
+arborbench := arborbench
 # Platforms
 x86-64 := x86-64
 x86 := x86
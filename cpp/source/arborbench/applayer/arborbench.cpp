@@ -0,0 +1,87 @@
+﻿#include "bench/convergence.h"
+#include "bench/frames.h"
+#include "bench/integrate.h"
+#include "bench/multilevel.h"
+#include "bench/repulsion.h"
+#include "bench/wake.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+
+/**
+ * Runs a benchmark of the graph physics, without any window: the graphs are laid out by the `graph::layout` method.
+ *
+ * Command line:
+ * arborbench frames [frames number]
+ * Time of a simulation step with each repulsion engine (see `BENCH frame_benchmark`), 50 frames by default.
+ *
+ * arborbench repulsion
+ * Error of repulsion forces of each engine against the exact forces (see `BENCH repulsion_benchmark`).
+ *
+ * arborbench integrate [steps number]
+ * Time of the integration of a step, vectorized and vertex by vertex (see `BENCH integrate_benchmark`), 20 steps by
+ * default.
+ *
+ * arborbench convergence
+ * Steps, time and energy of a layout to convergence by each integrator (see `BENCH convergence_benchmark`).
+ *
+ * arborbench multilevel
+ * Steps, time and energy of a layout to convergence by each layout method (see `BENCH multilevel_benchmark`).
+ *
+ * arborbench wake
+ * Check that an edge added to a settled graph wakes up only the vertices next to it (see `BENCH wake_check`).
+ *
+ * Returns:
+ * `EXIT_SUCCESS`, or `EXIT_FAILURE` if the command line is wrong or the check fails.
+ */
+int wmain(_In_ int argc, _In_reads_(argc) wchar_t* argv[])
+{
+    int result = EXIT_SUCCESS;
+    if ((1 < argc) && !wcscmp(argv[1], L"frames"))
+    {
+        uint32_t framesNumber = (2 < argc) ? static_cast<uint32_t> (wcstoul(argv[2], nullptr, 10)) : 50;
+        BENCH frame_benchmark benchmark {framesNumber};
+        benchmark.run();
+    }
+    else if ((1 < argc) && !wcscmp(argv[1], L"repulsion"))
+    {
+        BENCH repulsion_benchmark benchmark {};
+        benchmark.run();
+    }
+    else if ((1 < argc) && !wcscmp(argv[1], L"integrate"))
+    {
+        uint32_t stepsNumber = (2 < argc) ? static_cast<uint32_t> (wcstoul(argv[2], nullptr, 10)) : 20;
+        BENCH integrate_benchmark benchmark {stepsNumber};
+        benchmark.run();
+    }
+    else if ((1 < argc) && !wcscmp(argv[1], L"convergence"))
+    {
+        BENCH convergence_benchmark benchmark {};
+        benchmark.run();
+    }
+    else if ((1 < argc) && !wcscmp(argv[1], L"multilevel"))
+    {
+        BENCH multilevel_benchmark benchmark {};
+        benchmark.run();
+    }
+    else if ((1 < argc) && !wcscmp(argv[1], L"wake"))
+    {
+        BENCH wake_check check {};
+        result = check.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else
+    {
+        std::fputs(
+            "Usage:\n"
+            "arborbench frames [frames number]\n"
+            "arborbench repulsion\n"
+            "arborbench integrate [steps number]\n"
+            "arborbench convergence\n"
+            "arborbench multilevel\n"
+            "arborbench wake\n",
+            stderr);
+        result = EXIT_FAILURE;
+    }
+    return result;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "bench/corpus.h"
+#include "graph/graph.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include <cstdint>
+
+BENCH_BEGIN
+
+/**
+ * `convergence_benchmark` class compares the integrators (see `ARBOR simulation_parameters::integrator`): number of
+ * steps, time and energy of a layout to convergence, on trees, grids and clusters of 400, 1000 and 2000 vertices.
+ *
+ * Remarks:
+ * Each integrator lays out its own copy of a graph, from the same initial layout and with the default parameters
+ * otherwise, by a `graph::layout` call with the default limits: the layout stops where the simulation would stop by the
+ * `autoStop` parameter. The energy is the exact energy of the final layout (see `graph_corpus::getEnergy`), so a
+ * faster integrator can be checked to reach as good a layout.
+ */
+class convergence_benchmark
+{
+public:
+    convergence_benchmark() = default;
+    convergence_benchmark(_In_ const convergence_benchmark&) = delete;
+    convergence_benchmark& operator =(_In_ const convergence_benchmark&) = delete;
+
+    void run() const;
+
+
+private:
+    void measure(_In_ const graph_corpus& corpus, _In_ const ARBOR integration_method integrator) const;
+};
+
+BENCH_END
@@ -0,0 +1,224 @@
+﻿#include "bench/corpus.h"
+#include <algorithm>
+#include <cmath>
+#include <tchar.h>
+
+BENCH_BEGIN
+
+/**
+ * Generates a graph.
+ *
+ * Parameters:
+ * >kind
+ * Shape of the graph.
+ * >size
+ * Wanted number of vertices. A grid has the greatest square number of vertices not above it, clusters have the
+ * greatest multiple of `m_clustersNumber`.
+ *
+ * Returns:
+ * N/A.
+ */
+graph_corpus::graph_corpus(_In_ const graph_kind kind, _In_ const size_t size)
+    :
+    m_edges {},
+    m_verticesNumber {0},
+    m_kind {kind},
+    m_random {m_seed}
+{
+    uint32_t verticesNumber = static_cast<uint32_t> (size);
+    switch (kind)
+    {
+        case TreeGraph:
+        {
+            addTree(0, verticesNumber);
+        }
+        break;
+
+        case GridGraph:
+        {
+            uint32_t width = static_cast<uint32_t> (std::sqrt(static_cast<double> (size)));
+            verticesNumber = width * width;
+            for (uint32_t i = 0; verticesNumber > i; ++i)
+            {
+                if (i % width)
+                {
+                    m_edges.emplace_back(i - 1, i);
+                }
+                if (width <= i)
+                {
+                    m_edges.emplace_back(i - width, i);
+                }
+            }
+        }
+        break;
+
+        case ClusterGraph:
+        {
+            uint32_t clusterSize = verticesNumber / m_clustersNumber;
+            verticesNumber = clusterSize * m_clustersNumber;
+            for (uint32_t i = 0; clusterSize && (m_clustersNumber > i); ++i)
+            {
+                addTree(i * clusterSize, clusterSize);
+                m_edges.emplace_back(i * clusterSize, ((i + 1) % m_clustersNumber) * clusterSize);
+            }
+        }
+        break;
+
+        default:
+        {
+            addTree(0, verticesNumber);
+            for (uint32_t i = verticesNumber / 2; 0 < i; --i)
+            {
+                uint32_t tail = getRandom(verticesNumber);
+                uint32_t head = getRandom(verticesNumber);
+                if (tail != head)
+                {
+                    m_edges.emplace_back(tail, head);
+                }
+            }
+        }
+        break;
+    }
+    m_verticesNumber = verticesNumber;
+}
+
+
+/**
+ * Adds the generated vertices and edges to a graph.
+ *
+ * Parameters:
+ * >target
+ * An empty graph.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Vertices are added first, in the order of their numbers, so their identifiers are their numbers. All edges have the
+ * unit length and the graph's default stiffness. Only one edge is kept between two vertices.
+ */
+void graph_corpus::fill(_Inout_ ARBOR graph* target) const
+{
+    const D2D1_COLOR_F color = {0.0f, 0.0f, 0.0f, 1.0f};
+    std::vector<ARBOR vertex*, STLADD default_allocator<ARBOR vertex*>> vertices {};
+    vertices.reserve(m_verticesNumber);
+    TCHAR name[16];
+    for (size_t i = 0; m_verticesNumber > i; ++i)
+    {
+        _stprintf_s(name, _countof(name), TEXT("v%zu"), i);
+        vertices.push_back(target->addVertex(STLADD string_type (name), color, color, 1.0f, false));
+    }
+    for (const auto& item : m_edges)
+    {
+        target->addEdge(vertices[item.first], vertices[item.second], 1.0f, false, color);
+    }
+}
+
+
+/**
+ * Computes energy of a layout of the generated graph, which the layout methods minimize: lower energy is a better
+ * layout.
+ *
+ * Parameters:
+ * >positions
+ * Layout of a graph filled by the `fill` method.
+ * >parameters
+ * Parameters of the graph.
+ *
+ * Returns:
+ * Energy of the springs plus energy of the exact repulsion of all pairs of vertices.
+ *
+ * Remarks:
+ * The energies match the graph forces (see `ARBOR spring_set` and the `graph::applyExactRepulsion` method) for the
+ * unit lengths and masses the `fill` method sets: a spring pulls by half of the stiffness, so its energy is a quarter
+ * of the stiffness times the squared stretch; a vertex repulses another one by the repulsion divided by the squared
+ * distance, so their energy is the repulsion divided by the distance. The distance is at least one, as the repulsion
+ * law flattens below it. Time of the repulsion energy grows as the squared number of vertices.
+ */
+double graph_corpus::getEnergy(
+    _In_ const ARBOR layout_snapshot& positions, _In_ const ARBOR simulation_parameters& parameters) const
+{
+    std::vector<double, STLADD default_allocator<double>> x(m_verticesNumber, 0.0);
+    std::vector<double, STLADD default_allocator<double>> y(m_verticesNumber, 0.0);
+    for (size_t i = 0; m_verticesNumber > i; ++i)
+    {
+        __m128 coordinates = positions.getCoordinates(i);
+        x[i] = _mm_cvtss_f32(coordinates);
+        y[i] = _mm_cvtss_f32(_mm_shuffle_ps(coordinates, coordinates, 0b01010101));
+    }
+    double springs = 0.0;
+    for (const auto& item : m_edges)
+    {
+        double stretch = std::hypot(x[item.first] - x[item.second], y[item.first] - y[item.second]) - 1.0;
+        springs += stretch * stretch;
+    }
+    double repulsion = 0.0;
+    for (size_t i = 0; m_verticesNumber > i; ++i)
+    {
+        for (size_t j = i + 1; m_verticesNumber > j; ++j)
+        {
+            repulsion += 1.0 / std::max(std::hypot(x[i] - x[j], y[i] - y[j]), 1.0);
+        }
+    }
+    return 0.25 * parameters.stiffness * springs + parameters.repulsion * repulsion;
+}
+
+
+/**
+ * Returns name of a graph kind.
+ *
+ * Parameters:
+ * >kind
+ * The kind.
+ *
+ * Returns:
+ * The name, for the benchmark reports.
+ */
+const char* graph_corpus::getName(_In_ const graph_kind kind) noexcept
+{
+    static const char* names[] = {"tree", "grid", "cluster", "mixed"};
+    return names[kind];
+}
+
+
+/**
+ * Adds edges of a random tree: each vertex is attached to a random one of the previous vertices.
+ *
+ * Parameters:
+ * >first
+ * Number of the tree root; vertices of the tree are numbered from it.
+ * >size
+ * Number of vertices in the tree.
+ *
+ * Returns:
+ * N/A.
+ */
+void graph_corpus::addTree(_In_ const uint32_t first, _In_ const uint32_t size)
+{
+    for (uint32_t i = 1; size > i; ++i)
+    {
+        m_edges.emplace_back(first + getRandom(i), first + i);
+    }
+}
+
+
+/**
+ * Returns next value of the generator.
+ *
+ * Parameters:
+ * >bound
+ * Upper bound of the value.
+ *
+ * Returns:
+ * A value in [0, `bound`).
+ *
+ * Remarks:
+ * That's a linear congruential generator; its lower bits are the weak ones, so they're dropped.
+ */
+uint32_t graph_corpus::getRandom(_In_ const uint32_t bound) noexcept
+{
+    m_random = m_random * 1103515245 + 12345;
+    return (m_random >> 8) % bound;
+}
+
+BENCH_END
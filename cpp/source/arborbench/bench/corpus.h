@@ -0,0 +1,79 @@
+﻿#pragma once
+#include "graph/graph.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include "service/stladdon.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+BENCH_BEGIN
+
+// Shapes of the graphs generated by `graph_corpus`.
+typedef enum
+{
+    // Each vertex is attached to a random one of the previous vertices.
+    TreeGraph,
+    // A square grid.
+    GridGraph,
+    // `graph_corpus::m_clustersNumber` random trees, joined into a ring by one edge each.
+    ClusterGraph,
+    // A random tree plus half as many random edges, so it has cycles of any length.
+    MixedGraph
+}
+graph_kind;
+
+/**
+ * `graph_corpus` class generates graphs the benchmarks lay out.
+ *
+ * Remarks:
+ * A graph of the same kind and size is the same on each run: the generator is seeded by a constant, not by the `seed`
+ * simulation parameter. The generated edges refer to vertices by numbers, and vertex number `i` is the vertex with the
+ * `i` identifier (see `vertex::getId`) of a graph filled by the `fill` method, so a layout can be checked against the
+ * edges.
+ */
+class graph_corpus
+{
+public:
+    typedef std::pair<uint32_t, uint32_t> edge_type;
+    typedef std::vector<edge_type, STLADD default_allocator<edge_type>> edges_cont_t;
+
+    graph_corpus(_In_ const graph_kind kind, _In_ const size_t size);
+    graph_corpus(_In_ const graph_corpus&) = delete;
+    graph_corpus& operator =(_In_ const graph_corpus&) = delete;
+
+    graph_kind getKind() const noexcept
+    {
+        return m_kind;
+    }
+
+    size_t getVerticesNumber() const noexcept
+    {
+        return m_verticesNumber;
+    }
+
+    const edges_cont_t& getEdges() const noexcept
+    {
+        return m_edges;
+    }
+
+    void fill(_Inout_ ARBOR graph* target) const;
+    double getEnergy(
+        _In_ const ARBOR layout_snapshot& positions, _In_ const ARBOR simulation_parameters& parameters) const;
+    static const char* getName(_In_ const graph_kind kind) noexcept;
+
+
+private:
+    static constexpr uint32_t m_clustersNumber = 10;
+    static constexpr uint32_t m_seed = 12345;
+
+    void addTree(_In_ const uint32_t first, _In_ const uint32_t size);
+    uint32_t getRandom(_In_ const uint32_t bound) noexcept;
+
+    edges_cont_t m_edges;
+    size_t m_verticesNumber;
+    graph_kind m_kind;
+    uint32_t m_random;
+};
+
+BENCH_END
@@ -0,0 +1,124 @@
+﻿#include "bench/frames.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+BENCH_BEGIN
+
+/**
+ * Measures frames of all the graphs with all the engines and prints a line per graph and engine.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ */
+void frame_benchmark::run() const
+{
+    static const size_t sizes[] = {1000, 10000, 100000};
+    static const ARBOR repulsion_engine engines[] = {
+        ARBOR PointerBarnesHutTree,
+        ARBOR FlatBarnesHutTree,
+        ARBOR SortedFlatBarnesHutTree,
+        ARBOR IncrementalFlatBarnesHutTree,
+        ARBOR DualTreeFlatBarnesHutTree};
+    std::printf(
+        "%u frames after %u warm-up frames, %u threads\n",
+        m_framesNumber,
+        m_warmupFrames,
+        std::max(std::thread::hardware_concurrency(), 1u));
+    std::printf(
+        "%9s  %-28s %10s %10s %10s %12s %9s\n",
+        "vertices",
+        "engine",
+        "mean, ms",
+        "min, ms",
+        "max, ms",
+        "interactions",
+        "targets");
+    for (size_t size : sizes)
+    {
+        graph_corpus corpus {MixedGraph, size};
+        for (ARBOR repulsion_engine engine : engines)
+        {
+            measure(corpus, engine);
+        }
+    }
+}
+
+
+/**
+ * Returns name of a repulsion engine.
+ *
+ * Parameters:
+ * >engine
+ * The engine.
+ *
+ * Returns:
+ * The name, for the benchmark reports.
+ */
+const char* frame_benchmark::getEngineName(_In_ const ARBOR repulsion_engine engine) noexcept
+{
+    static const char* names[] = {
+        "PointerBarnesHutTree",
+        "FlatBarnesHutTree",
+        "SortedFlatBarnesHutTree",
+        "IncrementalFlatBarnesHutTree",
+        "DualTreeFlatBarnesHutTree"};
+    return names[engine];
+}
+
+
+/**
+ * Measures frames of a graph with an engine and prints a line of the report.
+ *
+ * Parameters:
+ * >corpus
+ * The graph.
+ * >engine
+ * The engine.
+ *
+ * Returns:
+ * N/A.
+ */
+void frame_benchmark::measure(_In_ const graph_corpus& corpus, _In_ const ARBOR repulsion_engine engine) const
+{
+    auto target = std::make_unique<ARBOR graph>();
+    corpus.fill(target.get());
+    target->setRepulsionEngine(engine);
+    ARBOR layout_limits limits = ARBOR graph::getDefaultLayoutLimits();
+    // The layout never converges, so each call makes `maxSteps` steps.
+    limits.energyThreshold = 0.0f;
+    limits.maxSteps = m_warmupFrames;
+    ARBOR layout_snapshot positions {};
+    target->layout(limits, &positions);
+
+    limits.maxSteps = 1;
+    std::chrono::microseconds total = std::chrono::microseconds::zero();
+    std::chrono::microseconds minimum = std::chrono::microseconds::max();
+    std::chrono::microseconds maximum = std::chrono::microseconds::zero();
+    ARBOR repulsion_statistics repulsion {};
+    for (uint32_t i = 0; m_framesNumber > i; ++i)
+    {
+        ARBOR layout_statistics statistics = target->layout(limits, &positions);
+        std::chrono::microseconds duration = statistics.duration;
+        repulsion = statistics.repulsion;
+        total += duration;
+        minimum = std::min(minimum, duration);
+        maximum = std::max(maximum, duration);
+    }
+    std::printf(
+        "%9zu  %-28s %10.3f %10.3f %10.3f %12zu %9zu\n",
+        corpus.getVerticesNumber(),
+        getEngineName(engine),
+        total.count() / (1000.0 * m_framesNumber),
+        minimum.count() / 1000.0,
+        maximum.count() / 1000.0,
+        repulsion.interactions,
+        repulsion.targets);
+}
+
+BENCH_END
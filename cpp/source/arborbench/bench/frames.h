@@ -0,0 +1,48 @@
+﻿#pragma once
+#include "bench/corpus.h"
+#include "graph/graph.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include <cstdint>
+
+BENCH_BEGIN
+
+/**
+ * `frame_benchmark` class measures time of a simulation step (a frame of the animation) with each repulsion engine, on
+ * graphs of 1000, 10000 and 100000 vertices.
+ *
+ * Remarks:
+ * Each engine lays out its own copy of the `MixedGraph`, from the same initial layout and with the default parameters
+ * (see `graph::getDefaultParameters`). The graph makes `m_warmupFrames` steps first, so that the engines that keep their
+ * tree between steps have built it and the vertices have left their initial places. Then each frame is a one step
+ * `graph::layout` call, so its time includes the snapshot publication a rendered frame pays too, and excludes waiting
+ * for the graph's locks.
+ *
+ * The report also shows the repulsion statistics of the last frame (see `ARBOR repulsion_statistics`): number of
+ * forces computed, that only some engines count, and number of vertices that weren't sleeping.
+ */
+class frame_benchmark
+{
+public:
+    explicit frame_benchmark(_In_ const uint32_t framesNumber) noexcept
+        :
+        m_framesNumber {framesNumber ? framesNumber : 1}
+    {
+    }
+
+    frame_benchmark(_In_ const frame_benchmark&) = delete;
+    frame_benchmark& operator =(_In_ const frame_benchmark&) = delete;
+
+    void run() const;
+    static const char* getEngineName(_In_ const ARBOR repulsion_engine engine) noexcept;
+
+
+private:
+    static constexpr uint32_t m_warmupFrames = 10;
+
+    void measure(_In_ const graph_corpus& corpus, _In_ const ARBOR repulsion_engine engine) const;
+
+    uint32_t m_framesNumber;
+};
+
+BENCH_END
@@ -0,0 +1,233 @@
+﻿#include "bench/integrate.h"
+#include "graph/vector.h"
+#include "service/sse.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+BENCH_BEGIN
+
+/**
+ * Measures integration of all the sizes and prints a line per size.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ */
+void integrate_benchmark::run() const
+{
+    static const size_t sizes[] = {10000, 100000, 1000000};
+    std::printf(
+        "%u steps, physics_state::integrate uses %s instructions\n",
+        m_stepsNumber,
+        simd_cpu_capabilities::avx2() ? "AVX2" : "SSE");
+    std::printf(
+        "%9s %16s %16s %9s %12s\n", "vertices", "reference, ms", "integrate, ms", "speedup", "difference");
+    for (size_t size : sizes)
+    {
+        measure(size);
+    }
+}
+
+
+/**
+ * Measures integration of a state of the specified size and prints a line of the report.
+ *
+ * Parameters:
+ * >size
+ * Number of vertices.
+ *
+ * Returns:
+ * N/A.
+ */
+void integrate_benchmark::measure(_In_ const size_t size) const
+{
+    ARBOR physics_state reference {};
+    ARBOR physics_state state {};
+    fill(size, &reference);
+    fill(size, &state);
+    std::chrono::duration<double, std::milli> referenceTime {0.0};
+    std::chrono::duration<double, std::milli> time {0.0};
+    float scale = -1.0f / static_cast<float> (size);
+    for (uint32_t i = 0; m_stepsNumber > i; ++i)
+    {
+        setForces(&reference, i);
+        setForces(&state, i);
+
+        auto start = std::chrono::steady_clock::now();
+        integrateReference(&reference, m_friction, m_timeSlice);
+        auto finish = std::chrono::steady_clock::now();
+        referenceTime += finish - start;
+
+        start = std::chrono::steady_clock::now();
+        // The drift is computed as the `graph::updateVelocityAndPosition` method computes it.
+        __m128 drift = _mm_mul_ps(state.getCoordinatesSum(), _mm_load_ps1(&scale));
+        state.integrate(drift, 0.0f, m_friction, m_timeSlice);
+        finish = std::chrono::steady_clock::now();
+        time += finish - start;
+    }
+
+    float difference = 0.0f;
+    for (size_t i = 0; size > i; ++i)
+    {
+        sse_t value;
+        _mm_store_ps(value.data, _mm_sub_ps(reference.getCoordinates(i), state.getCoordinates(i)));
+        difference = std::max(difference, std::max(std::abs(value.data[0]), std::abs(value.data[1])));
+    }
+    std::printf(
+        "%9zu %16.3f %16.3f %9.1f %12.2e\n",
+        size,
+        referenceTime.count() / m_stepsNumber,
+        time.count() / m_stepsNumber,
+        referenceTime.count() / time.count(),
+        difference);
+}
+
+
+/**
+ * Fills a physics state with vertices at pseudo-random places.
+ *
+ * Parameters:
+ * >size
+ * Number of vertices.
+ * >state
+ * The state, it must be empty.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Each call makes the same state. Every 100th vertex is fixed, so the benchmark covers the fixed vertices mask.
+ */
+void integrate_benchmark::fill(_In_ const size_t size, _Out_ ARBOR physics_state* state)
+{
+    uint32_t random = 12345;
+    for (size_t i = 0; size > i; ++i)
+    {
+        random = random * 1103515245 + 12345;
+        float x = static_cast<float> (random >> 8) / 16777216.0f;
+        random = random * 1103515245 + 12345;
+        float y = static_cast<float> (random >> 8) / 16777216.0f;
+        sse_t value = {(x - 0.5f) * 200.0f, (y - 0.5f) * 200.0f, 0.0f, 0.0f};
+        size_t id = state->add(_mm_load_ps(value.data));
+        state->setFixed(id, 0 == i % 100);
+    }
+}
+
+
+/**
+ * Sets forces of all vertices of a state, as the force passes of a step would do.
+ *
+ * Parameters:
+ * >state
+ * The state.
+ * >step
+ * Number of the step; the forces depend on it and on the vertex identifier only.
+ *
+ * Returns:
+ * N/A.
+ */
+void integrate_benchmark::setForces(_Inout_ ARBOR physics_state* state, _In_ const uint32_t step) noexcept
+{
+    for (size_t i = 0; state->size() > i; ++i)
+    {
+        float angle = static_cast<float> ((i * 7 + step * 13) % 360) * 0.0174533f;
+        sse_t value = {std::cos(angle) * 10.0f, std::sin(angle) * 10.0f, 0.0f, 0.0f};
+        state->setForce(i, _mm_load_ps(value.data));
+    }
+}
+
+
+/**
+ * Updates velocity and position of each vertex one at a time. A force applied to each vertex is zeroed.
+ *
+ * Parameters:
+ * >state
+ * The state.
+ * >friction
+ * Friction setting.
+ * >time
+ * Time slice of the step.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * This is the `graph::updateVelocityAndPosition` method before the physics state was vectorized, without the gravity
+ * (the benchmark turns it off): the center drift is summed up vertex by vertex, and the SSE4.1 support is checked for
+ * each vertex.
+ */
+float __vectorcall integrate_benchmark::integrateReference(
+    _Inout_ ARBOR physics_state* state, _In_ const float friction, _In_ const float time) noexcept
+{
+    const size_t size = state->size();
+    __m128 zero = ARBOR getZeroVector();
+    __m128 energyTotal = zero;
+    __m128 drift = zero;
+    for (size_t i = 0; size > i; ++i)
+    {
+        drift = _mm_sub_ps(drift, state->getCoordinates(i));
+    }
+    float count = static_cast<float> (size);
+    drift = _mm_mul_ps(drift, _mm_rcp_ps(_mm_load_ps1(&count)));
+    const float maxVelocity = 1000000.0f;
+    const float frictionComp = 1.0f - friction;
+    __m128 velocityVectorLength = _mm_load_ps1(&maxVelocity);
+    __m128 frictionCompVector = _mm_load_ps1(&frictionComp);
+    __m128 timeVector = _mm_load_ps1(&time);
+    __m128 temp;
+    for (size_t i = 0; size > i; ++i)
+    {
+        // > Apply center drift.
+        state->applyForce(i, drift);
+        // > Update velocity.
+        if (!state->getFixed(i))
+        {
+            temp = _mm_mul_ps(state->getForce(i), timeVector);
+            __m128 velocity = _mm_add_ps(state->getVelocity(i), temp);
+            velocity = _mm_mul_ps(velocity, frictionCompVector);
+            if (simd_cpu_capabilities::sse41())
+            {
+                temp = _mm_dp_ps(velocity, velocity, 0b00111111);
+            }
+            else
+            {
+                temp = _mm_shuffle_ps(velocity, velocity, 0b01000100);
+                temp = _mm_mul_ps(temp, temp);
+                temp = _mm_add_ps(temp, _mm_shuffle_ps(temp, temp, 0b10110001));
+            }
+            if (0b1111 & _mm_movemask_ps(_mm_cmpgt_ps(temp, velocityVectorLength)))
+            {
+                velocity = _mm_mul_ps(velocity, _mm_rcp_ps(temp));
+            }
+            state->setVelocity(i, velocity);
+        }
+        else
+        {
+            state->setVelocity(i, zero);
+        }
+        state->setForce(i, zero);
+        // > Update positions.
+        __m128 velocity = state->getVelocity(i);
+        temp = _mm_mul_ps(velocity, timeVector);
+        state->setCoordinates(i, _mm_add_ps(state->getCoordinates(i), temp));
+        // > Update energy.
+        if (simd_cpu_capabilities::sse41())
+        {
+            temp = _mm_dp_ps(velocity, velocity, 0b00111111);
+        }
+        else
+        {
+            temp = _mm_shuffle_ps(velocity, velocity, 0b01000100);
+            temp = _mm_mul_ps(temp, temp);
+            temp = _mm_add_ps(temp, _mm_shuffle_ps(temp, temp, 0b10110001));
+        }
+        energyTotal = _mm_add_ps(energyTotal, temp);
+    }
+    return _mm_cvtss_f32(energyTotal);
+}
+
+BENCH_END
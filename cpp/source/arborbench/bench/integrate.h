@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "graph/physics.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include <cstdint>
+
+BENCH_BEGIN
+
+/**
+ * `integrate_benchmark` class measures time of the integration (moving the vertices by their forces) of a step, done
+ * by the `physics_state::integrate` method and by a reference loop over the vertices, on 10000, 100000 and 1000000
+ * vertices.
+ *
+ * Remarks:
+ * The reference loop is the integration a graph made before the physics state was vectorized: the vertices are
+ * processed one at a time, by SSE instructions, and the center drift is summed up the same way. Both ways integrate
+ * copies of the same state, with the same forces set before each step, so the report shows the largest difference of
+ * the coordinates too. The `physics_state::integrate` method uses AVX2 instructions if the CPU supports them, and SSE
+ * instructions otherwise; the report says which ones.
+ */
+class integrate_benchmark
+{
+public:
+    explicit integrate_benchmark(_In_ const uint32_t stepsNumber) noexcept
+        :
+        m_stepsNumber {stepsNumber ? stepsNumber : 1}
+    {
+    }
+
+    integrate_benchmark(_In_ const integrate_benchmark&) = delete;
+    integrate_benchmark& operator =(_In_ const integrate_benchmark&) = delete;
+
+    void run() const;
+
+
+private:
+    static constexpr float m_friction = 0.5f;
+    static constexpr float m_timeSlice = 0.01f;
+
+    void measure(_In_ const size_t size) const;
+    static void fill(_In_ const size_t size, _Out_ ARBOR physics_state* state);
+    static void setForces(_Inout_ ARBOR physics_state* state, _In_ const uint32_t step) noexcept;
+    static float __vectorcall integrateReference(
+        _Inout_ ARBOR physics_state* state, _In_ const float friction, _In_ const float time) noexcept;
+
+    uint32_t m_stepsNumber;
+};
+
+BENCH_END
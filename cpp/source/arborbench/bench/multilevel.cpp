@@ -0,0 +1,82 @@
+﻿#include "bench/multilevel.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+BENCH_BEGIN
+
+/**
+ * Lays out all the graphs by both methods and prints a line per graph and method.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ */
+void multilevel_benchmark::run() const
+{
+    static const graph_kind kinds[] = {TreeGraph, GridGraph, ClusterGraph};
+    static const size_t sizes[] = {2000, 10000};
+    ARBOR layout_limits limits = ARBOR graph::getDefaultLayoutLimits();
+    ARBOR simulation_parameters parameters = ARBOR graph::getDefaultParameters();
+    std::printf(
+        "Layout until mean energy is below %g for %u steps, at most %u steps, %u threads\n",
+        limits.energyThreshold,
+        parameters.stopSteps,
+        limits.maxSteps,
+        std::max(std::thread::hardware_concurrency(), 1u));
+    std::printf(
+        "%-8s %9s  %-11s %7s %9s %12s %14s\n", "graph", "vertices", "method", "levels", "steps", "time, ms", "energy");
+    for (size_t size : sizes)
+    {
+        for (graph_kind kind : kinds)
+        {
+            graph_corpus corpus {kind, size};
+            measure(corpus, ARBOR FlatLayout);
+            measure(corpus, ARBOR MultilevelLayout);
+        }
+    }
+}
+
+
+/**
+ * Lays out a graph by a method and prints a line of the report.
+ *
+ * Parameters:
+ * >corpus
+ * The graph.
+ * >method
+ * The layout method.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * A layout stopped by the step limit is marked by an asterisk after the steps number.
+ */
+void multilevel_benchmark::measure(_In_ const graph_corpus& corpus, _In_ const ARBOR layout_method method) const
+{
+    auto target = std::make_unique<ARBOR graph>();
+    corpus.fill(target.get());
+    ARBOR simulation_parameters parameters = target->getParameters();
+    parameters.integrator = ARBOR VerletIntegrator;
+    target->setParameters(parameters);
+    ARBOR layout_limits limits = ARBOR graph::getDefaultLayoutLimits();
+    limits.method = method;
+    ARBOR layout_snapshot positions {};
+    ARBOR layout_statistics statistics = target->layout(limits, &positions);
+    std::printf(
+        "%-8s %9zu  %-11s %7u %8u%c %12.1f %14.6g\n",
+        graph_corpus::getName(corpus.getKind()),
+        corpus.getVerticesNumber(),
+        (ARBOR FlatLayout == method) ? "flat" : "multilevel",
+        statistics.levels,
+        statistics.steps,
+        (ARBOR LayoutConverged == statistics.reason) ? ' ' : '*',
+        statistics.duration.count() / 1000.0,
+        corpus.getEnergy(positions, parameters));
+}
+
+BENCH_END
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "bench/corpus.h"
+#include "graph/graph.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include <cstdint>
+
+BENCH_BEGIN
+
+/**
+ * `multilevel_benchmark` class compares the layout methods (see `ARBOR layout_limits::method`): number of steps, time
+ * and energy of a layout to convergence, on trees, grids and clusters of 2000 and 10000 vertices.
+ *
+ * Remarks:
+ * Each method lays out its own copy of a graph, from the same initial layout, by the `VerletIntegrator` and with the
+ * default parameters otherwise. The steps of the `MultilevelLayout` include the steps of its coarse levels, though
+ * those are cheaper than steps of the graph itself. The energy is the exact energy of the final layout (see
+ * `graph_corpus::getEnergy`), so the methods can be checked to reach as good a layout.
+ */
+class multilevel_benchmark
+{
+public:
+    multilevel_benchmark() = default;
+    multilevel_benchmark(_In_ const multilevel_benchmark&) = delete;
+    multilevel_benchmark& operator =(_In_ const multilevel_benchmark&) = delete;
+
+    void run() const;
+
+
+private:
+    void measure(_In_ const graph_corpus& corpus, _In_ const ARBOR layout_method method) const;
+};
+
+BENCH_END
@@ -0,0 +1,70 @@
+﻿#include "bench/frames.h"
+#include "bench/repulsion.h"
+#include <cstdio>
+#include <memory>
+
+BENCH_BEGIN
+
+/**
+ * Measures errors of all the engines on all the graphs and prints a line per graph and engine.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ */
+void repulsion_benchmark::run() const
+{
+    static const size_t sizes[] = {2000, 10000, 50000};
+    std::printf("Error against exact forces after %u steps\n", m_warmupSteps);
+    std::printf("%9s  %-28s %7s %10s %10s\n", "vertices", "engine", "theta", "max", "mean");
+    for (size_t size : sizes)
+    {
+        graph_corpus corpus {MixedGraph, size};
+        measure(corpus);
+    }
+}
+
+
+/**
+ * Lays out a graph and prints a line of the report per engine.
+ *
+ * Parameters:
+ * >corpus
+ * The graph.
+ *
+ * Returns:
+ * N/A.
+ */
+void repulsion_benchmark::measure(_In_ const graph_corpus& corpus) const
+{
+    static const ARBOR repulsion_engine engines[] = {
+        ARBOR PointerBarnesHutTree,
+        ARBOR FlatBarnesHutTree,
+        ARBOR SortedFlatBarnesHutTree,
+        ARBOR IncrementalFlatBarnesHutTree,
+        ARBOR DualTreeFlatBarnesHutTree};
+    auto target = std::make_unique<ARBOR graph>();
+    corpus.fill(target.get());
+    ARBOR layout_limits limits = ARBOR graph::getDefaultLayoutLimits();
+    limits.energyThreshold = 0.0f;
+    limits.maxSteps = m_warmupSteps;
+    ARBOR layout_snapshot positions {};
+    target->layout(limits, &positions);
+
+    for (ARBOR repulsion_engine engine : engines)
+    {
+        target->setRepulsionEngine(engine);
+        ARBOR repulsion_error error = target->measureRepulsionError();
+        std::printf(
+            "%9zu  %-28s %7.3f %10.4f %10.4f\n",
+            corpus.getVerticesNumber(),
+            frame_benchmark::getEngineName(engine),
+            target->getRepulsionStatistics().theta,
+            error.maxError,
+            error.meanError);
+    }
+}
+
+BENCH_END
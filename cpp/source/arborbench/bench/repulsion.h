@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "bench/corpus.h"
+#include "graph/graph.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include <cstdint>
+
+BENCH_BEGIN
+
+/**
+ * `repulsion_benchmark` class measures error of repulsion forces of each engine against the exact forces (see the
+ * `graph::measureRepulsionError` method), on graphs of 2000, 10000 and 50000 vertices.
+ *
+ * Remarks:
+ * The `MixedGraph` is laid out by `m_warmupSteps` steps first, so the vertices aren't at their initial places anymore.
+ * Then all the engines are measured on this layout: switching an engine doesn't move the vertices. Time of the exact
+ * forces grows as the squared number of vertices, so the graphs are smaller than the `frame_benchmark`'s ones.
+ */
+class repulsion_benchmark
+{
+public:
+    repulsion_benchmark() = default;
+    repulsion_benchmark(_In_ const repulsion_benchmark&) = delete;
+    repulsion_benchmark& operator =(_In_ const repulsion_benchmark&) = delete;
+
+    void run() const;
+
+
+private:
+    static constexpr uint32_t m_warmupSteps = 100;
+
+    void measure(_In_ const graph_corpus& corpus) const;
+};
+
+BENCH_END
@@ -0,0 +1,152 @@
+﻿#include "bench/wake.h"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+BENCH_BEGIN
+
+/**
+ * Lays out the graph until it sleeps, adds an edge and prints numbers of vertices the next two steps compute forces of.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * `true` if the check passes, `false` if it doesn't (or the graph hasn't fallen asleep in `m_maxSettleSteps` steps).
+ */
+bool wake_check::run() const
+{
+    graph_corpus corpus {GridGraph, m_verticesNumber};
+    auto target = std::make_unique<ARBOR graph>();
+    corpus.fill(target.get());
+    ARBOR layout_snapshot positions {};
+    ARBOR layout_statistics statistics = target->layout(ARBOR graph::getDefaultLayoutLimits(), &positions);
+    ARBOR simulation_parameters parameters = target->getParameters();
+    parameters.sleepVelocity = m_sleepVelocity;
+    parameters.sleepForce = m_sleepForce;
+    parameters.sleep = true;
+    target->setParameters(parameters);
+    uint32_t settleSteps = settle(target.get(), parameters.sleepSteps);
+    if (!settleSteps)
+    {
+        std::printf("%zu vertices haven't fallen asleep in %u steps\n", corpus.getVerticesNumber(), m_maxSettleSteps);
+        return false;
+    }
+
+    // The new edge joins the last vertex (a corner of the grid) and the first vertex from the middle on it isn't
+    // connected to.
+    std::vector<uint32_t, STLADD default_allocator<uint32_t>> degrees(corpus.getVerticesNumber(), 0);
+    for (const auto& item : corpus.getEdges())
+    {
+        ++degrees[item.first];
+        ++degrees[item.second];
+    }
+    const uint32_t tail = static_cast<uint32_t> (corpus.getVerticesNumber() - 1);
+    uint32_t head = tail / 2;
+    for (const auto& item : corpus.getEdges())
+    {
+        if (((tail == item.first) && (head == item.second)) || ((tail == item.second) && (head == item.first)))
+        {
+            ++head;
+        }
+    }
+    const D2D1_COLOR_F color = {0.0f, 0.0f, 0.0f, 1.0f};
+    target->addEdge(findVertex(target.get(), tail), findVertex(target.get(), head), 1.0f, false, color);
+
+    uint32_t stepNumber;
+    size_t first = step(target.get(), &stepNumber);
+    size_t second = step(target.get(), &stepNumber);
+    // Each of the two vertices may wake up its neighbours by the edges it had and its mates in the Barnes Hut leaf.
+    size_t bound = 2 + degrees[tail] + degrees[head] + 2 * (parameters.leafCapacity - 1);
+    bool result = (2 == first) && (bound >= second);
+    std::printf(
+        "%zu vertices converged after %u steps, asleep after %u more; edge %u-%u (%u and %u edges)\n",
+        corpus.getVerticesNumber(),
+        statistics.steps,
+        settleSteps,
+        tail,
+        head,
+        degrees[tail],
+        degrees[head]);
+    std::printf("awake on the first step: %zu (expected 2)\n", first);
+    std::printf("awake on the second step: %zu (expected at most %zu)\n", second, bound);
+    std::puts(result ? "passed" : "failed");
+    return result;
+}
+
+
+/**
+ * Lays out a graph until a step computes forces of no vertex, and the next two steps don't wake up all vertices.
+ *
+ * Parameters:
+ * >target
+ * The graph, with the `sleep` parameter set.
+ * >sleepSteps
+ * The `sleepSteps` parameter of the graph.
+ *
+ * Returns:
+ * Number of the steps made, or zero if the graph hasn't fallen asleep in `m_maxSettleSteps` steps.
+ */
+uint32_t wake_check::settle(_Inout_ ARBOR graph* target, _In_ const uint32_t sleepSteps)
+{
+    for (uint32_t i = 1; m_maxSettleSteps >= i; ++i)
+    {
+        uint32_t stepNumber;
+        if (!step(target, &stepNumber) && ((stepNumber + 1) % sleepSteps) && ((stepNumber + 2) % sleepSteps))
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * Makes a step of a graph layout.
+ *
+ * Parameters:
+ * >target
+ * The graph.
+ * >stepNumber
+ * Number of the step made, counted by the graph (see the `layout_snapshot::getStep` method).
+ *
+ * Returns:
+ * Number of vertices the step has computed forces of.
+ */
+size_t wake_check::step(_Inout_ ARBOR graph* target, _Out_ uint32_t* stepNumber)
+{
+    ARBOR layout_limits limits = ARBOR graph::getDefaultLayoutLimits();
+    limits.energyThreshold = 0.0f;
+    limits.maxSteps = 1;
+    ARBOR layout_snapshot positions {};
+    ARBOR layout_statistics statistics = target->layout(limits, &positions);
+    *stepNumber = positions.getStep();
+    return statistics.repulsion.targets;
+}
+
+
+/**
+ * Finds a vertex of a graph by its identifier.
+ *
+ * Parameters:
+ * >target
+ * The graph.
+ * >id
+ * The identifier.
+ *
+ * Returns:
+ * The vertex, or `nullptr` if the graph has no such vertex.
+ */
+ARBOR vertex* wake_check::findVertex(_In_ ARBOR graph* target, _In_ const size_t id) noexcept
+{
+    for (auto i = target->verticesBegin(); target->verticesEnd() != i; ++i)
+    {
+        if (id == i->getId())
+        {
+            return &*i;
+        }
+    }
+    return nullptr;
+}
+
+BENCH_END
@@ -0,0 +1,44 @@
+﻿#pragma once
+#include "bench/corpus.h"
+#include "graph/graph.h"
+#include "ns/arbor.h"
+#include "ns/bench.h"
+#include <cstdint>
+
+BENCH_BEGIN
+
+/**
+ * `wake_check` class checks that an edge added to a settled graph wakes up only the vertices next to it: the two
+ * vertices of the edge, their neighbours, and the vertices sharing a Barnes Hut leaf with them.
+ *
+ * Remarks:
+ * A `GridGraph` of 1936 vertices (a tree, not exact repulsion, is used for it) is laid out until it converges, and then
+ * with the `sleep` parameter set until a step computes forces of no vertex. A converged layout still jitters a bit, so
+ * the `sleepVelocity` and `sleepForce` parameters are looser than the default ones, or some vertices never fall asleep.
+ * Then an edge joins two vertices that weren't connected. The next step must compute forces of those two vertices only
+ * (see the `spring_set::wakeAdded` method), and the step after it may add the vertices the moving ones have woken up
+ * (see the `graph::updateRest` method). Neither step may be a step that wakes up all vertices every `sleepSteps` steps,
+ * so the layout goes on past such a step before the edge is added.
+ */
+class wake_check
+{
+public:
+    wake_check() = default;
+    wake_check(_In_ const wake_check&) = delete;
+    wake_check& operator =(_In_ const wake_check&) = delete;
+
+    bool run() const;
+
+
+private:
+    static constexpr size_t m_verticesNumber = 1936;
+    static constexpr uint32_t m_maxSettleSteps = 20000;
+    static constexpr float m_sleepVelocity = 2.0f;
+    static constexpr float m_sleepForce = 200.0f;
+
+    static uint32_t settle(_Inout_ ARBOR graph* target, _In_ const uint32_t sleepSteps);
+    static size_t step(_Inout_ ARBOR graph* target, _Out_ uint32_t* stepNumber);
+    static ARBOR vertex* findVertex(_In_ ARBOR graph* target, _In_ const size_t id) noexcept;
+};
+
+BENCH_END
@@ -0,0 +1,4 @@
+﻿#pragma once
+#define BENCH_BEGIN namespace bench {
+#define BENCH_END }
+#define BENCH ::bench::
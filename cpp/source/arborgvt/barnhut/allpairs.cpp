@@ -0,0 +1,249 @@
+﻿#include "barnhut/allpairs.h"
+#include "graph/vector.h"
+
+BHUT_BEGIN
+
+/**
+ * Copies coordinates and masses of the specified vertices.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The vertex with the i identifier is referred to by the `index` parameter of the other methods with the i value.
+ */
+void all_pairs_repulsion::load(_In_ ARBOR physics_state* state)
+{
+    const size_t count = state->size();
+    size_t size = (count + 7) & ~static_cast<size_t> (7);
+    m_x.assign(size, 0.0f);
+    m_y.assign(size, 0.0f);
+    m_masses.assign(size, 0.0f);
+    m_state = state;
+    const float* x = state->getX();
+    const float* y = state->getY();
+    const float* masses = state->getMasses();
+    for (size_t i = 0; count > i; ++i)
+    {
+        if ((x[i] == x[i]) && (y[i] == y[i]))
+        {
+            m_x[i] = x[i];
+            m_y[i] = y[i];
+            m_masses[i] = masses[i];
+        }
+    }
+}
+
+
+/**
+ * Computes repulsion of all vertices applied to the specified one.
+ *
+ * Parameters:
+ * >index
+ * Index of the vertex.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Sum of the forces.
+ */
+__m128 all_pairs_repulsion::getForce(_In_ const size_t index, _In_ const float repulsion) const
+{
+    return m_avx2 ? getForceAvx2(index, repulsion) : getForceSse(index, repulsion);
+}
+
+
+/**
+ * Applies repulsion forces to all vertices.
+ *
+ * Parameters:
+ * >repulsion
+ * Repulsion setting.
+ * >seed
+ * Seed of the random engines.
+ * >pool
+ * Threads used to compute the forces.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Each thread of the `pool` takes its own contiguous range of the vertices. The random engine is seeded by the `seed`
+ * and the vertex index before each vertex is processed, so result doesn't depend on number of threads. Sleeping
+ * vertices are skipped (see `ARBOR physics_state`), but they still repulse the others.
+ */
+void all_pairs_repulsion::applyForces(
+    _In_ const float repulsion, _In_ const uint32_t seed, _In_ MISCUTIL thread_pool* pool) const
+{
+    auto task = [this, repulsion, seed] (_In_ const size_t index, _In_ const size_t count) -> void
+    {
+        size_t size = m_state->size();
+        size_t last = size * (index + 1) / count;
+        for (size_t i = size * index / count; last > i; ++i)
+        {
+            if (m_state->getSleeping(i))
+            {
+                continue;
+            }
+            ARBOR seedRandomVector(seed + static_cast<uint32_t> (i) + 1);
+            m_state->applyForce(i, getForce(i, repulsion));
+        }
+    };
+    pool->run(task);
+}
+
+
+/**
+ * Computes repulsion of all vertices applied to the specified one, using AVX2 instructions.
+ *
+ * Parameters:
+ * >index
+ * Index of the vertex.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Sum of the forces.
+ *
+ * Remarks:
+ * Math is the same as in the `particle::applyForce` method, eight vertices at once. Lanes past the last vertex are
+ * masked out. A vertex that has the same coordinates as the `index` one has is passed to the `getCoincidentForce`
+ * method.
+ */
+__m128 all_pairs_repulsion::getForceAvx2(_In_ const size_t index, _In_ const float repulsion) const
+{
+    alignas(32) static const float lanes[8] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+    const __m256 laneIndices = _mm256_load_ps(lanes);
+    const float one = 1.0f;
+    const __m256 ones = _mm256_broadcast_ss(&one);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 scaledRepulsion = _mm256_broadcast_ss(&repulsion);
+    const __m256 x = _mm256_broadcast_ss(&m_x[index]);
+    const __m256 y = _mm256_broadcast_ss(&m_y[index]);
+    const size_t size = m_state->size();
+    __m256 forceX = zero;
+    __m256 forceY = zero;
+    __m128 result = ARBOR getZeroVector();
+    for (size_t i = 0; size > i; i += 8)
+    {
+        __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(&m_x[i]));
+        __m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(&m_y[i]));
+        __m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        float rest = static_cast<float> (size - i);
+        __m256 mask = _mm256_cmp_ps(laneIndices, _mm256_broadcast_ss(&rest), _CMP_LT_OQ);
+        __m256 coincident = _mm256_and_ps(_mm256_cmp_ps(distance, zero, _CMP_EQ_OQ), mask);
+        mask = _mm256_andnot_ps(coincident, mask);
+        // force = (coordinates - other) / |coordinates - other| * mass * repulsion / max(distance^2, 1)
+        __m256 temp = _mm256_mul_ps(_mm256_loadu_ps(&m_masses[i]), scaledRepulsion);
+        temp = _mm256_mul_ps(temp, _mm256_rcp_ps(_mm256_max_ps(distance, ones)));
+        temp = _mm256_mul_ps(temp, _mm256_rcp_ps(_mm256_sqrt_ps(distance)));
+        forceX = _mm256_add_ps(forceX, _mm256_and_ps(_mm256_mul_ps(dx, temp), mask));
+        forceY = _mm256_add_ps(forceY, _mm256_and_ps(_mm256_mul_ps(dy, temp), mask));
+        for (int bits = _mm256_movemask_ps(coincident); bits; bits &= bits - 1)
+        {
+            unsigned long lane;
+            _BitScanForward(&lane, bits);
+            result = _mm_add_ps(result, getCoincidentForce(index, i + lane, repulsion));
+        }
+    }
+    __m128 temp = _mm_add_ps(_mm256_castps256_ps128(forceX), _mm256_extractf128_ps(forceX, 1));
+    __m128 temp2 = _mm_add_ps(_mm256_castps256_ps128(forceY), _mm256_extractf128_ps(forceY, 1));
+    _mm256_zeroupper();
+    temp = _mm_hadd_ps(temp, temp2);
+    temp = _mm_hadd_ps(temp, temp);
+    return _mm_add_ps(result, _mm_movelh_ps(temp, ARBOR getZeroVector()));
+}
+
+
+/**
+ * Computes repulsion of all vertices applied to the specified one, using SSE instructions.
+ *
+ * Parameters:
+ * >index
+ * Index of the vertex.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Sum of the forces.
+ *
+ * Remarks:
+ * This is the `getForceAvx2` method for CPUs without AVX2 support, four vertices at once.
+ */
+__m128 all_pairs_repulsion::getForceSse(_In_ const size_t index, _In_ const float repulsion) const
+{
+    static const sse_t lanes = {0.0f, 1.0f, 2.0f, 3.0f};
+    const __m128 laneIndices = _mm_load_ps(lanes.data);
+    const float one = 1.0f;
+    const __m128 ones = _mm_load_ps1(&one);
+    const __m128 zero = ARBOR getZeroVector();
+    const __m128 scaledRepulsion = _mm_load_ps1(&repulsion);
+    const __m128 x = _mm_load_ps1(&m_x[index]);
+    const __m128 y = _mm_load_ps1(&m_y[index]);
+    const size_t size = m_state->size();
+    __m128 forceX = zero;
+    __m128 forceY = zero;
+    __m128 result = zero;
+    for (size_t i = 0; size > i; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(x, _mm_loadu_ps(&m_x[i]));
+        __m128 dy = _mm_sub_ps(y, _mm_loadu_ps(&m_y[i]));
+        __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        float rest = static_cast<float> (size - i);
+        __m128 mask = _mm_cmplt_ps(laneIndices, _mm_load_ps1(&rest));
+        __m128 coincident = _mm_and_ps(_mm_cmpeq_ps(distance, zero), mask);
+        mask = _mm_andnot_ps(coincident, mask);
+        __m128 temp = _mm_mul_ps(_mm_loadu_ps(&m_masses[i]), scaledRepulsion);
+        temp = _mm_mul_ps(temp, _mm_rcp_ps(_mm_max_ps(distance, ones)));
+        temp = _mm_mul_ps(temp, _mm_rcp_ps(_mm_sqrt_ps(distance)));
+        forceX = _mm_add_ps(forceX, _mm_and_ps(_mm_mul_ps(dx, temp), mask));
+        forceY = _mm_add_ps(forceY, _mm_and_ps(_mm_mul_ps(dy, temp), mask));
+        for (int bits = _mm_movemask_ps(coincident); bits; bits &= bits - 1)
+        {
+            unsigned long lane;
+            _BitScanForward(&lane, bits);
+            result = _mm_add_ps(result, getCoincidentForce(index, i + lane, repulsion));
+        }
+    }
+    __m128 temp = _mm_hadd_ps(forceX, forceY);
+    temp = _mm_hadd_ps(temp, temp);
+    return _mm_add_ps(result, _mm_movelh_ps(temp, zero));
+}
+
+
+/**
+ * Computes repulsion of a vertex that has the same coordinates as the specified one has.
+ *
+ * Parameters:
+ * >index
+ * Index of the vertex the force is applied to.
+ * >other
+ * Index of the vertex that repulses.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Zero vector if the vertices are the same one or the `other` vertex has zero mass; otherwise force of the `other`
+ * vertex in a random direction.
+ */
+__m128 all_pairs_repulsion::getCoincidentForce(
+    _In_ const size_t index, _In_ const size_t other, _In_ const float repulsion) const
+{
+    if ((index == other) || (0.0f == m_masses[other]))
+    {
+        return ARBOR getZeroVector();
+    }
+    __m128 temp = ARBOR randomVector(1.0f);
+    __m128 temp2 = _mm_mul_ps(temp, temp);
+    temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
+    temp = _mm_mul_ps(temp, _mm_rcp_ps(_mm_sqrt_ps(temp2)));
+    float scale = m_masses[other] * repulsion;
+    temp = _mm_mul_ps(temp, _mm_load_ps1(&scale));
+    return _mm_movelh_ps(temp, ARBOR getZeroVector());
+}
+
+BHUT_END
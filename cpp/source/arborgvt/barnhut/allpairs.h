@@ -0,0 +1,66 @@
+﻿#pragma once
+#include "graph/physics.h"
+#include "ns/barnhut.h"
+#include "service/sse.h"
+#include "service/stladdon.h"
+#include "service/thrdpool.h"
+#include <cstdint>
+#include <immintrin.h>
+#include <vector>
+
+BHUT_BEGIN
+
+/**
+ * `all_pairs_repulsion` class computes repulsion forces exactly: force applied to a vertex is the sum of forces of all
+ * other vertices.
+ *
+ * Remarks:
+ * That's O(n^2) work, but there's no tree to build and to walk, so a small graph gets its forces faster than a Barnes
+ * Hut tree gives them. The exact forces are also the reference to measure the Barnes Hut approximation error.
+ *
+ * The `load` method copies coordinates and masses of the vertices into contiguous arrays, so the force of each vertex
+ * is computed by a linear pass over them: eight vertices per AVX2 instruction, or four per SSE instruction if the CPU
+ * doesn't support AVX2. Math is the same as in the `particle::applyForce` method. A vertex with NaN coordinates gets
+ * zero mass in the arrays, so it doesn't repulse anything, just as it isn't inserted into a Barnes Hut tree.
+ */
+class all_pairs_repulsion
+{
+public:
+    all_pairs_repulsion()
+        :
+        m_x {},
+        m_y {},
+        m_masses {},
+        m_state {nullptr},
+        m_avx2 {simd_cpu_capabilities::avx2()}
+    {
+    }
+
+    all_pairs_repulsion(_In_ const all_pairs_repulsion&) = delete;
+    all_pairs_repulsion& operator =(_In_ const all_pairs_repulsion&) = delete;
+
+    void __fastcall load(_In_ ARBOR physics_state* state);
+    __m128 __fastcall getForce(_In_ const size_t index, _In_ const float repulsion) const;
+    void __fastcall applyForces(
+        _In_ const float repulsion, _In_ const uint32_t seed, _In_ MISCUTIL thread_pool* pool) const;
+
+
+private:
+    typedef std::vector<float, STLADD default_allocator<float>> floats_cont_t;
+
+    __m128 __fastcall getForceAvx2(_In_ const size_t index, _In_ const float repulsion) const;
+    __m128 __fastcall getForceSse(_In_ const size_t index, _In_ const float repulsion) const;
+    __m128 __fastcall getCoincidentForce(
+        _In_ const size_t index, _In_ const size_t other, _In_ const float repulsion) const;
+
+    // Copies of vertices coordinates and masses. The arrays are padded by zero masses to a multiple of eight elements,
+    // so they can be read by whole AVX2 vectors.
+    floats_cont_t m_x;
+    floats_cont_t m_y;
+    floats_cont_t m_masses;
+    // Physical parameters of the vertices; forces are applied to them.
+    ARBOR physics_state* m_state;
+    const bool m_avx2;
+};
+
+BHUT_END
@@ -1,5 +1,4 @@
 ﻿#include "barnhut/barnhut.h"
-#include <memory>
 
 BHUT_BEGIN
 
@@ -7,40 +6,50 @@ BHUT_BEGIN
  * Treats the specified graph vertex as a particle and place it to this Barnes Hut tree.
  *
  * Parmeters:
- * >v
- * Graph vertex.
+ * >id
+ * Identifier of the graph vertex.
  *
  * Returns:
  * N/A.
  *
  * Remarks:
  * This is `ArborGVT::BarnesHutTree::insert` method in the original C# code.
+ *
+ * New elements of the tree are taken from the arena, so once the arena has grown up to the tree size this method
+ * doesn't allocate memory.
  */
-void barnes_hut_tree::insert(_In_ ARBOR vertex* v)
+void barnes_hut_tree::insert(_In_ const size_t id)
 {
-    branch* currentBranch = m_root.get();
-    auto currentParticle = std::make_unique<particle>(v);
-    quad_element::particles_cont_t particles {};
-    while (currentParticle || particles.size())
+    branch* currentBranch = m_root;
+    size_t depth = 0;
+    particle* currentParticle = m_arena.create<particle>(m_state, id);
+    particle* pendingParticle = nullptr;
+    while (currentParticle || pendingParticle)
     {
         if (!currentParticle)
         {
-            currentParticle = std::move(particles.front());
-            particles.pop_front();
+            currentParticle = pendingParticle;
+            pendingParticle = nullptr;
         }
 
-        branch::quad_index quad = currentBranch->getQuad(currentParticle.get());
+        branch::quad_index quad = currentBranch->getQuad(currentParticle);
         quad_element* quadElement;
         if (currentBranch->getQuadContent(quad, &quadElement))
         {
             if (nullptr == quadElement)
             {
-                currentBranch->increaseParameters(currentParticle.get());
-                currentBranch->setQuadContent(quad, std::move(currentParticle));
+                currentBranch->increaseParameters(currentParticle);
+                currentBranch->setQuadContent(quad, currentParticle);
+                currentParticle = nullptr;
             }
             else
             {
-                currentBranch = quadElement->handleParticle(currentParticle.get(), currentBranch, quad, &particles);
+                currentBranch =
+                    quadElement->handleParticle(currentParticle, currentBranch, quad, &m_arena, &pendingParticle);
+                if (m_depth < ++depth)
+                {
+                    m_depth = depth;
+                }
             }
         }
     }
@@ -51,28 +60,38 @@ void barnes_hut_tree::insert(_In_ ARBOR vertex* v)
  * Applies forces to each particle in this Barnes Hut tree.
  *
  * Parmeters:
- * >v
- * Graph vertex.
+ * >id
+ * Identifier of the graph vertex.
  * >repulsion
  * Repulsion setting.
+ * >elements
+ * Stack used to walk the tree. The method resets the stack, so its content isn't used.
  *
  * Returns:
  * N/A.
  *
  * Remarks:
  * This is `ArborGVT::BarnesHutTree::applyForces` method in the original C# code.
+ *
+ * The original code walks the tree breadth-first, using a queue. This method walks it depth-first: children of a
+ * branch are visited right after the branch itself, while they are still in the cache. Each opened branch of depth `d`
+ * leaves at most three of its quads on the stack while the walk descends to the fourth one, and the deepest opened
+ * branch pushes all of its four quads. So the stack never holds more than `3 * m_depth + 4` elements.
+ *
+ * Forces are computed by the same `branch::applyForce` and `particle::applyForce` methods as before, but they're
+ * summed up in a different order.
  */
-void barnes_hut_tree::applyForce(_In_ ARBOR vertex* v, _In_ const float repulsion) const
+void barnes_hut_tree::applyForce(
+    _In_ const size_t id, _In_ const float repulsion, _In_ elements_stack_t* elements) const
 {
-    quad_element::quad_elements_cont_t elements {1};
-    elements.front() = m_root.get();
-    while (elements.size())
+    elements->reset(3 * m_depth + 4);
+    elements->push(m_root);
+    while (!elements->empty())
     {
-        const quad_element* element = elements.front();
-        elements.pop_front();
-        if (element && (v != element->getVertex()))
+        const quad_element* element = elements->pop();
+        if (id != element->getId())
         {
-            element->applyForce(v, repulsion, m_dist, &elements);
+            element->applyForce(m_state, id, repulsion, m_dist, elements);
         }
     }
 }
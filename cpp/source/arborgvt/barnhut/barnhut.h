@@ -1,28 +1,48 @@
 ﻿#pragma once
+#include "barnhut/bhutpool.h"
 #include "barnhut/bhutquad.h"
-#include "graph/vertex.h"
+#include "graph/physics.h"
 #include "ns/barnhut.h"
-#include <memory>
 
 BHUT_BEGIN
 
+/**
+ * `barnes_hut_tree` class is a quad tree used by Barnes Hut simulation.
+ *
+ * Remarks:
+ * All elements of the tree live inside the `node_arena` passed to the ctor. The tree doesn't free them; it's the arena
+ * owner who decides when the tree isn't needed anymore and resets the arena. The arena must outlive the tree.
+ */
 class barnes_hut_tree
 {
 public:
-    barnes_hut_tree(_In_ __m128 area, _In_ const float dist)
+    barnes_hut_tree(_In_ __m128 area, _In_ const float dist, _In_ node_arena& arena, _In_ ARBOR physics_state* state)
         :
-        m_root {std::make_unique<branch>(area)},
-        m_dist {dist * dist}
+        m_arena {arena},
+        m_state {state},
+        m_root {arena.create<branch>(area)},
+        m_dist {dist * dist},
+        m_depth {0}
     {
     }
 
-    void __fastcall insert(_In_ ARBOR vertex* v);
-    void __fastcall applyForce(_In_ ARBOR vertex* v, _In_ const float repulsion) const;
+    barnes_hut_tree(_In_ const barnes_hut_tree&) = delete;
+    barnes_hut_tree& operator =(_In_ const barnes_hut_tree&) = delete;
+
+    typedef quad_element::quad_elements_stack_t elements_stack_t;
+
+    void __fastcall insert(_In_ const size_t id);
+    void __fastcall applyForce(_In_ const size_t id, _In_ const float repulsion, _In_ elements_stack_t* elements) const;
 
 
 private:
-    std::unique_ptr<branch> m_root;
+    node_arena& m_arena;
+    // Physical parameters of the vertices the tree is built over.
+    ARBOR physics_state* m_state;
+    branch* m_root;
     const float m_dist;
+    // Maximum depth of a branch in the tree; the root has zero depth.
+    size_t m_depth;
 };
 
 BHUT_END
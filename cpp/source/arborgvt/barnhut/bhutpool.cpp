@@ -0,0 +1,53 @@
+﻿#include "barnhut/bhutpool.h"
+
+BHUT_BEGIN
+
+/**
+ * Returns all memory blocks owned by this arena back to the private heap.
+ */
+node_arena::~node_arena()
+{
+    STLADD aligned_sse_allocator<__m128> allocator {};
+    for (auto it = m_blocks.begin(); m_blocks.end() != it; ++it)
+    {
+        allocator.deallocate(*it, 0);
+    }
+}
+
+
+/**
+ * Takes a memory chunk from this arena.
+ *
+ * Parameters:
+ * >size
+ * Size of the chunk in bytes. It must not be greater than `m_blockSize`.
+ *
+ * Returns:
+ * Pointer to the chunk aligned on a 16-byte boundary.
+ *
+ * Remarks:
+ * The method allocates a new block only when all already owned blocks are filled up. A chunk never crosses a block
+ * bound: the tail of a block that can't hold the chunk is left unused until the next `reset`.
+ */
+void* node_arena::allocate(_In_ const size_t size)
+{
+    size_t alignedSize = (size + m_alignment - 1) & ~(m_alignment - 1);
+    if (!m_blocks.size() || (m_blockSize < m_offset + alignedSize))
+    {
+        if (m_blocks.size())
+        {
+            ++m_block;
+        }
+        if (m_blocks.size() == m_block)
+        {
+            STLADD aligned_sse_allocator<__m128> allocator {};
+            m_blocks.push_back(allocator.allocate(m_blockSize / sizeof(__m128)));
+        }
+        m_offset = 0;
+    }
+    void* result = reinterpret_cast<unsigned char*> (m_blocks[m_block]) + m_offset;
+    m_offset += alignedSize;
+    return result;
+}
+
+BHUT_END
@@ -0,0 +1,66 @@
+﻿#pragma once
+#include "ns/barnhut.h"
+#include "service/stladdon.h"
+#include <utility>
+#include <vector>
+#include <xmmintrin.h>
+
+BHUT_BEGIN
+
+/**
+ * `node_arena` class is a frame-scoped storage for elements of a Barnes Hut tree.
+ *
+ * Remarks:
+ * The arena takes memory from the private heap by big blocks aligned on a 16-byte boundary and doesn't return the
+ * blocks back until the arena is destroyed. The `reset` method only rewinds the arena. Therefore after the first few
+ * frames the arena owns enough blocks to hold the whole tree, and building of a new tree doesn't touch the heap at all.
+ *
+ * The arena never calls destructors of objects created inside it. That's OK for the `branch` and `particle` classes:
+ * they don't own any resources.
+ */
+class node_arena
+{
+public:
+    node_arena() noexcept
+        :
+        m_blocks {},
+        m_block {0},
+        m_offset {0}
+    {
+    }
+
+    node_arena(_In_ const node_arena&) = delete;
+    node_arena& operator =(_In_ const node_arena&) = delete;
+    ~node_arena();
+
+    template <typename T, typename... Args>
+    T* create(_In_ Args&&... args)
+    {
+        static_assert(m_alignment >= alignof(T), "`node_arena` can't align objects of type `T`");
+        static_assert(m_blockSize >= sizeof(T), "Objects of type `T` are too big for the `node_arena`");
+        void* p = allocate(sizeof(T));
+        return new (p) T {std::forward<Args>(args)...};
+    }
+
+    void reset() noexcept
+    {
+        m_block = 0;
+        m_offset = 0;
+    }
+
+
+private:
+    typedef std::vector<__m128*, STLADD default_allocator<__m128*>> blocks_cont_t;
+
+    void* __fastcall allocate(_In_ const size_t size);
+
+    static constexpr size_t m_blockSize = 64 * 1024;
+    static constexpr size_t m_alignment = alignof(__m128);
+
+    blocks_cont_t m_blocks;
+    // Index of the block where the next object is placed, and offset (in bytes) of free space inside that block.
+    size_t m_block;
+    size_t m_offset;
+};
+
+BHUT_END
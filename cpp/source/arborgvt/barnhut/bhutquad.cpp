@@ -14,8 +14,10 @@ BHUT_BEGIN
  * The current branch.
  * >quad
  * Quad of the `b` where `p` is located.
- * >particles
- * Container with particles to be handled.
+ * >arena
+ * Storage for new elements of the tree.
+ * >pendingParticle
+ * Slot for a particle that must be inserted into the tree once `p` has been placed.
  *
  * Returns:
  * Pointer to a branch to be set as the current one.
@@ -23,7 +25,8 @@ BHUT_BEGIN
  * Remarks:
  * This is `ArborGVT::BarnesHutTree::insert` method in the original C# code.
  */
-branch* branch::handleParticle(_In_ const particle* p, _In_ branch* b, _In_ quad_index, _In_ particles_cont_t*)
+branch* branch::handleParticle(
+    _In_ const particle* p, _In_ branch* b, _In_ quad_index, _In_ node_arena*, _Inout_ particle**)
 {
     b->increaseParameters(p);
     return this;
@@ -34,8 +37,10 @@ branch* branch::handleParticle(_In_ const particle* p, _In_ branch* b, _In_ quad
  * Applies forces to Barnes Hut tree's element.
  *
  * Parmeters:
- * >v
- * Graph vertex.
+ * >state
+ * Physical parameters of graph vertices.
+ * >id
+ * Identifier of the vertex the forces are applied to.
  * >repulsion
  * Repulsion setting.
  * >dist
@@ -47,17 +52,22 @@ branch* branch::handleParticle(_In_ const particle* p, _In_ branch* b, _In_ quad
  * N/A.
  *
  * Remarks:
- * This is `ArborGVT::BarnesHutTree::applyForces` method in the original C# code.
+ * This is `ArborGVT::BarnesHutTree::applyForces` method in the original C# code, except that the direction to the
+ * vertex is normalized here, as the `particle::applyForce` method does it. The original code divided the force by the
+ * cubed distance, so the repulsion of a far branch was weaker than the repulsion of its particles.
+ *
+ * Non-empty quads are pushed in reverse order, so they're popped (and visited) in the `quad_index` order.
  */
 void branch::applyForce(
-    _In_ ARBOR vertex* v,
+    _In_ ARBOR physics_state* state,
+    _In_ const size_t id,
     _In_ const float repulsion,
     _In_ const float dist,
-    _In_ quad_elements_cont_t* elements) const
+    _In_ quad_elements_stack_t* elements) const
 {
     __m128 temp = _mm_rcp_ps(m_mass);
     temp = _mm_mul_ps(m_coordinates, temp);
-    temp = _mm_sub_ps(v->getCoordinates(), temp);
+    temp = _mm_sub_ps(state->getCoordinates(id), temp);
     __m128 temp2;
     if (simd_cpu_capabilities::sse41())
     {
@@ -78,10 +88,13 @@ void branch::applyForce(
     temp4 = _mm_shuffle_ps(temp4, temp4, 0);
     if (0b1111 == _mm_movemask_ps(_mm_cmpgt_ps(temp3, temp4)))
     {
-        elements->push_back(m_quads.at(NorthEastQuad).get());
-        elements->push_back(m_quads.at(NorthWestQuad).get());
-        elements->push_back(m_quads.at(SouthEastQuad).get());
-        elements->push_back(m_quads.at(SouthWestQuad).get());
+        for (int i = UnknownQuad; NorthEastQuad < i; --i)
+        {
+            if (m_quads[i - 1])
+            {
+                elements->push(m_quads[i - 1]);
+            }
+        }
     }
     else
     {
@@ -101,20 +114,15 @@ void branch::applyForce(
                 temp2 = _mm_mul_ps(temp, temp);
                 temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
             }
-            temp2 = _mm_rsqrt_ps(temp2);
-        }
-        else
-        {
-            temp2 = _mm_rcp_ps(temp2);
         }
-        temp = _mm_mul_ps(temp, temp2);
+        temp = _mm_mul_ps(temp, _mm_rsqrt_ps(temp2));
         value.data[0] = repulsion;
         temp2 = _mm_load_ps(value.data);
         temp2 = _mm_shuffle_ps(temp2, temp2, 0);
         temp2 = _mm_mul_ps(m_mass, temp2);
         temp = _mm_mul_ps(temp, temp2);
         temp = _mm_mul_ps(temp, _mm_rcp_ps(temp3));
-        v->applyForce(temp);
+        state->applyForce(id, temp);
     }
 }
 
@@ -183,7 +191,7 @@ _Check_return_ bool branch::getQuadContent(
 {
     if (UnknownQuad != quad)
     {
-        *element = m_quads.at(quad).get();
+        *element = m_quads[quad];
         return true;
     }
     else
@@ -223,17 +231,32 @@ void branch::increaseParameters(_In_ const particle* p) noexcept
  * The current branch.
  * >quad
  * Quad of the `b` where `p` is located.
- * >particles
- * Container with particles to be handled.
+ * >arena
+ * Storage for new elements of the tree.
+ * >pendingParticle
+ * Slot for a particle that must be inserted into the tree once `p` has been placed. This method puts itself there.
  *
  * Returns:
  * Pointer to a branch to be set as the current one.
  *
  * Remarks:
  * This is `ArborGVT::BarnesHutTree::insert` method in the original C# code.
+ *
+ * The original code re-creates the displaced particle; this one re-uses itself. After the new branch has taken this
+ * particle's place in `b`, the particle isn't referenced by the tree anymore, and it isn't deleted (the arena owns it).
+ *
+ * A single pending slot is enough: the new branch is empty, so `p` is placed into it on the very next step of
+ * `barnes_hut_tree::insert`, and the slot is released before this method can be called again.
+ *
+ * The original code sets mass and center of `b` to the ones of `p`, dropping everything `b` already contains, so far
+ * branches got wrong forces; here `p` is added to `b`, as the `branch::handleParticle` method does it.
  */
 branch* particle::handleParticle(
-    _In_ const particle* p, _In_ branch* b, _In_ quad_index quad, _In_ particles_cont_t* particles)
+    _In_ const particle* p,
+    _In_ branch* b,
+    _In_ quad_index quad,
+    _In_ node_arena* arena,
+    _Inout_ particle** pendingParticle)
 {
     __m128 origin = b->getArea();
     __m128 halfSize = _mm_sub_ps(_mm_shuffle_ps(origin, origin, 0b01001110), origin);
@@ -255,13 +278,10 @@ branch* particle::handleParticle(
     }
     temp = _mm_add_ps(origin, halfSize);
     temp = _mm_shuffle_ps(origin, temp, 0b01000100);
-    auto newBranch = std::make_unique<branch>(temp);
-    temp = p->getMass();
-    b->setMass(temp);
+    branch* newBranch = arena->create<branch>(temp);
+    b->increaseParameters(p);
     __m128 temp2 = p->getCoordinates();
-    temp = _mm_mul_ps(temp, temp2);
-    b->setCoordinates(temp);
-    if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(m_vertex->getCoordinates(), temp2))))
+    if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(getCoordinates(), temp2))))
     {
         value.data[0] = 0.08f;
         temp = _mm_load_ps(value.data);
@@ -269,16 +289,14 @@ branch* particle::handleParticle(
         __m128 coefficient = _mm_mul_ps(halfSize, temp);
         coefficient = _mm_shuffle_ps(coefficient, coefficient, 0b10001000);
         temp = ARBOR randomVector(coefficient);
-        temp = _mm_add_ps(m_vertex->getCoordinates(), temp);
+        temp = _mm_add_ps(getCoordinates(), temp);
         temp = _mm_max_ps(temp, origin);
         temp2 = _mm_add_ps(origin, halfSize);
-        m_vertex->setCoordinates(_mm_min_ps(temp, temp2));
+        m_state->setCoordinates(m_id, _mm_min_ps(temp, temp2));
     }
-    particles->push_back(std::make_unique<particle>(m_vertex));
-    branch* result = newBranch.get();
-    // The following line definitely will `delete this`.
-    b->setQuadContent(quad, std::move(newBranch));
-    return result;
+    *pendingParticle = this;
+    b->setQuadContent(quad, newBranch);
+    return newBranch;
 }
 
 
@@ -286,8 +304,10 @@ branch* particle::handleParticle(
  * Applies forces to Barnes Hut tree's element.
  *
  * Parmeters:
- * >v
- * Graph vertex.
+ * >state
+ * Physical parameters of graph vertices.
+ * >id
+ * Identifier of the vertex the forces are applied to.
  * >repulsion
  * Repulsion setting.
  * >dist
@@ -302,12 +322,13 @@ branch* particle::handleParticle(
  * This is `ArborGVT::BarnesHutTree::applyForces` method in the original C# code.
  */
 void particle::applyForce(
-    _In_ ARBOR vertex* v,
+    _In_ ARBOR physics_state* state,
+    _In_ const size_t id,
     _In_ const float repulsion,
     _In_ const float,
-    _In_ quad_elements_cont_t*) const
+    _In_ quad_elements_stack_t*) const
 {
-    __m128 temp = _mm_sub_ps(v->getCoordinates(), m_vertex->getCoordinates());
+    __m128 temp = _mm_sub_ps(state->getCoordinates(id), getCoordinates());
     __m128 temp2;
     if (simd_cpu_capabilities::sse41())
     {
@@ -344,10 +365,10 @@ void particle::applyForce(
     value.data[0] = repulsion;
     temp2 = _mm_load_ps(value.data);
     temp2 = _mm_shuffle_ps(temp2, temp2, 0);
-    temp2 = _mm_mul_ps(m_vertex->getMass(), temp2);
+    temp2 = _mm_mul_ps(getMass(), temp2);
     temp = _mm_mul_ps(temp, temp2);
     temp = _mm_mul_ps(temp, _mm_rcp_ps(temp3));
-    v->applyForce(temp);
+    state->applyForce(id, temp);
 }
 
 BHUT_END
@@ -1,11 +1,9 @@
 ﻿#pragma once
+#include "barnhut/bhutpool.h"
+#include "barnhut/bhutstack.h"
 #include "graph/vector.h"
-#include "graph/vertex.h"
+#include "graph/physics.h"
 #include "ns/barnhut.h"
-#include "service/stladdon.h"
-#include <deque>
-#include <memory>
-#include <vector>
 
 BHUT_BEGIN
 
@@ -20,6 +18,9 @@ BHUT_BEGIN
  * does. Its derived `particle` class declared this inherited default ctor as deleted, therefore caller has to assign
  * some value to element's coordinates (may be NaNs). Code will check NaNs in particles. But `branch` derived class does
  * exploits the zeroed vector.
+ *
+ * Elements of a tree are created inside a `node_arena` and are never deleted one by one: the whole tree is dropped when
+ * the arena is reset. Therefore elements refer each other by raw pointers.
  */
 class particle;
 class branch;
@@ -36,22 +37,27 @@ public:
     }
     quad_index;
 
-    typedef std::deque<std::unique_ptr<particle>, STLADD default_allocator<std::unique_ptr<particle>>> particles_cont_t;
-    typedef std::deque<const quad_element*, STLADD default_allocator<const quad_element*>> quad_elements_cont_t;
+    typedef element_stack<const quad_element*> quad_elements_stack_t;
 
     virtual ~quad_element() = default;
 
     virtual branch* __fastcall handleParticle(
-        _In_ const particle* p, _In_ branch* b, _In_ quad_index quad, _In_ particles_cont_t* particles) = 0;
+        _In_ const particle* p,
+        _In_ branch* b,
+        _In_ quad_index quad,
+        _In_ node_arena* arena,
+        _Inout_ particle** pendingParticle) = 0;
     virtual void __fastcall applyForce(
-        _In_ ARBOR vertex* v,
+        _In_ ARBOR physics_state* state,
+        _In_ const size_t id,
         _In_ const float repulsion,
         _In_ const float dist,
-        _In_ quad_elements_cont_t* elements) const = 0;
+        _In_ quad_elements_stack_t* elements) const = 0;
 
-    virtual ARBOR vertex* getVertex() const
+    // Returns identifier of the vertex this element represents; a branch doesn't represent a vertex.
+    virtual size_t getId() const
     {
-        return nullptr;
+        return static_cast<size_t> (-1);
     }
 
 
@@ -84,7 +90,7 @@ public:
         m_coordinates {ARBOR getZeroVector()},
         m_mass {ARBOR getZeroVector()},
 #endif
-        m_quads {4}
+        m_quads {}
     {
     }
 
@@ -99,18 +105,6 @@ public:
         return *this;
     }
 
-    static void* operator new(_In_ const size_t size)
-    {
-        STLADD aligned_sse_allocator<branch> allocator {};
-        return allocator.allocate(size, 0);
-    }
-
-    static void operator delete(_In_ void* p)
-    {
-        STLADD aligned_sse_allocator<branch> allocator {};
-        allocator.deallocate(p);
-    }
-
     void swap(_Inout_ branch& right) noexcept
     {
         // 'Cos this method uses XOR-swapping never call it to swap an object with itself.
@@ -127,22 +121,23 @@ public:
     }
 
     virtual branch* __fastcall handleParticle(
-        _In_ const particle* p, _In_ branch* b, _In_ quad_index, _In_ particles_cont_t*) override;
+        _In_ const particle* p, _In_ branch* b, _In_ quad_index, _In_ node_arena*, _Inout_ particle**) override;
     virtual void __fastcall applyForce(
-        _In_ ARBOR vertex* v,
+        _In_ ARBOR physics_state* state,
+        _In_ const size_t id,
         _In_ const float repulsion,
         _In_ const float dist,
-        _In_ quad_elements_cont_t* elements) const override;
+        _In_ quad_elements_stack_t* elements) const override;
 
     quad_index __fastcall getQuad(_In_ const particle* p) const noexcept;
     _Check_return_ bool __fastcall getQuadContent(
         _In_ quad_index quad, _Outptr_result_maybenull_ quad_element** element) const noexcept;
 
-    void __fastcall setQuadContent(_In_ quad_index quad, _In_ std::unique_ptr<quad_element>&& element) noexcept
+    void __fastcall setQuadContent(_In_ quad_index quad, _In_opt_ quad_element* element) noexcept
     {
         if (UnknownQuad != quad)
         {
-            m_quads.at(quad) = std::move(element);
+            m_quads[quad] = element;
         }
     }
 
@@ -153,79 +148,63 @@ public:
         return m_area;
     }
 
-    void __vectorcall setCoordinates(_In_ __m128 value) noexcept
-    {
-        m_coordinates = value;
-    }
-
-    void __vectorcall setMass(_In_ __m128 value) noexcept
-    {
-        m_mass = value;
-    }
-
 
 private:
     typedef quad_element base_class_t;
-    typedef std::vector<std::unique_ptr<quad_element>, STLADD default_allocator<std::unique_ptr<quad_element>>>
-        quads_cont_t;
 
     // Quad bound. The vectors formatted as [bottom-y, right-x, top-y, left-x].
     __m128 m_area;
     __m128 m_coordinates;
     __m128 m_mass;
-    quads_cont_t m_quads;
+    // Indexed by `quad_index`; doesn't own the elements (the `node_arena` does).
+    quad_element* m_quads[4];
 };
 
 
 class particle final: public quad_element
 {
 public:
-    explicit particle(_In_ ARBOR vertex* vertex)
+    particle(_In_ ARBOR physics_state* state, _In_ const size_t id)
         :
-        m_vertex {vertex}
-    {
-    }
-
-    static void* operator new(_In_ const size_t size)
-    {
-        STLADD aligned_sse_allocator<particle> allocator {};
-        return allocator.allocate(size, 0);
-    }
-
-    static void operator delete(_In_ void* p)
+        m_state {state},
+        m_id {id}
     {
-        STLADD aligned_sse_allocator<particle> allocator {};
-        allocator.deallocate(p);
     }
 
     virtual branch* __fastcall handleParticle(
-        _In_ const particle* p, _In_ branch* b, _In_ quad_index quad, _In_ particles_cont_t* particles) override;
+        _In_ const particle* p,
+        _In_ branch* b,
+        _In_ quad_index quad,
+        _In_ node_arena* arena,
+        _Inout_ particle** pendingParticle) override;
     virtual void __fastcall applyForce(
-        _In_ ARBOR vertex* v,
+        _In_ ARBOR physics_state* state,
+        _In_ const size_t id,
         _In_ const float repulsion,
         _In_ const float dist,
-        _In_ quad_elements_cont_t*) const override;
+        _In_ quad_elements_stack_t*) const override;
 
-    virtual ARBOR vertex* getVertex() const override
+    virtual size_t getId() const override
     {
-        return m_vertex;
+        return m_id;
     }
 
     __m128 __vectorcall getCoordinates() const noexcept
     {
-        return m_vertex->getCoordinates();
+        return m_state->getCoordinates(m_id);
     }
 
     __m128 getMass() const noexcept
     {
-        return m_vertex->getMass();
+        return m_state->getMass(m_id);
     }
 
 
 private:
     typedef quad_element base_class_t;
 
-    ARBOR vertex* m_vertex;
+    ARBOR physics_state* m_state;
+    size_t m_id;
 };
 
 BHUT_END
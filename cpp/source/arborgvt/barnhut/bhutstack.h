@@ -0,0 +1,108 @@
+﻿#pragma once
+#include "ns/barnhut.h"
+#include "service/stladdon.h"
+#include <type_traits>
+#include <utility>
+
+BHUT_BEGIN
+
+/**
+ * `element_stack` class is a fixed-capacity stack of Barnes Hut tree elements, used to walk a tree depth-first.
+ *
+ * Remarks:
+ * The stack doesn't grow while it's in use: caller (a tree) sets the capacity by the `reset` method before a walk and
+ * the `push` method doesn't check it. The `reset` method re-allocates the storage only if the requested capacity is
+ * greater than the current one. Therefore a stack that lives as long as the graph does takes memory from the private
+ * heap only when the tree grows deeper than it ever was before.
+ *
+ * `T` is a pointer to an element or an element index; it must be trivially copyable.
+ */
+template <typename T>
+class element_stack
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "`element_stack` can't hold objects of type `T`");
+
+    element_stack() noexcept
+        :
+        m_elements {nullptr},
+        m_capacity {0},
+        m_size {0}
+    {
+    }
+
+    element_stack(_In_ const element_stack&) = delete;
+
+    element_stack(_In_ element_stack&& right) noexcept
+        :
+        element_stack {}
+    {
+        right.swap(*this);
+    }
+
+    element_stack& operator =(_In_ const element_stack&) = delete;
+
+    element_stack& operator =(_In_ element_stack&& right) noexcept
+    {
+        if (this != &right)
+        {
+            right.swap(*this);
+        }
+        return *this;
+    }
+
+    ~element_stack()
+    {
+        if (m_elements)
+        {
+            STLADD default_allocator<T> allocator {};
+            allocator.deallocate(m_elements, m_capacity);
+        }
+    }
+
+    void reset(_In_ const size_t capacity)
+    {
+        m_size = 0;
+        if (m_capacity < capacity)
+        {
+            STLADD default_allocator<T> allocator {};
+            T* elements = allocator.allocate(capacity);
+            if (m_elements)
+            {
+                allocator.deallocate(m_elements, m_capacity);
+            }
+            m_elements = elements;
+            m_capacity = capacity;
+        }
+    }
+
+    void push(_In_ const T value) noexcept
+    {
+        m_elements[m_size++] = value;
+    }
+
+    T pop() noexcept
+    {
+        return m_elements[--m_size];
+    }
+
+    bool empty() const noexcept
+    {
+        return !m_size;
+    }
+
+    void swap(_Inout_ element_stack& right) noexcept
+    {
+        std::swap(m_elements, right.m_elements);
+        std::swap(m_capacity, right.m_capacity);
+        std::swap(m_size, right.m_size);
+    }
+
+
+private:
+    T* m_elements;
+    size_t m_capacity;
+    size_t m_size;
+};
+
+BHUT_END
@@ -0,0 +1,2010 @@
+﻿#include "barnhut/flattree.h"
+#include "graph/vector.h"
+#include "service/sse.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+BHUT_BEGIN
+
+/**
+ * Drops all elements of this tree and creates a new empty root branch.
+ *
+ * Parameters:
+ * >area
+ * Bound of the root branch, formatted as [bottom-y, right-x, top-y, left-x].
+ * >dist
+ * Barnes Hut theta setting.
+ * >state
+ * Physical parameters of the graph vertices to be inserted into the tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is `ArborGVT::BarnesHutTree` ctor in the original C# code.
+ */
+void flat_barnes_hut_tree::reset(_In_ __m128 area, _In_ const float dist, _In_ ARBOR physics_state* state)
+{
+    m_areas.clear();
+    m_coordinates.clear();
+    m_masses.clear();
+    m_quads.clear();
+    m_leafX.clear();
+    m_leafY.clear();
+    m_leafMasses.clear();
+    m_leafParticles.clear();
+    m_leafSizes.clear();
+    m_leafNext.clear();
+    m_leafSlots.clear();
+    m_freeLeaves.clear();
+    m_particleCoordinates.clear();
+    m_particleMasses.clear();
+    m_particleIds.clear();
+    m_particleSlots.clear();
+    m_levels.clear();
+    m_branchSlots.clear();
+    m_state = state;
+    m_dist = dist * dist;
+    m_depth = 0;
+    m_migrations = 0;
+    m_refittable = false;
+    addBranch(area, 0, m_emptyNode);
+}
+
+
+/**
+ * Treats the specified graph vertex as a particle and place it to this Barnes Hut tree.
+ *
+ * Parmeters:
+ * >id
+ * Identifier of the graph vertex.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is `ArborGVT::BarnesHutTree::insert` method in the original C# code. A vertex with NaN coordinates is silently
+ * skipped.
+ */
+void flat_barnes_hut_tree::insert(_In_ const size_t id)
+{
+    node_index_t currentParticle = static_cast<node_index_t> (m_particleIds.size());
+    m_particleCoordinates.push_back(m_state->getCoordinates(id));
+    m_particleMasses.push_back(m_state->getMasses()[id]);
+    m_particleIds.push_back(static_cast<node_index_t> (id));
+    m_particleSlots.push_back(node_index_t {m_emptyNode});
+    insertParticle(0, currentParticle);
+}
+
+
+/**
+ * Builds this tree over the specified vertices at once, using all threads of the specified pool.
+ *
+ * Parameters:
+ * >area
+ * Bound of the root branch, formatted as [bottom-y, right-x, top-y, left-x].
+ * >dist
+ * Barnes Hut theta setting.
+ * >state
+ * Physical parameters of the graph vertices.
+ * >pool
+ * Threads used to build the tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The method replaces the `reset` and `insert` calls. It takes four steps:
+ * 1) compute Morton code of each vertex (in parallel);
+ * 2) sort the codes by LSD radix sort (counting and scattering run in parallel);
+ * 3) create branches top-down, splitting sorted ranges of particles by quads (on the calling thread; this step doesn't
+ *    touch coordinates and costs few operations per branch);
+ * 4) compute masses and centers of the branches bottom-up, level by level (each level in parallel).
+ * Particles of a branch at the last Morton level have the same code, so they are placed there by `insertParticle`
+ * method, just as the `insert` method does it. Usually such a branch holds coincident vertices.
+ *
+ * The i-th particle of the tree is the vertex with the i identifier. A vertex with NaN coordinates is skipped.
+ */
+void flat_barnes_hut_tree::build(
+    _In_ __m128 area, _In_ const float dist, _In_ ARBOR physics_state* state, _In_ MISCUTIL thread_pool* pool)
+{
+    reset(area, dist, state);
+    computeMortonCodes(area, pool);
+    sortMortonCodes(pool);
+    buildBranches();
+    aggregateBranches(pool);
+    m_refittable = true;
+}
+
+
+/**
+ * Updates this tree for the new positions of the specified vertices, using all threads of the specified pool.
+ *
+ * Parameters:
+ * >area
+ * Bound of the vertices, formatted as [bottom-y, right-x, top-y, left-x].
+ * >dist
+ * Barnes Hut theta setting.
+ * >state
+ * Physical parameters of the graph vertices.
+ * >pool
+ * Threads used to update the tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The method keeps the tree built by the previous call and refits it (see the `refit` method) if it's possible. The
+ * tree is rebuilt from scratch by the `build` method if:
+ * 1) there is no tree built by the `build` method, or number of vertices has changed;
+ * 2) the `area` isn't inside the root branch anymore, or the `area` has shrunk so much that the root branch is more
+ *    than twice as large as the `area`;
+ * 3) more than 1/m_migrationsRatio of the particles have left their quads since the last rebuild.
+ * A rebuilt tree has the root branch `area` expanded by 1/m_areaMarginRatio of its size on each side, so vertices
+ * that move outward don't leave the root branch on the very next step.
+ */
+void flat_barnes_hut_tree::update(
+    _In_ __m128 area, _In_ const float dist, _In_ ARBOR physics_state* state, _In_ MISCUTIL thread_pool* pool)
+{
+    if (m_refittable && (m_state == state) && (m_particleIds.size() == state->size()))
+    {
+        __m128 root = m_areas[0];
+        __m128 temp = _mm_sub_ps(_mm_shuffle_ps(area, area, 0b01001110), area);
+        __m128 temp2 = _mm_sub_ps(_mm_shuffle_ps(root, root, 0b01001110), root);
+        temp = _mm_add_ps(temp, temp);
+        // `temp` is the doubled size of the `area`, `temp2` is size of the root branch; both vectors are formatted as
+        // [-height, -width, height, width].
+        bool inside = (0b0000 == (0b0011 & _mm_movemask_ps(_mm_cmplt_ps(area, root)))) &&
+            (0b0000 == (0b1100 & _mm_movemask_ps(_mm_cmpgt_ps(area, root)))) &&
+            (0b0000 == (0b0011 & _mm_movemask_ps(_mm_cmplt_ps(temp, temp2))));
+        if (inside && refit(pool))
+        {
+            m_dist = dist * dist;
+            return;
+        }
+    }
+
+    __m128 margin = _mm_sub_ps(_mm_shuffle_ps(area, area, 0b01001110), area);
+    sse_t value;
+    value.data[0] = 1.0f / m_areaMarginRatio;
+    __m128 temp = _mm_load_ps(value.data);
+    temp = _mm_shuffle_ps(temp, temp, 0);
+    margin = _mm_mul_ps(margin, temp);
+    build(_mm_sub_ps(area, margin), dist, state, pool);
+}
+
+
+/**
+ * Applies forces of all particles in this Barnes Hut tree to the specified vertex.
+ *
+ * Parmeters:
+ * >id
+ * Identifier of the graph vertex.
+ * >repulsion
+ * Repulsion setting.
+ * >elements
+ * Stack used to walk the tree. The method resets the stack, so its content isn't used.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is `ArborGVT::BarnesHutTree::applyForces` method in the original C# code.
+ */
+void flat_barnes_hut_tree::applyForce(
+    _In_ const size_t id, _In_ const float repulsion, _In_ elements_stack_t* elements) const
+{
+    m_state->applyForce(id, getForce(id, 0, repulsion, elements));
+}
+
+
+/**
+ * Applies forces of all particles in this Barnes Hut tree to all of them, walking the tree against itself.
+ *
+ * Parameters:
+ * >repulsion
+ * Repulsion setting.
+ * >seed
+ * Seed of the random engines.
+ * >pool
+ * Threads used to walk the tree.
+ *
+ * Returns:
+ * Number of interactions: forces of approximated elements plus forces of particles computed directly.
+ *
+ * Remarks:
+ * Centers and sizes of the leaves are computed first (see the `aggregateLeaves` method). Then the tree is split into
+ * target subtrees (see the `collectTargets` method). Each target subtree is walked against the whole tree by the
+ * `applyInteractions` method, then the forces collected by its branches are pushed down to its particles by the
+ * `pushForcesDown` method. A subtree is written by the thread that has taken it only, and threads
+ * take the subtrees one by one, so a thread that has got small subtrees takes more of them.
+ *
+ * Result doesn't depend on number of threads: the target subtrees don't depend on it, and the random engine is seeded
+ * by the `seed` and the ordinal of the subtree before each subtree is walked.
+ *
+ * Elements without awake particles (see the `countAwakeBranches` method) aren't walked as targets, and forces aren't
+ * computed for sleeping particles of the other leaves; so the walk costs about as much as the awake particles need.
+ * Sleeping particles are still sources of forces.
+ */
+size_t flat_barnes_hut_tree::applyForces(
+    _In_ const float repulsion, _In_ const uint32_t seed, _In_ MISCUTIL thread_pool* pool)
+{
+    collectTargets();
+    aggregateLeaves(pool);
+    countAwakeBranches();
+    m_branchForces.assign(m_masses.size(), ARBOR getZeroVector());
+    m_branchGradients.assign(m_masses.size(), ARBOR getZeroVector());
+    m_leafForces.assign(m_leafSizes.size(), ARBOR getZeroVector());
+    m_leafGradients.assign(m_leafSizes.size(), ARBOR getZeroVector());
+    m_particleForces.assign(m_particleMasses.size(), ARBOR getZeroVector());
+    m_interactions.resize(pool->getThreadsNumber());
+    m_walks.resize(pool->getThreadsNumber());
+    std::atomic<size_t> next {0};
+    std::atomic<size_t> result {0};
+    auto task = [this, repulsion, seed, &next, &result] (_In_ const size_t index, _In_ const size_t) -> void
+    {
+        auto interactions = &m_interactions[index];
+        auto elements = &m_walks[index];
+        size_t interactionsNumber = 0;
+        for (size_t i = next++; m_targets.size() > i; i = next++)
+        {
+            if (!isAwake(m_targets[i]))
+            {
+                continue;
+            }
+            ARBOR seedRandomVector(seed + static_cast<uint32_t> (i) + 1);
+            interactionsNumber += applyInteractions(m_targets[i], repulsion, interactions);
+            pushForcesDown(m_targets[i], elements);
+        }
+        result += interactionsNumber;
+    };
+    pool->run(task);
+    return result;
+}
+
+
+/**
+ * Computes forces of all particles in the specified element of this Barnes Hut tree, applied to the specified vertex.
+ *
+ * Parmeters:
+ * >id
+ * Identifier of the graph vertex.
+ * >element
+ * Index of the element to start the walk from (zero for the root).
+ * >repulsion
+ * Repulsion setting.
+ * >elements
+ * Stack used to walk the tree. The method resets the stack, so its content isn't used.
+ *
+ * Returns:
+ * Sum of the forces.
+ *
+ * Remarks:
+ * Math is the same as in the `branch::applyForce` and `particle::applyForce` methods, and the tree is walked
+ * depth-first just as `barnes_hut_tree::applyForce` does it (see remarks there about the stack capacity). Particles of
+ * a leaf are processed by the `getLeafForceAvx2` or `getLeafForceSse` method.
+ */
+__m128 flat_barnes_hut_tree::getForce(
+    _In_ const size_t id,
+    _In_ const node_index_t element,
+    _In_ const float repulsion,
+    _In_ elements_stack_t* elements) const
+{
+    const bool sse41 = m_sse41;
+    const __m128 coordinates = m_state->getCoordinates(id);
+    __m128 dist = _mm_load_ps1(&m_dist);
+    __m128 scaledRepulsion = _mm_load_ps1(&repulsion);
+    __m128 force = ARBOR getZeroVector();
+
+    elements->reset(3 * m_depth + 4);
+    elements->push(element);
+    while (!elements->empty())
+    {
+        node_index_t current = elements->pop();
+        if (m_leafFlag & current)
+        {
+            if (m_avx2)
+            {
+                force = _mm_add_ps(force, getLeafForceAvx2(id, coordinates, m_leafFlag ^ current, repulsion));
+            }
+            else
+            {
+                force = _mm_add_ps(force, getLeafForceSse(id, coordinates, m_leafFlag ^ current, repulsion));
+            }
+            continue;
+        }
+
+        __m128 mass = _mm_load_ps1(&m_masses[current]);
+        __m128 temp = _mm_mul_ps(m_coordinates[current], _mm_rcp_ps(mass));
+        temp = _mm_sub_ps(coordinates, temp);
+        __m128 temp2;
+        if (sse41)
+        {
+            temp2 = _mm_dp_ps(temp, temp, 0b00111111);
+        }
+        else
+        {
+            temp2 = _mm_shuffle_ps(temp, temp, 0b01000100);
+            temp2 = _mm_mul_ps(temp2, temp2);
+            temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
+        }
+        __m128 area = m_areas[current];
+        __m128 temp3 = _mm_sub_ps(_mm_shuffle_ps(area, area, 0b01001110), area);
+        temp3 = _mm_mul_ps(temp3, _mm_shuffle_ps(temp3, temp3, 0b10110001));
+        temp3 = _mm_mul_ps(temp3, _mm_rcp_ps(temp2));
+        if (0b1111 == _mm_movemask_ps(_mm_cmpgt_ps(temp3, dist)))
+        {
+            // Push the quads in reverse order, so they are visited in the `quad_index` order.
+            const node_index_t* quads = &m_quads[4 * current];
+            for (node_index_t i = m_unknownQuad; m_northEastQuad < i; --i)
+            {
+                if (m_emptyNode != quads[i - 1])
+                {
+                    elements->push(quads[i - 1]);
+                }
+            }
+            continue;
+        }
+        force = _mm_add_ps(force, getBranchForce(temp, temp2, mass, scaledRepulsion));
+    }
+    return force;
+}
+
+
+/**
+ * Computes force of a branch that is far enough from the point where the force is applied.
+ *
+ * Parameters:
+ * >difference
+ * The point minus center of the branch.
+ * >distance
+ * Squared length of the `difference`, in all four values.
+ * >mass
+ * Mass of the branch, in all four values.
+ * >repulsion
+ * Repulsion setting, in all four values.
+ *
+ * Returns:
+ * The force.
+ *
+ * Remarks:
+ * This is the `branch::applyForce` method math: the force falls off as the squared distance, just as a particle's one
+ * does, so a far branch acts like all its particles at its center.
+ */
+__m128 flat_barnes_hut_tree::getBranchForce(
+    _In_ __m128 difference, _In_ __m128 distance, _In_ const __m128 mass, _In_ const __m128 repulsion) const
+{
+    float one = 1.0f;
+    __m128 temp = _mm_max_ps(distance, _mm_load_ps1(&one));
+    if (0b1111 & _mm_movemask_ps(_mm_cmpeq_ps(distance, ARBOR getZeroVector())))
+    {
+        difference = ARBOR randomVector(1.0f);
+        if (m_sse41)
+        {
+            distance = _mm_dp_ps(difference, difference, 0b00111111);
+        }
+        else
+        {
+            distance = _mm_mul_ps(difference, difference);
+            distance = _mm_add_ps(distance, _mm_shuffle_ps(distance, distance, 0b10110001));
+        }
+    }
+    difference = _mm_mul_ps(difference, _mm_rsqrt_ps(distance));
+    difference = _mm_mul_ps(difference, _mm_mul_ps(mass, repulsion));
+    return _mm_mul_ps(difference, _mm_rcp_ps(temp));
+}
+
+
+/**
+ * Computes gradient of a repulsion force: how the force changes when the point it's applied to moves.
+ *
+ * Parameters:
+ * >difference
+ * The point minus center of the source element; it must not be zero.
+ * >distance
+ * Squared length of the `difference`, in all four values.
+ * >mass
+ * Mass of the source element, in all four values.
+ * >repulsion
+ * Repulsion setting, in all four values.
+ *
+ * Returns:
+ * The gradient (Jacobian matrix), formatted as [xx, xy, yx, yy]: the force at the point plus an offset changes by
+ * [xx * x + xy * y, yx * x + yy * y] (see the `getGradientForce` method).
+ *
+ * Remarks:
+ * The force is `difference * mass * repulsion * g`, where `g` is the cubed inverse distance (the force falls off as
+ * the squared distance), or the inverse distance inside the unit distance (the force doesn't fall off there, see the
+ * `getBranchForce` method). So the gradient is `mass * repulsion * g * (I - c * difference * difference' / distance)`,
+ * where `c` is 3 or 1 respectively.
+ */
+__m128 flat_barnes_hut_tree::getForceGradient(
+    _In_ const __m128 difference,
+    _In_ const __m128 distance,
+    _In_ const __m128 mass,
+    _In_ const __m128 repulsion) noexcept
+{
+    static const sse_t identity = {1.0f, 0.0f, 0.0f, 1.0f};
+    const float one = 1.0f;
+    const float three = 3.0f;
+    __m128 ones = _mm_load_ps1(&one);
+    __m128 near = _mm_cmplt_ps(distance, ones);
+    __m128 inverse = _mm_rsqrt_ps(distance);
+    __m128 squaredInverse = _mm_mul_ps(inverse, inverse);
+    __m128 g = _mm_or_ps(_mm_and_ps(near, inverse), _mm_andnot_ps(near, _mm_mul_ps(squaredInverse, inverse)));
+    __m128 c = _mm_or_ps(_mm_and_ps(near, ones), _mm_andnot_ps(near, _mm_load_ps1(&three)));
+    __m128 temp = _mm_mul_ps(
+        _mm_shuffle_ps(difference, difference, 0b01010000), _mm_shuffle_ps(difference, difference, 0b01000100));
+    temp = _mm_mul_ps(temp, _mm_mul_ps(c, squaredInverse));
+    temp = _mm_sub_ps(_mm_load_ps(identity.data), temp);
+    return _mm_mul_ps(temp, _mm_mul_ps(_mm_mul_ps(mass, repulsion), g));
+}
+
+
+/**
+ * Computes change of a force caused by an offset of the point the force is applied to.
+ *
+ * Parameters:
+ * >gradient
+ * Gradient of the force (see the `getForceGradient` method).
+ * >offset
+ * The offset, formatted as [x, y, 0, 0].
+ *
+ * Returns:
+ * The change of the force, formatted as [x, y, 0, 0].
+ */
+__m128 flat_barnes_hut_tree::getGradientForce(_In_ const __m128 gradient, _In_ const __m128 offset) noexcept
+{
+    __m128 temp = _mm_mul_ps(gradient, _mm_shuffle_ps(offset, offset, 0b01000100));
+    temp = _mm_hadd_ps(temp, temp);
+    return _mm_movelh_ps(temp, ARBOR getZeroVector());
+}
+
+
+/**
+ * Collects roots of the subtrees walked by the `applyForces` method as independent tasks.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The roots are the elements of the `m_targetLevel` level and the leaves above it, in the depth-first order.
+ */
+void flat_barnes_hut_tree::collectTargets()
+{
+    m_targets.clear();
+    m_targets.push_back(0);
+    for (uint32_t level = 0; m_targetLevel > level; ++level)
+    {
+        m_nextTargets.clear();
+        for (auto it = m_targets.begin(); m_targets.end() != it; ++it)
+        {
+            if (m_leafFlag & *it)
+            {
+                m_nextTargets.push_back(*it);
+                continue;
+            }
+            const node_index_t* quads = &m_quads[4 * *it];
+            for (node_index_t i = m_northEastQuad; m_unknownQuad > i; ++i)
+            {
+                if (m_emptyNode != quads[i])
+                {
+                    m_nextTargets.push_back(quads[i]);
+                }
+            }
+        }
+        m_targets.swap(m_nextTargets);
+    }
+}
+
+
+/**
+ * Computes centers and sizes of the leaf chains of this tree.
+ *
+ * Parameters:
+ * >pool
+ * Threads used to compute.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Only the first leaf of a chain gets the values, the values of the other leaves aren't used. A leaf is the first one
+ * of its chain if the quad it refers to (see `m_leafSlots`) refers to it too; a free leaf is skipped the same way.
+ * Number of awake particles of a chain is counted here too.
+ */
+void flat_barnes_hut_tree::aggregateLeaves(_In_ MISCUTIL thread_pool* pool)
+{
+    m_leafCenters.resize(m_leafSizes.size());
+    m_leafAreas.resize(m_leafSizes.size());
+    m_leafTotalMasses.resize(m_leafSizes.size());
+    m_leafAwake.resize(m_leafSizes.size());
+    auto task = [this] (_In_ const size_t index, _In_ const size_t count) -> void
+    {
+        size_t size = m_leafSizes.size();
+        size_t last = size * (index + 1) / count;
+        for (size_t i = size * index / count; last > i; ++i)
+        {
+            node_index_t head = static_cast<node_index_t> (i);
+            if ((m_leafFlag | head) != m_quads[m_leafSlots[head]])
+            {
+                continue;
+            }
+            float mass = 0.0f;
+            float x = 0.0f;
+            float y = 0.0f;
+            float left = std::numeric_limits<float>::max();
+            float right = -std::numeric_limits<float>::max();
+            float top = left;
+            float bottom = right;
+            node_index_t awake = 0;
+            for (node_index_t leaf = head; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+            {
+                const size_t first = m_leafStride * leaf;
+                const size_t last = first + m_leafSizes[leaf];
+                for (size_t j = first; last > j; ++j)
+                {
+                    awake += m_state->getSleeping(m_particleIds[m_leafParticles[j]]) ? 0 : 1;
+                    mass += m_leafMasses[j];
+                    x += m_leafX[j] * m_leafMasses[j];
+                    y += m_leafY[j] * m_leafMasses[j];
+                    left = std::min(left, m_leafX[j]);
+                    right = std::max(right, m_leafX[j]);
+                    top = std::min(top, m_leafY[j]);
+                    bottom = std::max(bottom, m_leafY[j]);
+                }
+            }
+            sse_t value = {x / mass, y / mass, 0.0f, 0.0f};
+            m_leafCenters[head] = _mm_load_ps(value.data);
+            m_leafAreas[head] = (right - left) * (bottom - top);
+            m_leafTotalMasses[head] = mass;
+            m_leafAwake[head] = awake;
+        }
+    };
+    pool->run(task);
+}
+
+
+/**
+ * Counts awake particles of each branch of this tree.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The `aggregateLeaves` method must be called first. A branch is always added after its parent one, so the branches
+ * are processed in reverse order of their indices, and each branch sums up its quads which are already counted.
+ * Detached branches (see the `detachElement` method) get their counts too, but they're never walked.
+ */
+void flat_barnes_hut_tree::countAwakeBranches()
+{
+    m_branchAwake.resize(m_masses.size());
+    for (size_t i = m_masses.size(); i--;)
+    {
+        const node_index_t* quads = &m_quads[4 * i];
+        node_index_t awake = 0;
+        for (node_index_t quad = m_northEastQuad; m_unknownQuad > quad; ++quad)
+        {
+            node_index_t element = quads[quad];
+            if (m_emptyNode != element)
+            {
+                awake += (m_leafFlag & element) ? m_leafAwake[m_leafFlag ^ element] : m_branchAwake[element];
+            }
+        }
+        m_branchAwake[i] = awake;
+    }
+}
+
+
+/**
+ * Wakes up sleeping particles of each leaf chain that has a moving particle.
+ *
+ * Parameters:
+ * >pool
+ * Threads used to walk the leaves.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The tree must be built (or updated) for the current positions of the vertices, and the `ARBOR
+ * physics_state::updateRest` method must have been called for them. A leaf chain is the smallest cell of the tree, so
+ * a vertex moving into a cell or inside it wakes up its neighbours there (vertices with NaN coordinates aren't in the
+ * tree and aren't woken up this way). Each particle belongs to one chain, so chains are processed in parallel.
+ */
+void flat_barnes_hut_tree::wakeNeighbors(_In_ MISCUTIL thread_pool* pool)
+{
+    auto task = [this] (_In_ const size_t index, _In_ const size_t count) -> void
+    {
+        size_t size = m_leafSizes.size();
+        size_t last = size * (index + 1) / count;
+        for (size_t i = size * index / count; last > i; ++i)
+        {
+            node_index_t head = static_cast<node_index_t> (i);
+            if ((m_leafFlag | head) != m_quads[m_leafSlots[head]])
+            {
+                continue;
+            }
+            bool moving = false;
+            for (node_index_t leaf = head; !moving && (m_emptyNode != leaf); leaf = m_leafNext[leaf])
+            {
+                const size_t first = m_leafStride * leaf;
+                const size_t last = first + m_leafSizes[leaf];
+                for (size_t j = first; !moving && (last > j); ++j)
+                {
+                    moving = m_state->getMoving(m_particleIds[m_leafParticles[j]]);
+                }
+            }
+            if (!moving)
+            {
+                continue;
+            }
+            for (node_index_t leaf = head; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+            {
+                const size_t first = m_leafStride * leaf;
+                const size_t last = first + m_leafSizes[leaf];
+                for (size_t j = first; last > j; ++j)
+                {
+                    m_state->wake(m_particleIds[m_leafParticles[j]]);
+                }
+            }
+        }
+    };
+    pool->run(task);
+}
+
+
+/**
+ * Walks the specified target subtree against the whole tree and collects forces applied to the subtree elements.
+ *
+ * Parameters:
+ * >target
+ * Root of the target subtree.
+ * >repulsion
+ * Repulsion setting.
+ * >interactions
+ * Stack of element pairs. The method resets the stack, so its content isn't used.
+ *
+ * Returns:
+ * Number of interactions (see the `applyForces` method).
+ *
+ * Remarks:
+ * The walk starts from the (target, root) pair. Two elements are far enough from each other if the sum of their areas
+ * divided by the squared distance between their centers isn't greater than theta. That's the criterion of the
+ * `applyForce` method, where the vertex is an element of zero area. Area of a leaf chain is the bounding box of its
+ * particles (see the `aggregateLeaves` method). Force of the source element and its gradient, computed at the center of
+ * the target element, are added to the `m_branchForces` and `m_branchGradients` elements of the target branch, or to
+ * the `m_leafForces` and `m_leafGradients` elements of the target leaf chain. Without the gradient the error of a pair
+ * would grow as size of the target divided by the distance, not as its square, and the walk would be far less accurate
+ * than the single tree walk with the same theta.
+ * A source branch is approximated by the `branch::applyForce` math, and a source leaf is approximated by the
+ * `particle::applyForce` math (as if all its particles were at its center). Otherwise the larger element of the pair is
+ * opened; a leaf can't be opened, so the other element is opened for it, and particles of two leaves interact
+ * directly.
+ *
+ * Each pair opens one element, so depth of the pairs tree isn't greater than sum of depths of both trees, and each
+ * level of it adds at most three elements to the stack.
+ */
+size_t flat_barnes_hut_tree::applyInteractions(
+    _In_ const node_index_t target, _In_ const float repulsion, _In_ element_stack<interaction>* interactions)
+{
+    size_t result = 0;
+    const bool sse41 = m_sse41;
+    __m128 dist = _mm_load_ps1(&m_dist);
+    __m128 scaledRepulsion = _mm_load_ps1(&repulsion);
+    const __m128 zero = ARBOR getZeroVector();
+
+    interactions->reset(6 * m_depth + 10);
+    interactions->push({target, 0});
+    while (!interactions->empty())
+    {
+        interaction pair = interactions->pop();
+        if (!isAwake(pair.target))
+        {
+            continue;
+        }
+        const bool targetLeaf = 0 != (m_leafFlag & pair.target);
+        const bool sourceLeaf = 0 != (m_leafFlag & pair.source);
+        __m128 targetCenter;
+        __m128 targetSize;
+        __m128 sourceCenter;
+        __m128 sourceSize;
+        __m128 mass;
+        getElementBound(pair.target, &targetCenter, &targetSize, &mass);
+        getElementBound(pair.source, &sourceCenter, &sourceSize, &mass);
+        __m128 temp = _mm_sub_ps(targetCenter, sourceCenter);
+        __m128 temp2;
+        if (sse41)
+        {
+            temp2 = _mm_dp_ps(temp, temp, 0b00111111);
+        }
+        else
+        {
+            temp2 = _mm_shuffle_ps(temp, temp, 0b01000100);
+            temp2 = _mm_mul_ps(temp2, temp2);
+            temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
+        }
+        __m128 temp3 = _mm_mul_ps(_mm_add_ps(sourceSize, targetSize), _mm_rcp_ps(temp2));
+        bool far = 0b1111 != _mm_movemask_ps(_mm_cmpgt_ps(temp3, dist));
+        if (sourceLeaf)
+        {
+            // A source leaf may have zero area, but a random direction is chosen for coincident particles only.
+            far = far && (0b1111 != _mm_movemask_ps(_mm_cmpeq_ps(temp2, zero)));
+        }
+        if (far)
+        {
+            __m128 gradient = getForceGradient(temp, temp2, mass, scaledRepulsion);
+            if (sourceLeaf)
+            {
+                temp2 = _mm_rsqrt_ps(temp2);
+                temp = _mm_mul_ps(temp, temp2);
+                temp2 = _mm_mul_ps(temp2, temp2);
+                temp = _mm_mul_ps(temp, _mm_mul_ps(mass, scaledRepulsion));
+                float one = 1.0f;
+                temp = _mm_mul_ps(temp, _mm_min_ps(temp2, _mm_load_ps1(&one)));
+            }
+            else
+            {
+                temp = getBranchForce(temp, temp2, mass, scaledRepulsion);
+            }
+            if (targetLeaf)
+            {
+                node_index_t leaf = m_leafFlag ^ pair.target;
+                m_leafForces[leaf] = _mm_add_ps(m_leafForces[leaf], temp);
+                m_leafGradients[leaf] = _mm_add_ps(m_leafGradients[leaf], gradient);
+            }
+            else
+            {
+                m_branchForces[pair.target] = _mm_add_ps(m_branchForces[pair.target], temp);
+                m_branchGradients[pair.target] = _mm_add_ps(m_branchGradients[pair.target], gradient);
+            }
+            ++result;
+            continue;
+        }
+        if (targetLeaf && sourceLeaf)
+        {
+            result += applyLeafInteraction(m_leafFlag ^ pair.target, m_leafFlag ^ pair.source, repulsion);
+            continue;
+        }
+
+        // Push the quads in reverse order, so they are visited in the `quad_index` order.
+        if (targetLeaf || (!sourceLeaf && _mm_comige_ss(sourceSize, targetSize)))
+        {
+            const node_index_t* quads = &m_quads[4 * pair.source];
+            for (node_index_t i = m_unknownQuad; m_northEastQuad < i; --i)
+            {
+                if (m_emptyNode != quads[i - 1])
+                {
+                    interactions->push({pair.target, quads[i - 1]});
+                }
+            }
+        }
+        else
+        {
+            const node_index_t* quads = &m_quads[4 * pair.target];
+            for (node_index_t i = m_unknownQuad; m_northEastQuad < i; --i)
+            {
+                if (m_emptyNode != quads[i - 1])
+                {
+                    interactions->push({quads[i - 1], pair.source});
+                }
+            }
+        }
+    }
+    return result;
+}
+
+
+/**
+ * Gets center, area and mass of the specified element of this tree.
+ *
+ * Parameters:
+ * >element
+ * Index of a branch, or index of a leaf chain marked by `m_leafFlag`.
+ * >center
+ * Receives center of the element (mass-weighted), formatted as {x, y, 0, 0}.
+ * >size
+ * Receives area of the element in all four values: area of a branch quad, or area of the bounding box of a leaf chain
+ * particles.
+ * >mass
+ * Receives mass of the element in all four values.
+ *
+ * Returns:
+ * N/A.
+ */
+void flat_barnes_hut_tree::getElementBound(
+    _In_ const node_index_t element, _Out_ __m128* center, _Out_ __m128* size, _Out_ __m128* mass) const
+{
+    if (m_leafFlag & element)
+    {
+        *center = m_leafCenters[m_leafFlag ^ element];
+        *size = _mm_load_ps1(&m_leafAreas[m_leafFlag ^ element]);
+        *mass = _mm_load_ps1(&m_leafTotalMasses[m_leafFlag ^ element]);
+    }
+    else
+    {
+        *mass = _mm_load_ps1(&m_masses[element]);
+        *center = _mm_mul_ps(m_coordinates[element], _mm_rcp_ps(*mass));
+        __m128 area = m_areas[element];
+        __m128 temp = _mm_sub_ps(_mm_shuffle_ps(area, area, 0b01001110), area);
+        *size = _mm_mul_ps(temp, _mm_shuffle_ps(temp, temp, 0b10110001));
+    }
+}
+
+
+/**
+ * Applies repulsion of all particles of the source leaf chain to all particles of the target leaf chain.
+ *
+ * Parameters:
+ * >target
+ * Index of the first leaf of the target chain.
+ * >source
+ * Index of the first leaf of the source chain.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Number of the particle pairs.
+ *
+ * Remarks:
+ * The forces are added to the `m_particleForces` elements of the target particles. Sleeping target particles are
+ * skipped.
+ */
+size_t flat_barnes_hut_tree::applyLeafInteraction(
+    _In_ node_index_t target, _In_ const node_index_t source, _In_ const float repulsion)
+{
+    size_t sourceSize = 0;
+    for (node_index_t leaf = source; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+    {
+        sourceSize += m_leafSizes[leaf];
+    }
+    size_t result = 0;
+    for (; m_emptyNode != target; target = m_leafNext[target])
+    {
+        const size_t first = m_leafStride * target;
+        const size_t last = first + m_leafSizes[target];
+        for (size_t i = first; last > i; ++i)
+        {
+            node_index_t particle = m_leafParticles[i];
+            size_t id = m_particleIds[particle];
+            if (m_state->getSleeping(id))
+            {
+                continue;
+            }
+            result += sourceSize;
+            __m128 force = m_avx2 ?
+                getLeafForceAvx2(id, m_state->getCoordinates(id), source, repulsion) :
+                getLeafForceSse(id, m_state->getCoordinates(id), source, repulsion);
+            m_particleForces[particle] = _mm_add_ps(m_particleForces[particle], force);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * Applies forces collected by the specified target subtree to its particles.
+ *
+ * Parameters:
+ * >target
+ * Root of the target subtree.
+ * >elements
+ * Stack used to walk the subtree. The method resets the stack, so its content isn't used.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Force of a branch, corrected by its gradient for the center of a child branch, is added to force of the child
+ * before it's visited, and the gradient is added to the child's one; so each particle gets forces of all branches
+ * above it inside the subtree, corrected for the place of the particle. Elements without awake particles are
+ * skipped.
+ */
+void flat_barnes_hut_tree::pushForcesDown(_In_ const node_index_t target, _In_ elements_stack_t* elements)
+{
+    elements->reset(3 * m_depth + 4);
+    elements->push(target);
+    while (!elements->empty())
+    {
+        node_index_t element = elements->pop();
+        if (m_leafFlag & element)
+        {
+            // Only the target itself may be a leaf here.
+            __m128 zero = ARBOR getZeroVector();
+            applyLeafForces(m_leafFlag ^ element, zero, zero, zero);
+            continue;
+        }
+        __m128 force = m_branchForces[element];
+        __m128 gradient = m_branchGradients[element];
+        __m128 center;
+        __m128 size;
+        __m128 mass;
+        getElementBound(element, &center, &size, &mass);
+        const node_index_t* quads = &m_quads[4 * element];
+        for (node_index_t i = m_northEastQuad; m_unknownQuad > i; ++i)
+        {
+            if ((m_emptyNode == quads[i]) || !isAwake(quads[i]))
+            {
+                continue;
+            }
+            if (m_leafFlag & quads[i])
+            {
+                applyLeafForces(m_leafFlag ^ quads[i], force, gradient, center);
+            }
+            else
+            {
+                __m128 childCenter;
+                getElementBound(quads[i], &childCenter, &size, &mass);
+                __m128 temp = _mm_add_ps(force, getGradientForce(gradient, _mm_sub_ps(childCenter, center)));
+                m_branchForces[quads[i]] = _mm_add_ps(m_branchForces[quads[i]], temp);
+                m_branchGradients[quads[i]] = _mm_add_ps(m_branchGradients[quads[i]], gradient);
+                elements->push(quads[i]);
+            }
+        }
+    }
+}
+
+
+/**
+ * Applies forces collected by the particles of the specified leaf chain to their vertices.
+ *
+ * Parameters:
+ * >leaf
+ * Index of the first leaf of the chain.
+ * >force
+ * Force of the branches above the leaf at the `center`.
+ * >gradient
+ * Gradient of the `force` (see the `getForceGradient` method).
+ * >center
+ * The point the `force` has been computed at.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Force of the branches is moved to the center of the chain and added to the force the chain has collected itself,
+ * then each particle gets that force corrected by the gradient for its place, plus the forces it has collected itself.
+ * Sleeping particles are skipped.
+ */
+void flat_barnes_hut_tree::applyLeafForces(
+    _In_ node_index_t leaf, _In_ __m128 force, _In_ __m128 gradient, _In_ const __m128 center)
+{
+    __m128 leafCenter = m_leafCenters[leaf];
+    force = _mm_add_ps(force, getGradientForce(gradient, _mm_sub_ps(leafCenter, center)));
+    force = _mm_add_ps(force, m_leafForces[leaf]);
+    gradient = _mm_add_ps(gradient, m_leafGradients[leaf]);
+    for (; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+    {
+        const size_t first = m_leafStride * leaf;
+        const size_t last = first + m_leafSizes[leaf];
+        for (size_t i = first; last > i; ++i)
+        {
+            node_index_t particle = m_leafParticles[i];
+            size_t id = m_particleIds[particle];
+            if (!m_state->getSleeping(id))
+            {
+                __m128 coordinates = _mm_unpacklo_ps(_mm_load_ss(&m_leafX[i]), _mm_load_ss(&m_leafY[i]));
+                __m128 temp = _mm_add_ps(force, getGradientForce(gradient, _mm_sub_ps(coordinates, leafCenter)));
+                m_state->applyForce(id, _mm_add_ps(m_particleForces[particle], temp));
+            }
+        }
+    }
+}
+
+
+/**
+ * Computes repulsion of all particles of the specified leaf chain, using AVX2 instructions.
+ *
+ * Parameters:
+ * >id
+ * Identifier of the graph vertex.
+ * >coordinates
+ * Coordinates of the `id` vertex.
+ * >leaf
+ * Index of the first leaf of the chain.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Sum of the forces.
+ *
+ * Remarks:
+ * Math is the same as in the `particle::applyForce` method, eight particles at once. Lanes past the leaf size are
+ * masked out. A particle that has the same coordinates as the `id` vertex has is passed to the `getCoincidentForce`
+ * method.
+ */
+__m128 flat_barnes_hut_tree::getLeafForceAvx2(
+    _In_ const size_t id, _In_ const __m128 coordinates, _In_ node_index_t leaf, _In_ const float repulsion) const
+{
+    alignas(32) static const float lanes[8] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+    const __m256 laneIndices = _mm256_load_ps(lanes);
+    const float one = 1.0f;
+    const __m256 ones = _mm256_broadcast_ss(&one);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 scaledRepulsion = _mm256_broadcast_ss(&repulsion);
+    sse_t value;
+    _mm_store_ps(value.data, coordinates);
+    const __m256 x = _mm256_broadcast_ss(&value.data[0]);
+    const __m256 y = _mm256_broadcast_ss(&value.data[1]);
+    __m256 forceX = zero;
+    __m256 forceY = zero;
+    __m128 result = ARBOR getZeroVector();
+    for (; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+    {
+        const size_t first = m_leafStride * leaf;
+        const size_t size = m_leafSizes[leaf];
+        for (size_t i = 0; size > i; i += 8)
+        {
+            __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(&m_leafX[first + i]));
+            __m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(&m_leafY[first + i]));
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            float rest = static_cast<float> (size - i);
+            __m256 mask = _mm256_cmp_ps(laneIndices, _mm256_broadcast_ss(&rest), _CMP_LT_OQ);
+            __m256 coincident = _mm256_and_ps(_mm256_cmp_ps(distance, zero, _CMP_EQ_OQ), mask);
+            mask = _mm256_andnot_ps(coincident, mask);
+            // force = (coordinates - particle) / |coordinates - particle| * mass * repulsion / max(distance^2, 1)
+            __m256 temp = _mm256_mul_ps(_mm256_loadu_ps(&m_leafMasses[first + i]), scaledRepulsion);
+            temp = _mm256_mul_ps(temp, _mm256_rcp_ps(_mm256_max_ps(distance, ones)));
+            temp = _mm256_mul_ps(temp, _mm256_rcp_ps(_mm256_sqrt_ps(distance)));
+            forceX = _mm256_add_ps(forceX, _mm256_and_ps(_mm256_mul_ps(dx, temp), mask));
+            forceY = _mm256_add_ps(forceY, _mm256_and_ps(_mm256_mul_ps(dy, temp), mask));
+            for (int bits = _mm256_movemask_ps(coincident); bits; bits &= bits - 1)
+            {
+                unsigned long index;
+                _BitScanForward(&index, bits);
+                result = _mm_add_ps(result, getCoincidentForce(id, first + i + index, repulsion));
+            }
+        }
+    }
+    __m128 temp = _mm_add_ps(_mm256_castps256_ps128(forceX), _mm256_extractf128_ps(forceX, 1));
+    __m128 temp2 = _mm_add_ps(_mm256_castps256_ps128(forceY), _mm256_extractf128_ps(forceY, 1));
+    _mm256_zeroupper();
+    temp = _mm_hadd_ps(temp, temp2);
+    temp = _mm_hadd_ps(temp, temp);
+    return _mm_add_ps(result, _mm_movelh_ps(temp, ARBOR getZeroVector()));
+}
+
+
+/**
+ * Computes repulsion of all particles of the specified leaf chain, using SSE instructions.
+ *
+ * Parameters:
+ * >id
+ * Identifier of the graph vertex.
+ * >coordinates
+ * Coordinates of the `id` vertex.
+ * >leaf
+ * Index of the first leaf of the chain.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Sum of the forces.
+ *
+ * Remarks:
+ * This is the `getLeafForceAvx2` method for CPUs without AVX2 support, four particles at once.
+ */
+__m128 flat_barnes_hut_tree::getLeafForceSse(
+    _In_ const size_t id, _In_ const __m128 coordinates, _In_ node_index_t leaf, _In_ const float repulsion) const
+{
+    static const sse_t lanes = {0.0f, 1.0f, 2.0f, 3.0f};
+    const __m128 laneIndices = _mm_load_ps(lanes.data);
+    const float one = 1.0f;
+    const __m128 ones = _mm_load_ps1(&one);
+    const __m128 zero = ARBOR getZeroVector();
+    const __m128 scaledRepulsion = _mm_load_ps1(&repulsion);
+    const __m128 x = _mm_shuffle_ps(coordinates, coordinates, 0);
+    const __m128 y = _mm_shuffle_ps(coordinates, coordinates, 0b01010101);
+    __m128 forceX = zero;
+    __m128 forceY = zero;
+    __m128 result = zero;
+    for (; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+    {
+        const size_t first = m_leafStride * leaf;
+        const size_t size = m_leafSizes[leaf];
+        for (size_t i = 0; size > i; i += 4)
+        {
+            __m128 dx = _mm_sub_ps(x, _mm_loadu_ps(&m_leafX[first + i]));
+            __m128 dy = _mm_sub_ps(y, _mm_loadu_ps(&m_leafY[first + i]));
+            __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            float rest = static_cast<float> (size - i);
+            __m128 mask = _mm_cmplt_ps(laneIndices, _mm_load_ps1(&rest));
+            __m128 coincident = _mm_and_ps(_mm_cmpeq_ps(distance, zero), mask);
+            mask = _mm_andnot_ps(coincident, mask);
+            __m128 temp = _mm_mul_ps(_mm_loadu_ps(&m_leafMasses[first + i]), scaledRepulsion);
+            temp = _mm_mul_ps(temp, _mm_rcp_ps(_mm_max_ps(distance, ones)));
+            temp = _mm_mul_ps(temp, _mm_rcp_ps(_mm_sqrt_ps(distance)));
+            forceX = _mm_add_ps(forceX, _mm_and_ps(_mm_mul_ps(dx, temp), mask));
+            forceY = _mm_add_ps(forceY, _mm_and_ps(_mm_mul_ps(dy, temp), mask));
+            for (int bits = _mm_movemask_ps(coincident); bits; bits &= bits - 1)
+            {
+                unsigned long index;
+                _BitScanForward(&index, bits);
+                result = _mm_add_ps(result, getCoincidentForce(id, first + i + index, repulsion));
+            }
+        }
+    }
+    __m128 temp = _mm_hadd_ps(forceX, forceY);
+    temp = _mm_hadd_ps(temp, temp);
+    return _mm_add_ps(result, _mm_movelh_ps(temp, zero));
+}
+
+
+/**
+ * Computes repulsion of a particle that has the same coordinates as the specified vertex has.
+ *
+ * Parameters:
+ * >id
+ * Identifier of the graph vertex.
+ * >position
+ * Index of the particle in the leaf arrays.
+ * >repulsion
+ * Repulsion setting.
+ *
+ * Returns:
+ * Zero vector if the particle is the `id` vertex itself; otherwise force of the particle in a random direction.
+ */
+__m128 flat_barnes_hut_tree::getCoincidentForce(
+    _In_ const size_t id, _In_ const size_t position, _In_ const float repulsion) const
+{
+    if (id == m_particleIds[m_leafParticles[position]])
+    {
+        return ARBOR getZeroVector();
+    }
+    __m128 temp = ARBOR randomVector(1.0f);
+    __m128 temp2 = _mm_mul_ps(temp, temp);
+    temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
+    temp = _mm_mul_ps(temp, _mm_rcp_ps(_mm_sqrt_ps(temp2)));
+    float scale = m_leafMasses[position] * repulsion;
+    temp = _mm_mul_ps(temp, _mm_load_ps1(&scale));
+    return _mm_movelh_ps(temp, ARBOR getZeroVector());
+}
+
+
+/**
+ * Refits this tree for the new positions of its particles.
+ *
+ * Parameters:
+ * >pool
+ * Threads used to refit the tree.
+ *
+ * Returns:
+ * `false` if the tree must be rebuilt, because too many particles have left their quads; in this case the tree
+ * remains unchanged except for the particle arrays. `true` if the tree is refitted.
+ *
+ * Remarks:
+ * The i-th particle takes coordinates and mass of the vertex with the i identifier in the `m_state`. Then each particle
+ * is checked (in parallel) whether it's still inside the quad of its leaf. Particles that aren't are removed from the
+ * tree and inserted again, in index order on the calling thread, by the `insertParticle` method. After that masses and
+ * centers of all branches are computed again by the `aggregateBranches` method.
+ *
+ * Leaves left empty by the removed particles are reused by the next `addLeaf` calls. Branches left empty are detached
+ * from the tree; they remain in the arrays until the next rebuild.
+ */
+bool flat_barnes_hut_tree::refit(_In_ MISCUTIL thread_pool* pool)
+{
+    const size_t count = m_state->size();
+    m_migrants.resize(count);
+    auto task = [this, count] (_In_ const size_t index, _In_ const size_t threads) -> void
+    {
+        size_t last = count * (index + 1) / threads;
+        for (size_t i = count * index / threads; last > i; ++i)
+        {
+            __m128 coordinates = m_state->getCoordinates(i);
+            m_particleCoordinates[i] = coordinates;
+            m_particleMasses[i] = m_state->getMasses()[i];
+            m_particleIds[i] = static_cast<node_index_t> (i);
+            node_index_t position = m_particleSlots[i];
+            if (m_emptyNode == position)
+            {
+                // The particle is outside the tree because its coordinates were NaN.
+                m_migrants[i] = (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinates, coordinates))));
+            }
+            else
+            {
+                _mm_store_ss(&m_leafX[position], coordinates);
+                _mm_store_ss(&m_leafY[position], _mm_shuffle_ps(coordinates, coordinates, 0b01010101));
+                m_leafMasses[position] = m_particleMasses[i];
+                node_index_t slot = m_leafSlots[position / m_leafStride];
+                __m128 area = getQuadArea(m_areas[slot / 4], slot % 4);
+                int inside = _mm_movemask_ps(_mm_cmpge_ps(coordinates, area)) &
+                    _mm_movemask_ps(_mm_cmplt_ps(coordinates, _mm_shuffle_ps(area, area, 0b01001110)));
+                m_migrants[i] = (0b0011 != (0b0011 & inside));
+            }
+        }
+    };
+    pool->run(task);
+
+    size_t migrations = m_migrations + std::count(m_migrants.begin(), m_migrants.end(), node_index_t {1});
+    if (count < m_migrationsRatio * migrations)
+    {
+        return false;
+    }
+    m_migrations = migrations;
+    for (node_index_t i = 0; count > i; ++i)
+    {
+        if (m_migrants[i] && (m_emptyNode != m_particleSlots[i]))
+        {
+            removeParticle(i);
+        }
+    }
+    for (node_index_t i = 0; count > i; ++i)
+    {
+        if (m_migrants[i])
+        {
+            insertParticle(0, i);
+        }
+    }
+    aggregateBranches(pool);
+    return true;
+}
+
+
+/**
+ * Clears the specified quad and detaches the branches that become empty.
+ *
+ * Parameters:
+ * >slot
+ * Index of the quad in the `m_quads` array.
+ *
+ * Returns:
+ * N/A.
+ */
+void flat_barnes_hut_tree::detachElement(_In_ node_index_t slot)
+{
+    for (;;)
+    {
+        m_quads[slot] = m_emptyNode;
+        node_index_t branch = slot / 4;
+        const node_index_t* quads = &m_quads[4 * branch];
+        if ((!branch) || (m_emptyNode != quads[0]) || (m_emptyNode != quads[1]) || (m_emptyNode != quads[2]) ||
+            (m_emptyNode != quads[3]))
+        {
+            break;
+        }
+        slot = m_branchSlots[branch];
+    }
+}
+
+
+/**
+ * Copies coordinates and masses of the `m_state` vertices to the particle arrays and computes Morton codes of the
+ * particles.
+ *
+ * Parameters:
+ * >area
+ * Bound of the root branch, formatted as [bottom-y, right-x, top-y, left-x].
+ * >pool
+ * Threads used to compute the codes.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * A coordinate is scaled to the [0, 2^m_keyLevels) range of the root branch. Vertices outside the root's bound (if
+ * any) are clamped to the nearest cell of the grid.
+ */
+void flat_barnes_hut_tree::computeMortonCodes(_In_ __m128 area, _In_ MISCUTIL thread_pool* pool)
+{
+    const size_t count = m_state->size();
+    m_particleCoordinates.resize(count);
+    m_particleMasses.resize(count);
+    m_particleIds.resize(count);
+    m_particleSlots.resize(count);
+    m_keys.resize(count);
+    m_order.resize(count);
+    m_sortedKeys.resize(count);
+    m_sortedOrder.resize(count);
+
+    sse_t value;
+    value.data[0] = static_cast<float> (1 << m_keyLevels);
+    __m128 scale = _mm_load_ps(value.data);
+    scale = _mm_shuffle_ps(scale, scale, 0);
+    scale = _mm_div_ps(scale, _mm_sub_ps(_mm_shuffle_ps(area, area, 0b01001110), area));
+    value.data[0] = static_cast<float> ((1 << m_keyLevels) - 1);
+    __m128 maxCell = _mm_load_ps(value.data);
+    maxCell = _mm_shuffle_ps(maxCell, maxCell, 0);
+    auto task =
+        [this, area, scale, maxCell, count] (_In_ const size_t index, _In_ const size_t threads) -> void
+    {
+        const __m128 zero = ARBOR getZeroVector();
+        sse_t cell;
+        size_t last = count * (index + 1) / threads;
+        for (size_t i = count * index / threads; last > i; ++i)
+        {
+            __m128 coordinates = m_state->getCoordinates(i);
+            m_particleCoordinates[i] = coordinates;
+            m_particleMasses[i] = m_state->getMasses()[i];
+            m_particleIds[i] = static_cast<node_index_t> (i);
+            m_particleSlots[i] = m_emptyNode;
+            m_order[i] = static_cast<node_index_t> (i);
+            if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinates, coordinates))))
+            {
+                // `_mm_max_ps` returns its second operand if the first one is NaN (zero-sized root bound).
+                __m128 temp = _mm_mul_ps(_mm_sub_ps(coordinates, area), scale);
+                temp = _mm_min_ps(_mm_max_ps(temp, zero), maxCell);
+                _mm_store_ps(cell.data, temp);
+                m_keys[i] = getMortonCode(static_cast<uint32_t> (cell.data[0]), static_cast<uint32_t> (cell.data[1]));
+            }
+            else
+            {
+                m_keys[i] = m_invalidKey;
+            }
+        }
+    };
+    pool->run(task);
+}
+
+
+/**
+ * Sorts the `m_keys` array along with the `m_order` array.
+ *
+ * Parameters:
+ * >pool
+ * Threads used to sort the arrays.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is LSD radix sort with 8-bit digits. Each thread counts digits of its own contiguous range of the keys, then
+ * the calling thread turns the counters into offsets (in digit-major, thread-minor order), and each thread scatters its
+ * range to the offsets. So the sort is stable and its result doesn't depend on number of threads. A pass is skipped
+ * if all keys have the same digit.
+ */
+void flat_barnes_hut_tree::sortMortonCodes(_In_ MISCUTIL thread_pool* pool)
+{
+    const size_t threads = pool->getThreadsNumber();
+    const size_t size = m_keys.size();
+    m_histograms.resize(256 * threads);
+    for (uint32_t shift = 0; 32 > shift; shift += 8)
+    {
+        auto countTask = [this, shift, size] (_In_ const size_t index, _In_ const size_t count) -> void
+        {
+            node_index_t* histogram = &m_histograms[256 * index];
+            std::fill(histogram, histogram + 256, 0);
+            size_t last = size * (index + 1) / count;
+            for (size_t i = size * index / count; last > i; ++i)
+            {
+                ++histogram[0xff & (m_keys[i] >> shift)];
+            }
+        };
+        pool->run(countTask);
+
+        bool sorted = false;
+        node_index_t offset = 0;
+        for (size_t digit = 0; 256 > digit; ++digit)
+        {
+            node_index_t digitCount = 0;
+            for (size_t thread = 0; threads > thread; ++thread)
+            {
+                node_index_t& counter = m_histograms[256 * thread + digit];
+                node_index_t temp = counter;
+                counter = offset;
+                offset += temp;
+                digitCount += temp;
+            }
+            sorted = sorted || (size == digitCount);
+        }
+        if (sorted)
+        {
+            continue;
+        }
+
+        auto scatterTask = [this, shift, size] (_In_ const size_t index, _In_ const size_t count) -> void
+        {
+            node_index_t* histogram = &m_histograms[256 * index];
+            size_t last = size * (index + 1) / count;
+            for (size_t i = size * index / count; last > i; ++i)
+            {
+                node_index_t position = histogram[0xff & (m_keys[i] >> shift)]++;
+                m_sortedKeys[position] = m_keys[i];
+                m_sortedOrder[position] = m_order[i];
+            }
+        };
+        pool->run(scatterTask);
+        m_keys.swap(m_sortedKeys);
+        m_order.swap(m_sortedOrder);
+    }
+}
+
+
+/**
+ * Creates branches of this tree using the sorted Morton codes.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The method walks the tree depth-first. Particles of a branch form a contiguous range of the sorted arrays, and the
+ * range is split by quads with binary search of the two bits of the branch level. A quad of no more than
+ * `m_leafCapacity` particles becomes a leaf, a quad of more particles becomes a new branch. Particles with NaN
+ * coordinates are at the end of the sorted arrays, they are left out.
+ */
+void flat_barnes_hut_tree::buildBranches()
+{
+    node_index_t size = static_cast<node_index_t> (
+        std::lower_bound(m_keys.begin(), m_keys.end(), uint32_t {m_invalidKey}) - m_keys.begin());
+    if (!size)
+    {
+        return;
+    }
+
+    m_ranges.reset(3 * m_keyLevels + 4);
+    m_ranges.push(build_range {0, 0, size, 0});
+    while (!m_ranges.empty())
+    {
+        build_range range = m_ranges.pop();
+        const __m128 area = m_areas[range.branch];
+        const uint32_t shift = 2 * (m_keyLevels - 1 - range.level);
+        const uint32_t level = range.level + 1;
+        node_index_t first = range.first;
+        for (node_index_t quad = m_northEastQuad; m_unknownQuad > quad; ++quad)
+        {
+            auto lastIt = std::partition_point(
+                m_keys.begin() + first,
+                m_keys.begin() + range.last,
+                [shift, quad] (_In_ const node_index_t key) -> bool {return quad >= (0b0011 & (key >> shift));});
+            node_index_t last = static_cast<node_index_t> (lastIt - m_keys.begin());
+            if ((first < last) && (m_leafCapacity >= last - first))
+            {
+                node_index_t leaf = addLeaf(4 * range.branch + quad);
+                m_quads[4 * range.branch + quad] = m_leafFlag | leaf;
+                for (node_index_t i = first; last > i; ++i)
+                {
+                    appendParticle(leaf, m_order[i]);
+                }
+            }
+            else if (first < last)
+            {
+                node_index_t branch = addBranch(getQuadArea(area, quad), level, 4 * range.branch + quad);
+                m_quads[4 * range.branch + quad] = branch;
+                if (m_keyLevels == level)
+                {
+                    for (node_index_t i = first; last > i; ++i)
+                    {
+                        insertParticle(branch, m_order[i]);
+                    }
+                }
+                else
+                {
+                    m_ranges.push(build_range {branch, first, last, level});
+                }
+            }
+            first = last;
+        }
+    }
+}
+
+
+/**
+ * Computes mass and mass-weighted coordinates of each branch of this tree.
+ *
+ * Parameters:
+ * >pool
+ * Threads used to compute the parameters.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Branches are grouped by level (by counting sort) and the levels are processed from the deepest one up to the root.
+ * A branch depends on its own quads only, which are at the deeper level, so branches of one level are split between
+ * threads. Small levels are processed on the calling thread only.
+ */
+void flat_barnes_hut_tree::aggregateBranches(_In_ MISCUTIL thread_pool* pool)
+{
+    m_levelStarts.assign(m_depth + 2, 0);
+    for (auto it = m_levels.begin(); m_levels.end() != it; ++it)
+    {
+        ++m_levelStarts[*it + 1];
+    }
+    for (size_t i = 1; m_levelStarts.size() > i; ++i)
+    {
+        m_levelStarts[i] += m_levelStarts[i - 1];
+    }
+    m_levelBranches.resize(m_levels.size());
+    // `m_histograms` isn't used anymore, it keeps the next free position of each level.
+    m_histograms.assign(m_levelStarts.begin(), m_levelStarts.end());
+    for (node_index_t i = 0; m_levels.size() > i; ++i)
+    {
+        m_levelBranches[m_histograms[m_levels[i]]++] = i;
+    }
+
+    for (size_t level = m_depth + 1; level--;)
+    {
+        const size_t levelFirst = m_levelStarts[level];
+        const size_t levelSize = m_levelStarts[level + 1] - levelFirst;
+        auto task = [this, levelFirst, levelSize] (_In_ const size_t index, _In_ const size_t count) -> void
+        {
+            size_t last = levelFirst + levelSize * (index + 1) / count;
+            for (size_t i = levelFirst + levelSize * index / count; last > i; ++i)
+            {
+                node_index_t branch = m_levelBranches[i];
+                const node_index_t* quads = &m_quads[4 * branch];
+                float mass = 0.0f;
+                __m128 coordinates = ARBOR getZeroVector();
+                for (node_index_t quad = m_northEastQuad; m_unknownQuad > quad; ++quad)
+                {
+                    node_index_t element = quads[quad];
+                    if (m_emptyNode == element)
+                    {
+                        continue;
+                    }
+                    if (m_leafFlag & element)
+                    {
+                        sse_t sum = {0.0f, 0.0f, 0.0f, 0.0f};
+                        for (element ^= m_leafFlag; m_emptyNode != element; element = m_leafNext[element])
+                        {
+                            size_t first = m_leafStride * element;
+                            size_t last = first + m_leafSizes[element];
+                            for (size_t j = first; last > j; ++j)
+                            {
+                                mass += m_leafMasses[j];
+                                sum.data[0] += m_leafX[j] * m_leafMasses[j];
+                                sum.data[1] += m_leafY[j] * m_leafMasses[j];
+                            }
+                        }
+                        coordinates = _mm_add_ps(coordinates, _mm_load_ps(sum.data));
+                    }
+                    else
+                    {
+                        mass += m_masses[element];
+                        coordinates = _mm_add_ps(coordinates, m_coordinates[element]);
+                    }
+                }
+                m_masses[branch] = mass;
+                m_coordinates[branch] = coordinates;
+            }
+        };
+        if (m_minParallelBranches > levelSize)
+        {
+            task(0, 1);
+        }
+        else
+        {
+            pool->run(task);
+        }
+    }
+}
+
+
+/**
+ * Places the specified particle into the specified branch or its descendants.
+ *
+ * Parameters:
+ * >branch
+ * Index of the branch.
+ * >particle
+ * Index of the particle.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is `ArborGVT::BarnesHutTree::insert` method in the original C# code. Parameters of each branch on the way down
+ * are increased by the particle's ones. A particle with NaN coordinates is skipped.
+ */
+void flat_barnes_hut_tree::insertParticle(_In_ node_index_t branch, _In_ const node_index_t particle)
+{
+    for (;;)
+    {
+        node_index_t quad = getQuad(branch, particle);
+        if (m_unknownQuad == quad)
+        {
+            return;
+        }
+        increaseParameters(branch, particle);
+        node_index_t slot = 4 * branch + quad;
+        node_index_t quadContent = m_quads[slot];
+        if (m_emptyNode == quadContent)
+        {
+            node_index_t leaf = addLeaf(slot);
+            m_quads[slot] = m_leafFlag | leaf;
+            appendParticle(leaf, particle);
+            return;
+        }
+        if (m_leafFlag & quadContent)
+        {
+            node_index_t leaf = m_leafFlag ^ quadContent;
+            if ((m_leafCapacity > m_leafSizes[leaf]) || !isSplittable(branch, leaf, particle))
+            {
+                appendParticle(leaf, particle);
+                return;
+            }
+            branch = splitLeaf(branch, quad);
+        }
+        else
+        {
+            branch = quadContent;
+        }
+    }
+}
+
+
+/**
+ * Adds a new empty leaf to this tree.
+ *
+ * Parameters:
+ * >slot
+ * Index of the quad (in the `m_quads` array) that will refer to the new leaf or to the first leaf of its chain.
+ *
+ * Returns:
+ * Index of the new leaf.
+ */
+flat_barnes_hut_tree::node_index_t flat_barnes_hut_tree::addLeaf(_In_ const node_index_t slot)
+{
+    node_index_t result;
+    if (m_freeLeaves.empty())
+    {
+        result = static_cast<node_index_t> (m_leafSizes.size());
+        size_t size = m_leafStride * (result + 1);
+        m_leafX.resize(size);
+        m_leafY.resize(size);
+        m_leafMasses.resize(size);
+        m_leafParticles.resize(size);
+        m_leafSizes.push_back(0);
+        m_leafNext.push_back(node_index_t {m_emptyNode});
+        m_leafSlots.push_back(slot);
+    }
+    else
+    {
+        result = m_freeLeaves.back();
+        m_freeLeaves.pop_back();
+        m_leafSizes[result] = 0;
+        m_leafNext[result] = m_emptyNode;
+        m_leafSlots[result] = slot;
+    }
+    return result;
+}
+
+
+/**
+ * Adds the specified particle to the specified leaf.
+ *
+ * Parameters:
+ * >leaf
+ * Index of the leaf.
+ * >particle
+ * Index of the particle.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The particle is added to the last leaf of the chain; a new overflow leaf is chained if that leaf is full.
+ */
+void flat_barnes_hut_tree::appendParticle(_In_ node_index_t leaf, _In_ const node_index_t particle)
+{
+    while (m_emptyNode != m_leafNext[leaf])
+    {
+        leaf = m_leafNext[leaf];
+    }
+    if (m_leafCapacity == m_leafSizes[leaf])
+    {
+        node_index_t next = addLeaf(m_leafSlots[leaf]);
+        m_leafNext[leaf] = next;
+        leaf = next;
+    }
+    node_index_t position = static_cast<node_index_t> (m_leafStride * leaf + m_leafSizes[leaf]++);
+    __m128 coordinates = m_particleCoordinates[particle];
+    _mm_store_ss(&m_leafX[position], coordinates);
+    _mm_store_ss(&m_leafY[position], _mm_shuffle_ps(coordinates, coordinates, 0b01010101));
+    m_leafMasses[position] = m_particleMasses[particle];
+    m_leafParticles[position] = particle;
+    m_particleSlots[particle] = position;
+}
+
+
+/**
+ * Removes the specified particle from its leaf.
+ *
+ * Parameters:
+ * >particle
+ * Index of the particle.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The last particle of the leaf chain takes place of the removed one. A leaf that becomes empty is released, and if
+ * it's the first leaf of the chain, its quad is cleared by the `detachElement` method.
+ */
+void flat_barnes_hut_tree::removeParticle(_In_ const node_index_t particle)
+{
+    node_index_t position = m_particleSlots[particle];
+    node_index_t slot = m_leafSlots[position / m_leafStride];
+    node_index_t previous = m_emptyNode;
+    node_index_t leaf = m_leafFlag ^ m_quads[slot];
+    while (m_emptyNode != m_leafNext[leaf])
+    {
+        previous = leaf;
+        leaf = m_leafNext[leaf];
+    }
+    node_index_t lastPosition = static_cast<node_index_t> (m_leafStride * leaf + --m_leafSizes[leaf]);
+    if (lastPosition != position)
+    {
+        m_leafX[position] = m_leafX[lastPosition];
+        m_leafY[position] = m_leafY[lastPosition];
+        m_leafMasses[position] = m_leafMasses[lastPosition];
+        m_leafParticles[position] = m_leafParticles[lastPosition];
+        m_particleSlots[m_leafParticles[position]] = position;
+    }
+    m_particleSlots[particle] = m_emptyNode;
+    if (!m_leafSizes[leaf])
+    {
+        m_freeLeaves.push_back(leaf);
+        if (m_emptyNode == previous)
+        {
+            detachElement(slot);
+        }
+        else
+        {
+            m_leafNext[previous] = m_emptyNode;
+        }
+    }
+}
+
+
+/**
+ * Finds out whether the specified full leaf may be split to place the specified particle.
+ *
+ * Parameters:
+ * >branch
+ * Index of the branch whose quad refers to the leaf.
+ * >leaf
+ * Index of the leaf.
+ * >particle
+ * Index of the particle.
+ *
+ * Returns:
+ * `false` if the new branch would be at the level deeper than `m_maxLevel`, or all particles of the leaf have the same
+ * coordinates as the `particle` has (splitting wouldn't separate them); `true` otherwise.
+ */
+bool flat_barnes_hut_tree::isSplittable(
+    _In_ const node_index_t branch, _In_ const node_index_t leaf, _In_ const node_index_t particle) const noexcept
+{
+    if (m_maxLevel <= m_levels[branch])
+    {
+        return false;
+    }
+    sse_t value;
+    _mm_store_ps(value.data, m_particleCoordinates[particle]);
+    for (node_index_t i = leaf; m_emptyNode != i; i = m_leafNext[i])
+    {
+        size_t first = m_leafStride * i;
+        size_t last = first + m_leafSizes[i];
+        for (size_t j = first; last > j; ++j)
+        {
+            if ((value.data[0] != m_leafX[j]) || (value.data[1] != m_leafY[j]))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Replaces a full leaf in the specified quad by a new branch and moves particles of the leaf into the branch.
+ *
+ * Parameters:
+ * >branch
+ * Index of the current branch.
+ * >quad
+ * Quad of the `branch` that refers to the leaf.
+ *
+ * Returns:
+ * Index of the new branch to be set as the current one.
+ *
+ * Remarks:
+ * This is `ArborGVT::BarnesHutTree::insert` method in the original C# code (see `particle::handleParticle` method).
+ * Unlike the original code, the particles of the leaf aren't moved randomly even if they coincide; see the
+ * `isSplittable` method.
+ */
+flat_barnes_hut_tree::node_index_t flat_barnes_hut_tree::splitLeaf(
+    _In_ const node_index_t branch, _In_ const node_index_t quad)
+{
+    const node_index_t slot = 4 * branch + quad;
+    const size_t first = m_splitParticles.size();
+    for (node_index_t leaf = m_leafFlag ^ m_quads[slot]; m_emptyNode != leaf; leaf = m_leafNext[leaf])
+    {
+        auto it = m_leafParticles.begin() + m_leafStride * leaf;
+        m_splitParticles.insert(m_splitParticles.end(), it, it + m_leafSizes[leaf]);
+        m_freeLeaves.push_back(leaf);
+    }
+    const size_t last = m_splitParticles.size();
+
+    node_index_t result = addBranch(getQuadArea(m_areas[branch], quad), m_levels[branch] + 1, slot);
+    m_quads[slot] = result;
+    for (size_t i = first; last > i; ++i)
+    {
+        insertParticle(result, m_splitParticles[i]);
+    }
+    m_splitParticles.resize(first);
+    return result;
+}
+
+
+/**
+ * Computes bound of the specified quad of a branch.
+ *
+ * Parameters:
+ * >area
+ * Bound of the branch, formatted as [bottom-y, right-x, top-y, left-x].
+ * >quad
+ * Quad index.
+ *
+ * Returns:
+ * Bound of the quad, formatted as [bottom-y, right-x, top-y, left-x].
+ */
+__m128 __vectorcall flat_barnes_hut_tree::getQuadArea(_In_ __m128 area, _In_ const node_index_t quad) noexcept
+{
+    __m128 origin = area;
+    __m128 halfSize = _mm_sub_ps(_mm_shuffle_ps(origin, origin, 0b01001110), origin);
+    sse_t value;
+    value.data[0] = 0.5f;
+    __m128 temp = _mm_load_ps(value.data);
+    temp = _mm_shuffle_ps(temp, temp, 0);
+    halfSize = _mm_mul_ps(halfSize, temp);
+    temp = _mm_add_ps(origin, halfSize);
+    if ((m_northEastQuad == quad) || (m_southEastQuad == quad))
+    {
+        temp = _mm_shuffle_ps(temp, origin, 0b01100100);
+        origin = _mm_shuffle_ps(temp, origin, 0b11101100);
+    }
+    if ((m_southWestQuad == quad) || (m_southEastQuad == quad))
+    {
+        temp = _mm_shuffle_ps(temp, origin, 0b00100100);
+        origin = _mm_shuffle_ps(temp, origin, 0b11100111);
+    }
+    temp = _mm_add_ps(origin, halfSize);
+    return _mm_shuffle_ps(origin, temp, 0b01000100);
+}
+
+
+/**
+ * Interleaves bits of cell coordinates.
+ *
+ * Parameters:
+ * >x
+ * Cell column, less than 2^m_keyLevels.
+ * >y
+ * Cell row, less than 2^m_keyLevels.
+ *
+ * Returns:
+ * Morton code of the cell.
+ *
+ * Remarks:
+ * Two bits of each level are the index of the quad (see `getQuad` method): the odd bit is set for the south half and
+ * the even bit is set for the west half. So sorted codes list quads of each branch in the `quad_element::quad_index`
+ * order.
+ */
+uint32_t __fastcall flat_barnes_hut_tree::getMortonCode(_In_ const uint32_t x, _In_ const uint32_t y) noexcept
+{
+    uint32_t west = ((1 << m_keyLevels) - 1) ^ x;
+    uint32_t south = y;
+    west = 0x00ff00ff & (west | (west << 8));
+    west = 0x0f0f0f0f & (west | (west << 4));
+    west = 0x33333333 & (west | (west << 2));
+    west = 0x55555555 & (west | (west << 1));
+    south = 0x00ff00ff & (south | (south << 8));
+    south = 0x0f0f0f0f & (south | (south << 4));
+    south = 0x33333333 & (south | (south << 2));
+    south = 0x55555555 & (south | (south << 1));
+    return west | (south << 1);
+}
+
+
+/**
+ * Adds a new empty branch to this tree.
+ *
+ * Parameters:
+ * >area
+ * Bound of the new branch, formatted as [bottom-y, right-x, top-y, left-x].
+ * >level
+ * Depth of the new branch; the root has zero depth.
+ * >slot
+ * Index of the quad (in the `m_quads` array) that will refer to the new branch, `m_emptyNode` for the root.
+ *
+ * Returns:
+ * Index of the new branch.
+ */
+flat_barnes_hut_tree::node_index_t flat_barnes_hut_tree::addBranch(
+    _In_ __m128 area, _In_ const uint32_t level, _In_ const node_index_t slot)
+{
+    node_index_t result = static_cast<node_index_t> (m_masses.size());
+    m_levels.push_back(level);
+    m_branchSlots.push_back(slot);
+    if (m_depth < level)
+    {
+        m_depth = level;
+    }
+    m_areas.push_back(area);
+    m_coordinates.push_back(ARBOR getZeroVector());
+    m_masses.push_back(0.0f);
+    m_quads.insert(m_quads.end(), 4, node_index_t {m_emptyNode});
+    return result;
+}
+
+
+/**
+ * Finds out a quad in the specified branch where the specified particle is located.
+ *
+ * Parameters:
+ * >branch
+ * Index of the branch.
+ * >particle
+ * Index of the particle.
+ *
+ * Returns:
+ * Index of the quad, or `m_unknownQuad` if the particle has NaN coordinates.
+ *
+ * Remarks:
+ * This is `ArborGVT::BarnesHutTree::getQuad` method in the original C# code.
+ */
+flat_barnes_hut_tree::node_index_t flat_barnes_hut_tree::getQuad(
+    _In_ const node_index_t branch, _In_ const node_index_t particle) const noexcept
+{
+    node_index_t result;
+    __m128 coordinate = m_particleCoordinates[particle];
+    if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinate, coordinate))))
+    {
+        __m128 area = m_areas[branch];
+        __m128 temp = _mm_sub_ps(_mm_shuffle_ps(area, area, 0b01001110), area);
+        sse_t value;
+        value.data[0] = 0.5f;
+        __m128 half = _mm_load_ps(value.data);
+        half = _mm_shuffle_ps(half, half, 0);
+        temp = _mm_mul_ps(temp, half);
+        __m128 temp2 = _mm_sub_ps(coordinate, area);
+        int compare = _mm_movemask_ps(_mm_cmplt_ps(temp2, temp));
+        if (0b0001 & compare)
+        {
+            result = 0b0010 & compare ? m_northWestQuad : m_southWestQuad;
+        }
+        else
+        {
+            result = 0b0010 & compare ? m_northEastQuad : m_southEastQuad;
+        }
+    }
+    else
+    {
+        result = m_unknownQuad;
+    }
+    return result;
+}
+
+
+/**
+ * Increases parameters (mass and coordinates) of the specified branch using corresponding parameters of the specified
+ * particle.
+ *
+ * Parameters:
+ * >branch
+ * Index of the branch.
+ * >particle
+ * Index of the particle.
+ *
+ * Returns:
+ * N/A.
+ */
+void flat_barnes_hut_tree::increaseParameters(_In_ const node_index_t branch, _In_ const node_index_t particle) noexcept
+{
+    m_masses[branch] += m_particleMasses[particle];
+    __m128 temp = _mm_mul_ps(m_particleCoordinates[particle], _mm_load_ps1(&m_particleMasses[particle]));
+    m_coordinates[branch] = _mm_add_ps(m_coordinates[branch], temp);
+}
+
+BHUT_END
@@ -0,0 +1,350 @@
+﻿#pragma once
+#include "barnhut/bhutstack.h"
+#include "graph/physics.h"
+#include "ns/barnhut.h"
+#include "service/sse.h"
+#include "service/stladdon.h"
+#include "service/thrdpool.h"
+#include <cstdint>
+#include <immintrin.h>
+#include <vector>
+
+BHUT_BEGIN
+
+/**
+ * `flat_barnes_hut_tree` class is a quad tree used by Barnes Hut simulation, an alternative to `barnes_hut_tree`.
+ *
+ * Remarks:
+ * The tree doesn't have node objects at all. Branches are stored in contiguous arrays as a structure of arrays: area,
+ * mass-weighted coordinates and mass of the i-th branch are the i-th elements of `m_areas`, `m_coordinates` and
+ * `m_masses`; its quads are `m_quads[4 * i]` ... `m_quads[4 * i + 3]`. Elements refer each other by 32-bit indices
+ * (see `node_index_t` type), so neither tree building nor force walk call a virtual method or chase a pointer to a
+ * scattered heap block.
+ *
+ * Unlike `barnes_hut_tree`, a leaf holds up to `m_leafCapacity` particles (a bucket). The i-th leaf stores coordinates,
+ * masses and indices of its particles in the `m_leafStride * i` ... `m_leafStride * (i + 1) - 1` elements of the
+ * `m_leafX`, `m_leafY`, `m_leafMasses` and `m_leafParticles` arrays. The force walk computes repulsion of all
+ * particles of a leaf at once, eight particles per AVX2 instruction (or four per SSE instruction if the CPU doesn't
+ * support AVX2). A full leaf is split into a new branch when one more particle comes into it. If the leaf can't be
+ * split, because it's at `m_maxLevel` level or all its particles have the same coordinates, it's chained to an
+ * overflow leaf (see `m_leafNext`). So coincident vertices don't make the tree deeper and they aren't moved randomly
+ * as `barnes_hut_tree` does; a random direction of their repulsion is chosen by the force walk.
+ *
+ * Masses and centers of branches are exact sums of their particles; quirks of the original C# code (see the
+ * `barnes_hut_tree::insert` method) aren't reproduced.
+ *
+ * Unlike `barnes_hut_tree` an instance of this class lives as long as its owner does, and it's cleared by the `reset`
+ * method before each simulation step. The arrays keep their capacity, so building of a new tree doesn't touch the heap
+ * once the arrays have grown up to the tree size.
+ *
+ * There are two ways to build the tree. The `reset` and `insert` methods build it one particle at a time on the calling
+ * thread. The `build` method takes all particles at once and sorts them by Morton codes (Z-order of the quads), so that
+ * particles of each branch form a contiguous range of the sorted array; each step of that method runs on all threads of
+ * a pool. Masses and centers of the branches are computed after the topology is known.
+ *
+ * The `update` method keeps a tree built by the `build` method across simulation steps: while vertices move a little,
+ * it only moves particles that have left their quads and computes masses and centers of the branches again. Each
+ * particle knows its place in a leaf (see `m_particleSlots`) and each leaf and branch knows the quad that refers to it
+ * (see `m_leafSlots` and `m_branchSlots`) for that.
+ *
+ * There are two ways to apply forces too. The `applyForce` method walks the tree from the root for a single vertex.
+ * The `applyForces` method walks the tree against itself (a dual tree walk) for all particles at once: when two
+ * elements are far enough from each other, the force of one element and its gradient are computed once at the center
+ * of the other one, and the force is applied to all its particles later, corrected by the gradient for the place of
+ * each particle.
+ *
+ * Sleeping vertices (see `ARBOR physics_state`) stay in the tree as sources, but the `applyForces` method skips them as
+ * targets: a target element without awake particles isn't walked at all. The `wakeNeighbors` method wakes up sleeping
+ * particles that share a leaf chain with a moving one.
+ */
+class flat_barnes_hut_tree
+{
+public:
+    explicit flat_barnes_hut_tree(_In_ const size_t leafCapacity)
+        :
+        m_areas {},
+        m_coordinates {},
+        m_masses {},
+        m_quads {},
+        m_leafX {},
+        m_leafY {},
+        m_leafMasses {},
+        m_leafParticles {},
+        m_leafSizes {},
+        m_leafNext {},
+        m_leafSlots {},
+        m_freeLeaves {},
+        m_particleCoordinates {},
+        m_particleMasses {},
+        m_particleIds {},
+        m_particleSlots {},
+        m_levels {},
+        m_branchSlots {},
+        m_keys {},
+        m_order {},
+        m_sortedKeys {},
+        m_sortedOrder {},
+        m_histograms {},
+        m_levelBranches {},
+        m_levelStarts {},
+        m_ranges {},
+        m_migrants {},
+        m_splitParticles {},
+        m_targets {},
+        m_nextTargets {},
+        m_leafCenters {},
+        m_leafAreas {},
+        m_leafTotalMasses {},
+        m_leafAwake {},
+        m_branchAwake {},
+        m_branchForces {},
+        m_branchGradients {},
+        m_leafForces {},
+        m_leafGradients {},
+        m_particleForces {},
+        m_interactions {},
+        m_walks {},
+        m_state {nullptr},
+        m_leafCapacity {leafCapacity ? leafCapacity : 1},
+        m_leafStride {(m_leafCapacity + 7) & ~static_cast<size_t> (7)},
+        m_sse41 {simd_cpu_capabilities::sse41()},
+        m_avx2 {simd_cpu_capabilities::avx2()},
+        m_dist {0.0f},
+        m_depth {0},
+        m_migrations {0},
+        m_refittable {false}
+    {
+    }
+
+    flat_barnes_hut_tree(_In_ const flat_barnes_hut_tree&) = delete;
+    flat_barnes_hut_tree& operator =(_In_ const flat_barnes_hut_tree&) = delete;
+
+    typedef uint32_t node_index_t;
+    typedef element_stack<node_index_t> elements_stack_t;
+
+    void __vectorcall reset(_In_ __m128 area, _In_ const float dist, _In_ ARBOR physics_state* state);
+    void __fastcall insert(_In_ const size_t id);
+    void __vectorcall build(
+        _In_ __m128 area, _In_ const float dist, _In_ ARBOR physics_state* state, _In_ MISCUTIL thread_pool* pool);
+    void __vectorcall update(
+        _In_ __m128 area, _In_ const float dist, _In_ ARBOR physics_state* state, _In_ MISCUTIL thread_pool* pool);
+    void __fastcall applyForce(_In_ const size_t id, _In_ const float repulsion, _In_ elements_stack_t* elements) const;
+    size_t __fastcall applyForces(_In_ const float repulsion, _In_ const uint32_t seed, _In_ MISCUTIL thread_pool* pool);
+    void __fastcall wakeNeighbors(_In_ MISCUTIL thread_pool* pool);
+
+    // Changes the maximum number of particles in a leaf; a tree kept by the `update` method is rebuilt by its next call.
+    void setLeafCapacity(_In_ const size_t leafCapacity) noexcept
+    {
+        size_t capacity = leafCapacity ? leafCapacity : 1;
+        if (m_leafCapacity != capacity)
+        {
+            m_leafCapacity = capacity;
+            m_leafStride = (capacity + 7) & ~static_cast<size_t> (7);
+            m_refittable = false;
+        }
+    }
+
+    // Makes the next call of the `update` method rebuild the tree.
+    void discard() noexcept
+    {
+        m_refittable = false;
+    }
+
+
+private:
+    typedef std::vector<__m128, STLADD aligned_sse_allocator<__m128>> vectors_cont_t;
+    typedef std::vector<float, STLADD default_allocator<float>> floats_cont_t;
+    typedef std::vector<node_index_t, STLADD default_allocator<node_index_t>> indices_cont_t;
+
+    // Quad indices, the same as `quad_element::quad_index` values.
+    static constexpr node_index_t m_northEastQuad = 0;
+    static constexpr node_index_t m_northWestQuad = 1;
+    static constexpr node_index_t m_southEastQuad = 2;
+    static constexpr node_index_t m_southWestQuad = 3;
+    static constexpr node_index_t m_unknownQuad = 4;
+    // A quad content is either `m_emptyNode`, or index of a branch, or index of a leaf marked by `m_leafFlag`.
+    static constexpr node_index_t m_emptyNode = UINT32_MAX;
+    static constexpr node_index_t m_leafFlag = 0x80000000;
+    // A full leaf at this level is chained to an overflow leaf instead of being split.
+    static constexpr uint32_t m_maxLevel = 24;
+    // Morton code has two bits per level of the tree, so that codes of particles inside a branch of the N-th level share
+    // the first 2*N bits. The code of a particle with NaN coordinates is `m_invalidKey`.
+    static constexpr uint32_t m_keyLevels = 15;
+    static constexpr uint32_t m_invalidKey = UINT32_MAX;
+    // `build` method aggregates a level of the tree on the calling thread if the level has fewer branches.
+    static constexpr size_t m_minParallelBranches = 1024;
+    // `update` method rebuilds the tree if more than 1/m_migrationsRatio of the particles have left their quads since
+    // the last rebuild. Root branch of a tree built by that method is larger than the vertices bound by
+    // 1/m_areaMarginRatio of the bound size on each side.
+    static constexpr size_t m_migrationsRatio = 8;
+    static constexpr float m_areaMarginRatio = 8.0f;
+    // `applyForces` method walks subtrees of this level (and shallower leaves) as independent tasks.
+    static constexpr uint32_t m_targetLevel = 4;
+
+    // Range of sorted particles inside a branch of the specified level.
+    struct build_range
+    {
+        node_index_t branch;
+        node_index_t first;
+        node_index_t last;
+        uint32_t level;
+    };
+
+    // Pair of elements walked by the `applyForces` method: forces of the `source` element are applied to the particles
+    // of the `target` element.
+    struct interaction
+    {
+        node_index_t target;
+        node_index_t source;
+    };
+
+    typedef std::vector<elements_stack_t, STLADD default_allocator<elements_stack_t>> elements_stacks_cont_t;
+    typedef std::vector<
+        element_stack<interaction>, STLADD default_allocator<element_stack<interaction>>> interactions_stacks_cont_t;
+
+    static __m128 __vectorcall getQuadArea(_In_ __m128 area, _In_ const node_index_t quad) noexcept;
+    static uint32_t __fastcall getMortonCode(_In_ const uint32_t x, _In_ const uint32_t y) noexcept;
+
+    void __vectorcall computeMortonCodes(_In_ __m128 area, _In_ MISCUTIL thread_pool* pool);
+    void __fastcall sortMortonCodes(_In_ MISCUTIL thread_pool* pool);
+    void buildBranches();
+    void __fastcall aggregateBranches(_In_ MISCUTIL thread_pool* pool);
+    bool __fastcall refit(_In_ MISCUTIL thread_pool* pool);
+    void __fastcall detachElement(_In_ node_index_t slot);
+    node_index_t __vectorcall addBranch(_In_ __m128 area, _In_ const uint32_t level, _In_ const node_index_t slot);
+    node_index_t __fastcall addLeaf(_In_ const node_index_t slot);
+    void __fastcall appendParticle(_In_ node_index_t leaf, _In_ const node_index_t particle);
+    void __fastcall removeParticle(_In_ const node_index_t particle);
+    node_index_t __fastcall getQuad(_In_ const node_index_t branch, _In_ const node_index_t particle) const noexcept;
+    void __fastcall insertParticle(_In_ node_index_t branch, _In_ const node_index_t particle);
+    void __fastcall increaseParameters(_In_ const node_index_t branch, _In_ const node_index_t particle) noexcept;
+    bool __fastcall isSplittable(
+        _In_ const node_index_t branch, _In_ const node_index_t leaf, _In_ const node_index_t particle) const noexcept;
+    node_index_t __fastcall splitLeaf(_In_ const node_index_t branch, _In_ const node_index_t quad);
+    __m128 __fastcall getForce(
+        _In_ const size_t id,
+        _In_ const node_index_t element,
+        _In_ const float repulsion,
+        _In_ elements_stack_t* elements) const;
+    __m128 __vectorcall getBranchForce(
+        _In_ __m128 difference, _In_ __m128 distance, _In_ const __m128 mass, _In_ const __m128 repulsion) const;
+    static __m128 __vectorcall getForceGradient(
+        _In_ const __m128 difference,
+        _In_ const __m128 distance,
+        _In_ const __m128 mass,
+        _In_ const __m128 repulsion) noexcept;
+    static __m128 __vectorcall getGradientForce(_In_ const __m128 gradient, _In_ const __m128 offset) noexcept;
+    void collectTargets();
+    void __fastcall aggregateLeaves(_In_ MISCUTIL thread_pool* pool);
+    void countAwakeBranches();
+
+    bool isAwake(_In_ const node_index_t element) const noexcept
+    {
+        return 0 != ((m_leafFlag & element) ? m_leafAwake[m_leafFlag ^ element] : m_branchAwake[element]);
+    }
+
+    size_t __fastcall applyInteractions(
+        _In_ const node_index_t target, _In_ const float repulsion, _In_ element_stack<interaction>* interactions);
+    size_t __fastcall applyLeafInteraction(
+        _In_ node_index_t target, _In_ const node_index_t source, _In_ const float repulsion);
+    void __fastcall getElementBound(
+        _In_ const node_index_t element, _Out_ __m128* center, _Out_ __m128* size, _Out_ __m128* mass) const;
+    void __fastcall pushForcesDown(_In_ const node_index_t target, _In_ elements_stack_t* elements);
+    void __vectorcall applyLeafForces(
+        _In_ node_index_t leaf, _In_ __m128 force, _In_ __m128 gradient, _In_ const __m128 center);
+    __m128 __vectorcall getLeafForceAvx2(
+        _In_ const size_t id,
+        _In_ const __m128 coordinates,
+        _In_ node_index_t leaf,
+        _In_ const float repulsion) const;
+    __m128 __vectorcall getLeafForceSse(
+        _In_ const size_t id,
+        _In_ const __m128 coordinates,
+        _In_ node_index_t leaf,
+        _In_ const float repulsion) const;
+    __m128 __fastcall getCoincidentForce(
+        _In_ const size_t id, _In_ const size_t position, _In_ const float repulsion) const;
+
+    // Branch quad bounds. The vectors formatted as [bottom-y, right-x, top-y, left-x].
+    vectors_cont_t m_areas;
+    // Sums of mass-weighted coordinates of particles inside branches.
+    vectors_cont_t m_coordinates;
+    floats_cont_t m_masses;
+    // Four elements per branch, indexed by quad.
+    indices_cont_t m_quads;
+    // `m_leafStride` elements per leaf; the first `m_leafSizes[i]` elements of the i-th leaf are in use.
+    floats_cont_t m_leafX;
+    floats_cont_t m_leafY;
+    floats_cont_t m_leafMasses;
+    indices_cont_t m_leafParticles;
+    indices_cont_t m_leafSizes;
+    // Index of the overflow leaf chained to a leaf, or `m_emptyNode`.
+    indices_cont_t m_leafNext;
+    // Index of the quad (in the `m_quads` array) that refers to a leaf; overflow leaves have the same slot as the first
+    // leaf of their chain.
+    indices_cont_t m_leafSlots;
+    // Leaves that aren't in use anymore, `addLeaf` method takes them first.
+    indices_cont_t m_freeLeaves;
+    // Copies of vertices coordinates and masses, taken when the vertices are inserted, and identifiers of the vertices
+    // in the `m_state`.
+    vectors_cont_t m_particleCoordinates;
+    floats_cont_t m_particleMasses;
+    indices_cont_t m_particleIds;
+    // Index of a particle in the leaf arrays (`m_leafStride * leaf + i`), or `m_emptyNode` if the particle isn't in the
+    // tree (it has NaN coordinates).
+    indices_cont_t m_particleSlots;
+    // Level (depth) of each branch.
+    indices_cont_t m_levels;
+    // Index of the quad (in the `m_quads` array) that refers to a branch; `m_emptyNode` for the root.
+    indices_cont_t m_branchSlots;
+    // Working storage of the `build` method: Morton codes of particles and particle indices in the same order, buffers
+    // of the radix sort and its per-thread histograms, and branch indices grouped by level.
+    indices_cont_t m_keys;
+    indices_cont_t m_order;
+    indices_cont_t m_sortedKeys;
+    indices_cont_t m_sortedOrder;
+    indices_cont_t m_histograms;
+    indices_cont_t m_levelBranches;
+    indices_cont_t m_levelStarts;
+    element_stack<build_range> m_ranges;
+    // Working storage of the `update` method: non-zero for each particle that has left its quad.
+    indices_cont_t m_migrants;
+    // Particles of the leaves being split; `splitLeaf` method may be called recursively, each call uses the end of the
+    // array.
+    indices_cont_t m_splitParticles;
+    // Working storage of the `applyForces` method: roots of the target subtrees, centers (mass-weighted), bounding box
+    // areas, masses and numbers of awake particles of the leaf chains, numbers of awake particles of branches, forces
+    // accumulated by branches and their gradients (formatted as [xx, xy, yx, yy], see the `getForceGradient` method),
+    // the same for leaf chains (indexed by the first leaf), forces accumulated by particles, and stacks of the pool
+    // threads.
+    indices_cont_t m_targets;
+    indices_cont_t m_nextTargets;
+    vectors_cont_t m_leafCenters;
+    floats_cont_t m_leafAreas;
+    floats_cont_t m_leafTotalMasses;
+    indices_cont_t m_leafAwake;
+    indices_cont_t m_branchAwake;
+    vectors_cont_t m_branchForces;
+    vectors_cont_t m_branchGradients;
+    vectors_cont_t m_leafForces;
+    vectors_cont_t m_leafGradients;
+    vectors_cont_t m_particleForces;
+    interactions_stacks_cont_t m_interactions;
+    elements_stacks_cont_t m_walks;
+    // Physical parameters of the vertices the tree is built over; forces are applied to them.
+    ARBOR physics_state* m_state;
+    size_t m_leafCapacity;
+    // `m_leafCapacity` rounded up to eight particles, so a leaf can be read by whole AVX2 vectors.
+    size_t m_leafStride;
+    const bool m_sse41;
+    const bool m_avx2;
+    float m_dist;
+    // Maximum depth of a branch in the tree; the root has zero depth.
+    size_t m_depth;
+    // Number of particles that have left their quads since the last `build` call.
+    size_t m_migrations;
+    // `true` if the tree was built by the `build` method, so the `update` method may refit it.
+    bool m_refittable;
+};
+
+BHUT_END
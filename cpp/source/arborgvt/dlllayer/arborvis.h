@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "graph/edge.h"
+#include "graph/params.h"
 #include "graph/vertex.h"
 #include "sdkver.h"
 #include <rpc.h>
@@ -8,6 +9,33 @@
 #include <Unknwn.h>
 #include <Windows.h>
 
+/*
+ * Version of the `ARBOR vertex` and `ARBOR edge` classes a client is built with; the classes are used by the client
+ * inline, so a client built with another version must be rebuilt.
+ *
+ * Version 2: coordinates, velocity, force, mass and the fixed flag of a vertex are stored by the graph, `vertex`
+ * accessors of them forward to it. `vertex` keeps offsets of its colors, but not of its name and data.
+ */
+#define ARBORVIS_VERSION 2
+
+/**
+ * `IArborVisualEvents` interface.
+ * `IArborVisualEvents` interface is implemented by a client that wants to know when the graph simulation starts and
+ * stops. Its methods are called on the simulation thread.
+ *
+ * The `IArborVisualEvents` interface has these methods.
+ * `onStart` is called when the graph starts moving (after it has been at rest or when the simulation is started).
+ * `onStop` is called when the graph comes to rest: its energy has been below the threshold for several steps.
+ */
+MIDL_INTERFACE("11DC5009-C0F8-4465-B2A6-A4EE46414BF1")
+IArborVisualEvents: public IUnknown
+{
+public:
+    virtual void STDMETHODCALLTYPE onStart() = 0;
+    virtual void STDMETHODCALLTYPE onStop() = 0;
+};
+
+
 /**
  * `IArborVisual` interface.
  * `IArborVisual` interface represents a window object where graph representation is rendered.
@@ -58,3 +86,27 @@ public:
         _In_ bool fixed,
         _Outptr_result_maybenull_ ARBOR vertex** v) = 0;
 };
+
+
+/**
+ * `IArborVisual2` interface.
+ * `IArborVisual2` interface extends the `IArborVisual` with control of the graph simulation. `IArborVisual` is
+ * published and never changes; a client gets `IArborVisual2` from the `IArborVisual` by `QueryInterface`.
+ *
+ * The `IArborVisual2` interface has these methods.
+ * `getParameters` returns parameters of the graph simulation.
+ * `setParameters` changes parameters of the graph simulation; they take effect on the next step.
+ * `setEvents` sets (or resets) an object notified when the graph simulation starts and stops.
+ * `saveLayout` saves coordinates and velocities of the vertices to a file.
+ * `loadLayout` loads coordinates and velocities of the vertices, saved by `saveLayout`, into the graph.
+ */
+MIDL_INTERFACE("543031AE-1369-46CD-A970-8A9DA766C84F")
+IArborVisual2: public IArborVisual
+{
+public:
+    virtual HRESULT STDMETHODCALLTYPE getParameters(_Out_ ARBOR simulation_parameters* parameters) = 0;
+    virtual HRESULT STDMETHODCALLTYPE setParameters(_In_ const ARBOR simulation_parameters& parameters) = 0;
+    virtual HRESULT STDMETHODCALLTYPE setEvents(_In_opt_ IArborVisualEvents* events) = 0;
+    virtual HRESULT STDMETHODCALLTYPE saveLayout(_In_z_ LPCWSTR fileName) = 0;
+    virtual HRESULT STDMETHODCALLTYPE loadLayout(_In_z_ LPCWSTR fileName) = 0;
+};
@@ -12,6 +12,9 @@ ARBOR_BEGIN
  * Remarks:
  * An instance of the `edge` class MUST be aligned on a 16-byte boundary! To guarantee this the `edge` class overloads
  * `new` and `delete` operators.
+ *
+ * Length and stiffness of an edge are copies of the parameters of its spring (see `spring_set`); physics reads them
+ * from the spring, they're kept here for the `getLength` and `getStiffness` methods.
  */
 class edge
 {
@@ -1,5 +1,12 @@
 ﻿#include "barnhut/barnhut.h"
 #include "graph/graph.h"
+#include "service/winapi/file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <numeric>
 
 ARBOR_BEGIN
 
@@ -31,19 +38,16 @@ void graph::addEdge(_In_ STLADD string_type&& tail, _In_ STLADD string_type&& he
     bool noEdge = false;
     {
         STLADD lock_guard_shared<WAPI srw_lock> edgesLock {m_edgesLock};
-        noEdge = std::none_of(
-            m_edges.cbegin(),
-            m_edges.cend(),
-            [tailVertex, headVertex] (_In_ const auto& value) -> bool
-            {
-                return (value->getTail() == tailVertex) && (value->getHead() == headVertex);
-            });
+        noEdge = !m_springs.contains(tailVertex->getId(), headVertex->getId());
     }
     if (noEdge)
     {
         STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
-        m_edges.emplace_back(new edge {tailVertex, headVertex, length, m_stiffness, true});
+        connect(tailVertex->getId(), headVertex->getId(), length);
+        m_edges.emplace_back(new edge {tailVertex, headVertex, length, m_parameters.stiffness, true});
+        m_springs.add(tailVertex->getId(), headVertex->getId(), length, m_parameters.stiffness);
     }
+    notifyChange();
 }
 
 
@@ -55,17 +59,34 @@ void graph::addEdge(_In_ STLADD string_type&& tail, _In_ STLADD string_type&& he
  *
  * Returns:
  * N/A.
+ *
+ * Remarks:
+ * The method publishes an empty snapshot of the next generation (see the `publishSnapshot` method), so the renderer
+ * drops everything it has cached for the removed vertices and edges.
+ *
+ * The step counter and the random engine start again from the `seed` parameter, so the cleared graph lays out the same
+ * way as a new one.
  */
-void graph::clear() noexcept
+void graph::clear()
 {
+    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
     m_meanOfEnergy = 0.0f;
-    sse_t value = {m_distribution.a(), m_distribution.a(), m_distribution.b(), m_distribution.b()};
+    sse_t value = {-m_placementBound, -m_placementBound, m_placementBound, m_placementBound};
     m_graphBound = _mm_load_ps(value.data);
     m_viewBound = getZeroVector();
-    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
-    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
     m_edges.clear();
+    m_springs.clear();
     m_vertices.clear();
+    m_physics.clear();
+    m_connected.clear();
+    m_centroid = getZeroVector();
+    m_step = 0;
+    m_exactRepulsion = true;
+    m_random.seed(m_parameters.seed);
+    ++m_generation;
+    publishSnapshot();
+    notifyChange();
 }
 
 
@@ -80,6 +101,9 @@ void graph::clear() noexcept
  * N/A.
  *
  * Remarks:
+ * This method makes a step on the calling thread, if this graph is active (see the `active` method); it isn't needed if
+ * the simulation thread is running (see the `startSimulation` method).
+ *
  * This is analogue of `ArborGVT::ArborSystem::tickTimer` method in the original C# code.
  */
 void graph::update(_In_ const __m128 renderSurfaceSize)
@@ -90,299 +114,1477 @@ void graph::update(_In_ const __m128 renderSurfaceSize)
         STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock, std::try_to_lock};
         if (edgesLock)
         {
-            updatePhysics();
-            updateViewBound(renderSurfaceSize);
+            acceptChanges();
+            if (active())
+            {
+                updatePhysics();
+                updateGraphBound();
+                updateViewBound(renderSurfaceSize);
+                publishSnapshot();
+            }
         }
     }
 }
 
 
 /**
- * Adds a new vertex to the graph if the latter doesn't have a vertex with the same name.
+ * Lays this graph out: makes simulation steps back to back until the layout converges or a limit is reached.
  *
  * Parameters:
- * >name
- * New vertex name.
- * >bkgndColor
- * Vertex background color.
- * >textColor
- * Vertex text color.
- * >mass
- * Vertex mass.
- * >fixed
- * Vertex movement ability.
+ * >limits
+ * Stop conditions of the layout.
+ * >positions
+ * Snapshot that receives the final layout: coordinates of the vertices, indexed by `vertex::getId`, and the graph
+ * bound.
  *
  * Returns:
- * Pointer to the new vertex instance.
+ * Statistics of the layout.
  *
  * Remarks:
- * This method obtains exclusive lock on the `m_verticesLock` mutex only.
+ * This method is meant for a graph that isn't rendered: it doesn't need a render surface, it doesn't move the
+ * `m_viewBound` and it publishes a snapshot only after the last step (see the `publishSnapshot` method). The steps are
+ * the same as the simulation ones (the graph's parameters are used, and the `autoStop` parameter is ignored), so a
+ * seeded graph lays out the same way whichever way the steps are made.
  *
- * To exploit `graph::addVertex(_In_ STLADD string_type&&)` method, this one calls that method. And that's why (because
- * a vertex requires random coordinates) I didn't create new vertex class ctor.
+ * The `MultilevelLayout` method lays out coarse versions of the graph first (see the `layoutLevels` method); the limits
+ * are shared by all the levels, so a layout stopped by a limit at a coarse level still places the vertices of the graph
+ * by the coarse layout.
+ *
+ * The method obtains exclusive locks on both the `m_verticesLock` and `m_edgesLock` mutexes (it waits for them) and
+ * holds them until the layout ends. The simulation thread, if it's running, waits for the layout to end, and so do
+ * threads that change the graph; the renderer doesn't wait (it reads snapshots). The `cancel` flag is the only way to
+ * stop the layout from another thread.
  */
-vertex* graph::addVertex(
-    _In_ STLADD string_type&& name,
-    _In_ const D2D1_COLOR_F& bkgndColor,
-    _In_ const D2D1_COLOR_F& textColor,
-    _In_ const float mass,
-    _In_ const bool fixed)
+layout_statistics graph::layout(_In_ const layout_limits& limits, _Out_ layout_snapshot* positions)
 {
+    layout_statistics result {};
+    result.reason = LayoutConverged;
     STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
-    vertex* v = addVertex(std::move(name));
-    sse_t value = {bkgndColor.r, bkgndColor.g, bkgndColor.b, bkgndColor.a};
-    v->setColor(_mm_load_ps(value.data));
-    value = {textColor.r, textColor.g, textColor.b, textColor.a};
-    v->setTextColor(_mm_load_ps(value.data));
-    value.data[0] = mass;
-    __m128 temp = _mm_load_ps(value.data);
-    v->setMass(_mm_shuffle_ps(temp, temp, 0));
-    v->setFixed(fixed);
-    return v;
+    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
+    auto start = std::chrono::steady_clock::now();
+    acceptChanges();
+    if (MultilevelLayout == limits.method)
+    {
+        layoutLevels(limits, start, &result);
+    }
+    if (LayoutConverged == result.reason)
+    {
+        layoutLevel(limits, start, &result);
+    }
+    result.duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    result.energy = result.steps ? m_meanOfEnergy : 0.0f;
+    result.repulsion = m_repulsionStatistics;
+    publishSnapshot();
+    positions->assign(m_physics, m_edges.size(), m_graphBound, m_generation, m_step);
+    return result;
 }
 
 
 /**
- * Adds a new edge to the graph. The edge connects two specified vertices.
+ * Makes simulation steps over the current vertices and springs until they converge or a limit of the layout is
+ * reached.
  *
  * Parameters:
- * >tail
- * Tail vertex, where the new edge begins.
- * >head
- * Head vertex, where the new edge ends.
- * >length
- * Size of the new edge.
- * >stiffness
- * New edge stiffness.
- * >directed
- * Determines edge style: is it directed or not.
- * >color
- * Edge drawing color.
+ * >limits
+ * Stop conditions of the layout.
+ * >start
+ * Start time of the layout.
+ * >statistics
+ * Statistics of the layout; the method adds its steps and sets the stop reason if a limit has been reached.
  *
  * Returns:
- * Pointer to the new edge instance.
+ * N/A.
  *
  * Remarks:
- * This method obtains exclusive lock on the `m_edgesLock` mutex only.
+ * This method obtains no lock. Caller of this method must hold exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes.
  */
-edge* graph::addEdge(
-    _In_ vertex* tail,
-    _In_ vertex* head,
-    _In_ const float length,
-    _In_ const float stiffness,
-    _In_ const bool directed,
-    _In_ const D2D1_COLOR_F& color)
+void graph::layoutLevel(
+    _In_ const layout_limits& limits,
+    _In_ const std::chrono::steady_clock::time_point start,
+    _Inout_ layout_statistics* statistics)
 {
-    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
-    m_edges.emplace_back(new edge {tail, head, length, stiffness, directed, color});
-    return m_edges.back().get();
+    uint32_t restSteps = 0;
+    while (m_parameters.stopSteps > restSteps)
+    {
+        if (limits.cancel && limits.cancel->load())
+        {
+            statistics->reason = LayoutCancelled;
+            break;
+        }
+        if (limits.maxSteps && (limits.maxSteps <= statistics->steps))
+        {
+            statistics->reason = LayoutStepLimit;
+            break;
+        }
+        updatePhysics();
+        updateGraphBound();
+        if (!statistics->steps)
+        {
+            statistics->initialEnergy = m_meanOfEnergy;
+        }
+        ++statistics->steps;
+        restSteps = (limits.energyThreshold > m_meanOfEnergy) ? restSteps + 1 : 0;
+        if (limits.maxDuration.count() && (m_parameters.stopSteps > restSteps) &&
+            (limits.maxDuration <= std::chrono::steady_clock::now() - start))
+        {
+            statistics->reason = LayoutTimeLimit;
+            break;
+        }
+    }
 }
 
 
 /**
- * Adds a new edge to the graph. The edge connects two specified vertices.
+ * Lays out coarse levels of this graph, from the coarsest one, and places the vertices of the graph by the layout of
+ * the first level.
  *
  * Parameters:
- * >tail
- * Tail vertex, where the new edge begins.
- * >head
- * Head vertex, where the new edge ends.
- * >length
- * Size of the new edge.
- * >directed
- * Determines edge style: is it directed or not.
- * >color
- * Edge drawing color.
+ * >limits
+ * Stop conditions of the layout.
+ * >start
+ * Start time of the layout.
+ * >statistics
+ * Statistics of the layout; the method adds its steps and levels and sets the stop reason if a limit has been reached.
  *
  * Returns:
- * Pointer to the new edge instance.
- *
- * Stiffness of the new edge is assigned by this graph's 'stifness' setting.
+ * N/A.
  *
  * Remarks:
- * This method obtains exclusive lock on the `m_edgesLock` mutex only.
+ * This method obtains no lock. Caller of this method must hold exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes.
+ *
+ * Flat layout of a large graph from random positions spends most of its steps untangling it: a fold of the graph
+ * unfolds by one edge length per few steps. A coarse level untangles in a few steps, and each finer level starts
+ * untangled, so it only has to spread its clusters locally. Each level is laid out by the same steps as the graph is
+ * (see the `layoutLevel` method): its vertices and springs are swapped into the `m_physics` and `m_springs` for the
+ * time of its layout, so the same repulsion engines, integrators and parameters are used. The `m_graphBound` is found
+ * again for each level, and for the graph after its vertices have been placed: the Barnes Hut tree of the first step
+ * is built over it, and the bound of the coarser level doesn't hold the scaled layout.
  */
-edge* graph::addEdge(
-    _In_ vertex* tail,
-    _In_ vertex* head,
-    _In_ const float length,
-    _In_ const bool directed,
-    _In_ const D2D1_COLOR_F& color)
+void graph::layoutLevels(
+    _In_ const layout_limits& limits,
+    _In_ const std::chrono::steady_clock::time_point start,
+    _Inout_ layout_statistics* statistics)
 {
-    return addEdge(tail, head, length, m_stiffness, directed, color);
+    graph_hierarchy hierarchy {};
+    hierarchy.build(m_physics, m_springs, m_coarsestLevelSize, &m_random);
+    statistics->levels = static_cast<uint32_t> (hierarchy.size());
+    for (size_t i = hierarchy.size(); 0 < i--;)
+    {
+        if (LayoutConverged == statistics->reason)
+        {
+            m_physics.swap(*hierarchy.getPhysics(i));
+            m_springs.swap(*hierarchy.getSprings(i));
+            updateGraphBound();
+            m_meanOfEnergy = 0.0f;
+            restartSimulation();
+            layoutLevel(limits, start, statistics);
+            m_physics.swap(*hierarchy.getPhysics(i));
+            m_springs.swap(*hierarchy.getSprings(i));
+        }
+        hierarchy.prolong(
+            i,
+            i ? *hierarchy.getSprings(i - 1) : m_springs,
+            i ? hierarchy.getPhysics(i - 1) : &m_physics,
+            m_placementJitter,
+            &m_random);
+    }
+    updateGraphBound();
+    m_meanOfEnergy = 0.0f;
+    restartSimulation();
 }
 
 
 /**
- * Adds a new vertex to the graph if the latter doesn't have a vertex with the same name.
+ * Saves the layout of this graph (coordinates and velocities of the vertices, keyed by the vertex names) to a file.
  *
  * Parameters:
- * >name
- * New vertex name.
+ * >fileName
+ * Name of the file; an existing file is overwritten.
  *
  * Returns:
- * Pointer to the new vertex instance.
+ * Standard HRESULT code.
  *
  * Remarks:
- * The caller of this method MUST obtain exclusive lock on the `m_verticesLock` mutex. Because:
- * a) This method changes the internal vertices container,
- * b) This method returns pointer to a vertex, stored in the internal container. And at least shared lock must exist
- *    after this method has returned the pointer to the caller. But because I use SRW lock, that neither can be
- *    recursive nor can be upgraded from shared to exclusive mode, the caller has to obtain exclusive SRW lock from the
- *    beginning.
+ * The file is a `layout_file_header` followed by a `layout_file_record` and the name of each vertex, in the native
+ * byte order. It's about 20 bytes plus the name per vertex, so a graph of a million vertices takes a few dozen MB.
  *
- * Therefore, BE CAREFUL: this method doesn't obtain any locks! It totally relies on caller.
+ * This method obtains shared lock on the `m_verticesLock` mutex while it copies the layout into a memory buffer; the
+ * file is written after the lock has been released, by a single `WriteFile` call.
  */
-vertex* graph::addVertex(_In_ STLADD string_type&& name)
+HRESULT graph::saveLayout(_In_z_ LPCTSTR fileName)
 {
-    // Here we can end up with issuing two unnecessary calls to "get a randomly distributed value".
-    std::random_device rd {};
-    std::mt19937 engine {rd()};
-    sse_t value = {m_distribution(engine), m_distribution(engine), 0.0f, 0.0f};
-    return addVertex(std::move(name), _mm_load_ps(value.data));
+    bytes_cont_t buffer {};
+    {
+        STLADD lock_guard_shared<WAPI srw_lock> verticesLock {m_verticesLock};
+        layout_file_header header;
+        header.signature = m_layoutSignature;
+        header.version = m_layoutVersion;
+        header.characterSize = sizeof(STLADD string_type::value_type);
+        header.verticesNumber = static_cast<uint32_t> (m_vertices.size());
+        size_t size = sizeof(header) + m_vertices.size() * sizeof(layout_file_record);
+        for (const auto& item : m_vertices)
+        {
+            size += item.first.size() * sizeof(STLADD string_type::value_type);
+        }
+        buffer.resize(size);
+        uint8_t* p = buffer.data();
+        memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+        for (const auto& item : m_vertices)
+        {
+            size_t id = item.second.getId();
+            sse_t coordinates;
+            _mm_store_ps(coordinates.data, _mm_movelh_ps(m_physics.getCoordinates(id), m_physics.getVelocity(id)));
+            layout_file_record record;
+            record.x = coordinates.data[0];
+            record.y = coordinates.data[1];
+            record.velocityX = coordinates.data[2];
+            record.velocityY = coordinates.data[3];
+            record.nameLength = static_cast<uint32_t> (item.first.size());
+            memcpy(p, &record, sizeof(record));
+            p += sizeof(record);
+            size_t nameSize = item.first.size() * sizeof(STLADD string_type::value_type);
+            memcpy(p, item.first.data(), nameSize);
+            p += nameSize;
+        }
+    }
+
+    HRESULT hr;
+    if (MAXDWORD >= buffer.size())
+    {
+        WAPI file_t file {CreateFile(
+            fileName,
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr)};
+        if (file)
+        {
+            DWORD written;
+            hr = WriteFile(file.get(), buffer.data(), static_cast<DWORD> (buffer.size()), &written, nullptr) ?
+                S_OK :
+                HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+    else
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+    return hr;
 }
 
 
 /**
- * Adds a new vertex to the graph if the latter doesn't have a vertex with the same name.
+ * Loads a layout saved by the `saveLayout` method into this graph.
  *
  * Parameters:
- * >name
- * New vertex name.
- * >coordinates
- * Coordinates of the new vertex.
+ * >fileName
+ * Name of the file.
  *
  * Returns:
- * Pointer to the new vertex instance.
+ * Standard HRESULT code: `S_FALSE` if no vertex of the file is in this graph, `HRESULT_FROM_WIN32(ERROR_INVALID_DATA)`
+ * if the file isn't a layout file or is damaged (the graph isn't changed then).
  *
  * Remarks:
- * The caller of this method MUST obtain exclusive lock on the `m_verticesLock` mutex. Because:
- * a) This method changes the internal vertices container,
- * b) This method returns pointer to a vertex, stored in the internal container. And at least shared lock must exist
- *    after this method has returned the pointer to the caller. But because I use SRW lock, that neither can be
- *    recursive nor can be upgraded from shared to exclusive mode, the caller has to obtain exclusive SRW lock from the
- *    beginning.
+ * Vertices are matched by names, so the graph must be built (its vertices and edges added) before the layout is loaded.
+ * Vertices of the file that aren't in the graph are ignored; vertices of the graph that aren't in the file are placed
+ * near their neighbours (see the `placeNearNeighbors` method) or, if they aren't connected to any loaded vertex, keep
+ * their coordinates. The `m_graphBound` and the `m_viewBound` are set to the loaded layout, so a view doesn't have to
+ * grow from the initial random square, and a graph loaded from its converged layout comes to rest in a few steps.
  *
- * Therefore, BE CAREFUL: this method doesn't obtain any locks! It totally relies on caller.
+ * The file is read without any lock; then this method obtains exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes (see the `applyLayout` method).
  */
-vertex* __vectorcall graph::addVertex(_In_ STLADD string_type&& name, _In_ const __m128 coordinates)
+HRESULT graph::loadLayout(_In_z_ LPCTSTR fileName)
 {
-    /*
-     * About order of evaluation of inside initializer-list.
-     * >8.5.4 List-initialization [dcl.init.list]
-     * >4 Within the initializer-list of a braced-init-list, the initializer-clauses, including any that result from
-     * >pack expansions (14.5.3), are evaluated in the order in which they appear. That is, every value computation and
-     * >side effect associated with a given initializer-clause is sequenced before every value computation and
-     * >side effect associated with any initializer-clause that follows it in the comma-separated list of the
-     * >initializer-list. [Note: This evaluation ordering holds regardless of the semantics of the initialization;
-     * >for example, it applies when the elements of the initializer-list are interpreted as arguments of a constructor
-     * >call, even though ordinarily there are no sequencing constraints on the arguments of a call. -end note].
-     *
-     * If MSVC 2015 Update 2 will really consider this as it's expected (MSVC before 2015 Update 2 release doesn't),
-     * the following code can be changed like this:
-     * // For MSVC 2015 Update 1 and below:
-     * STLADD string_type key {name};
-     * std::pair<vertices_cont_t::iterator, bool> result =
-     *     m_vertices.emplace(key, vertex {std::move(name), coordinates});
-     *
-     * // For MSVC 2015 Update 2 and above:
-     * std::pair<vertices_cont_t::iterator, bool> result =
-     *     m_vertices.insert({STLADD string_type {name}, vertex {std::move(name), coordinates}});
-     *
-     * Thus, the above code for 'VC 2015 Update 2' calls this template ctor of `std::pair`:
-     * std::pair(std::basic_string<...>& _Val1, arbor::vertex&& _Val2 = {...});
-     * with arguments deduced as:
-     *     - for template ctor itself: <std::basic_string<...>& __ptr64, arbor::vertex, void>,
-     *     - for `pair` template class: <std::basic_string<...> const, arbor::vertex>.
-     * Following [8.5.4.4] the code, at first, makes a copy of `name` argument (passing it as `_Val1` parameter),
-     * and after that the code moves `name` into `vertex` ctor.
-     */
-    std::pair<vertices_cont_t::iterator, bool> result =
-        m_vertices.insert({STLADD string_type {name}, vertex {std::move(name), coordinates}});
-    return &(result.first->second);
+    bytes_cont_t buffer {};
+    HRESULT hr;
+    WAPI file_t file {
+        CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+    if (file)
+    {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file.get(), &size))
+        {
+            if (MAXDWORD >= size.QuadPart)
+            {
+                buffer.resize(static_cast<size_t> (size.QuadPart));
+                DWORD read;
+                if (ReadFile(file.get(), buffer.data(), static_cast<DWORD> (buffer.size()), &read, nullptr))
+                {
+                    hr = (buffer.size() == read) ? S_OK : HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+                }
+                else
+                {
+                    hr = HRESULT_FROM_WIN32(GetLastError());
+                }
+            }
+            else
+            {
+                hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+            }
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        file.reset();
+    }
+    else
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = applyLayout(buffer);
+    }
+    return hr;
 }
 
 
 /**
- * Recalculates bounds of the rectangle containing all vertices. New rectangle is stored as updated `m_graphBound`.
+ * Sets coordinates and velocities of the vertices of this graph from a layout file content.
  *
  * Parameters:
- * None.
+ * >buffer
+ * Content of the file.
  *
  * Returns:
- * N/A.
+ * See the `loadLayout` method.
  *
  * Remarks:
- * This method DOES NOT obtain any lock while it accesses the graph's vertices. Caller of this method must guarantee
- * that other threads can't access graph's data while this method works. This method doesn't lock the vertices because
- * edges and vertices locks must be obtained in the specific order only (see remarks section for the `graph::addEdge`
- * method), but noone knows when this method will be called (after of before edges lock was/will be obtained).
- *
- * This is `ArborGVT::ArborSystem::updateGraphBounds` method in the original C# code.
+ * The whole content is checked before any vertex is changed. Then the method obtains exclusive locks on both the
+ * `m_verticesLock` and `m_edgesLock` mutexes, wakes up all the vertices, publishes the new layout (see the
+ * `publishSnapshot` method) and tells the simulation that the graph has been changed (see the `notifyChange` method),
+ * so the simulation goes on from the loaded layout.
  */
-void graph::updateGraphBound()
+HRESULT graph::applyLayout(_In_ const bytes_cont_t& buffer)
 {
-    sse_t value;
-    value.data[0] = m_distribution.a();
-    value.data[1] = m_distribution.b();
-    __m128 temp = _mm_load_ps(value.data);
-    temp  = _mm_shuffle_ps(temp, temp, 0b01010000);
-    for (auto it = m_vertices.cbegin(); m_vertices.cend() != it; ++it)
+    const size_t characterSize = sizeof(STLADD string_type::value_type);
+    layout_file_header header;
+    bool valid = (sizeof(header) <= buffer.size());
+    if (valid)
     {
-        __m128 coordinate = it->second.getCoordinates();
-        if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinate, coordinate))))
+        memcpy(&header, buffer.data(), sizeof(header));
+        valid = (m_layoutSignature == header.signature) && (m_layoutVersion == header.version) &&
+            (characterSize == header.characterSize);
+    }
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; valid && (header.verticesNumber > i); ++i)
+    {
+        layout_file_record record;
+        valid = (sizeof(record) <= buffer.size() - offset);
+        if (valid)
         {
-            int compare = _mm_movemask_ps(_mm_cmplt_ps(coordinate, temp));
-            if (0b0001 & compare)
-            {
-                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b01100100);
-                temp = _mm_shuffle_ps(temp2, temp, 0b11101100);
-            }
-            if (0b0010 & compare)
-            {
-                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b00100100);
-                temp = _mm_shuffle_ps(temp2, temp, 0b11100111);
-            }
-            temp = _mm_shuffle_ps(temp, temp, 0b01001110);
-            compare = _mm_movemask_ps(_mm_cmpgt_ps(coordinate, temp));
-            if (0b0001 & compare)
-            {
-                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b01100100);
-                temp = _mm_shuffle_ps(temp2, temp, 0b11101100);
-            }
-            if (0b0010 & compare)
-            {
-                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b00100100);
-                temp = _mm_shuffle_ps(temp2, temp, 0b11100111);
-            }
-            temp = _mm_shuffle_ps(temp, temp, 0b01001110);
+            memcpy(&record, buffer.data() + offset, sizeof(record));
+            offset += sizeof(record);
+            valid = std::isfinite(record.x) && std::isfinite(record.y) && std::isfinite(record.velocityX) &&
+                std::isfinite(record.velocityY) && (record.nameLength <= (buffer.size() - offset) / characterSize);
+            offset += record.nameLength * characterSize;
         }
     }
-    m_graphBound = temp;
+    if (!valid || (buffer.size() != offset))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
+    bytes_cont_t placed(m_physics.size(), 0);
+    bool found = false;
+    STLADD string_type name {};
+    offset = sizeof(header);
+    for (uint32_t i = 0; header.verticesNumber > i; ++i)
+    {
+        layout_file_record record;
+        memcpy(&record, buffer.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        name.resize(record.nameLength);
+        memcpy(&name[0], buffer.data() + offset, record.nameLength * characterSize);
+        offset += record.nameLength * characterSize;
+        auto item = m_vertices.find(name);
+        if (m_vertices.end() != item)
+        {
+            size_t id = item->second.getId();
+            m_physics.setCoordinates(id, _mm_setr_ps(record.x, record.y, 0.0f, 0.0f));
+            m_physics.setVelocity(id, _mm_setr_ps(record.velocityX, record.velocityY, 0.0f, 0.0f));
+            placed[id] = 1;
+            found = true;
+        }
+    }
+    if (found)
+    {
+        placeNearNeighbors(&placed);
+        updateGraphBound();
+        m_viewBound = m_graphBound;
+        m_physics.wakeAll();
+        publishSnapshot();
+        notifyChange();
+    }
+    return found ? S_OK : S_FALSE;
 }
 
 
 /**
- * Makes animation step. This method increments the "view area" by one step toward the "graph area".
+ * Places vertices of this graph that haven't been placed yet near their placed neighbours.
  *
  * Parameters:
- * >renderSurfaceSize
- * Size (in DIPs, logical size) of a surface where this graph is rendered.
+ * >placed
+ * Flags of the placed vertices, indexed by a vertex identifier. The method sets flags of the vertices it places.
  *
  * Returns:
  * N/A.
  *
  * Remarks:
- * This method calls `updateGraphBound` and also doesn't obtain any lock.
+ * This method obtains no lock. Caller of this method must hold exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes.
  *
- * This is `ArborGVT::ArborSystem::updateViewBounds` method in the original C# code.
+ * The vertices are placed by layers, as a breadth first search from the placed vertices goes: each vertex of a layer is
+ * moved to the center of its neighbours placed before that layer (plus a random offset up to `m_placementJitter`), and
+ * its velocity is zeroed. So a new branch of a tree grows out of the vertex it's attached to, not out of a random
+ * point. Vertices that aren't connected to any placed vertex aren't changed. The method takes O(V + E) time.
  */
-void graph::updateViewBound(_In_ const __m128 renderSurfaceSize)
+void graph::placeNearNeighbors(_Inout_ bytes_cont_t* placed)
 {
-    updateGraphBound();
-    if (0b1111 != (0b1111 & _mm_movemask_ps(_mm_cmpeq_ps(m_viewBound, getZeroVector()))))
+    const size_t count = m_physics.size();
+    // Neighbours of the i-th vertex are `neighbors` elements from `offsets[i]` to `offsets[i + 1]`.
+    ids_cont_t offsets(count + 1, 0);
+    for (const auto& e : m_edges)
+    {
+        ++offsets[e->getTail()->getId() + 1];
+        ++offsets[e->getHead()->getId() + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    ids_cont_t neighbors(offsets[count]);
+    {
+        ids_cont_t next {offsets.begin(), offsets.end() - 1};
+        for (const auto& e : m_edges)
+        {
+            uint32_t tail = static_cast<uint32_t> (e->getTail()->getId());
+            uint32_t head = static_cast<uint32_t> (e->getHead()->getId());
+            neighbors[next[tail]++] = head;
+            neighbors[next[head]++] = tail;
+        }
+    }
+
+    // The first layer is unplaced neighbours of the placed vertices; each next one is unplaced neighbours of the
+    // previous layer. A vertex is queued (and its flag is set to 2) once.
+    ids_cont_t layer {};
+    ids_cont_t nextLayer {};
+    bytes_cont_t& flags = *placed;
+    for (uint32_t i = 0; count > i; ++i)
+    {
+        if (0 == flags[i])
+        {
+            for (uint32_t j = offsets[i]; offsets[i + 1] > j; ++j)
+            {
+                if (1 == flags[neighbors[j]])
+                {
+                    flags[i] = 2;
+                    layer.push_back(i);
+                    break;
+                }
+            }
+        }
+    }
+    __m128 jitter = _mm_set1_ps(m_placementJitter * 2.0f);
+    __m128 half = _mm_set1_ps(m_placementJitter);
+    while (!layer.empty())
+    {
+        for (uint32_t id : layer)
+        {
+            __m128 sum = getZeroVector();
+            float number = 0.0f;
+            for (uint32_t j = offsets[id]; offsets[id + 1] > j; ++j)
+            {
+                if (1 == flags[neighbors[j]])
+                {
+                    sum = _mm_add_ps(sum, m_physics.getCoordinates(neighbors[j]));
+                    number += 1.0f;
+                }
+            }
+            __m128 offset = _mm_sub_ps(_mm_mul_ps(m_random.next(), jitter), half);
+            sum = _mm_add_ps(_mm_div_ps(sum, _mm_set1_ps(number)), _mm_movelh_ps(offset, getZeroVector()));
+            m_physics.setCoordinates(id, sum);
+            m_physics.setVelocity(id, getZeroVector());
+        }
+        // Vertices of a layer see only the vertices placed before it, so the flags are set after the whole layer.
+        for (uint32_t id : layer)
+        {
+            flags[id] = 1;
+        }
+        nextLayer.clear();
+        for (uint32_t id : layer)
+        {
+            for (uint32_t j = offsets[id]; offsets[id + 1] > j; ++j)
+            {
+                uint32_t neighbor = neighbors[j];
+                if (0 == flags[neighbor])
+                {
+                    flags[neighbor] = 2;
+                    nextLayer.push_back(neighbor);
+                }
+            }
+        }
+        layer.swap(nextLayer);
+    }
+}
+
+
+/**
+ * Starts the simulation thread, which makes steps of this graph at a fixed rate.
+ *
+ * Parameters:
+ * >stepCallback
+ * Function called by the simulation thread after each step; it may be empty.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The thread makes a step every `getSimulationInterval()` microseconds (zero interval means steps are made back to
+ * back), while this graph is active (see the `active` method); while the graph is at rest the thread sleeps, and the
+ * step callback isn't called (see the `setStateCallbacks` method). So the simulation speed doesn't depend on how often
+ * and whether at all this graph is rendered. The step is made under exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes (they're waited for); it updates positions of the vertices and the `m_graphBound` and publishes
+ * them as a snapshot (see the `publishSnapshot` method), but it doesn't update the `m_viewBound` (that's an animation
+ * of the view, so it's left to the renderer, see the `getNextViewBound` method). The step callback is called after the
+ * locks are released.
+ *
+ * If the thread is late (a step took longer than the interval), the next step is made at once, but the lost steps
+ * aren't caught up.
+ *
+ * If the thread is already running, it's stopped first.
+ */
+void graph::startSimulation(_In_ std::function<void ()>&& stepCallback)
+{
+    stopSimulation();
+    m_stepCallback = std::move(stepCallback);
+    m_stopSimulation = false;
+    m_simulationThread = std::thread {&graph::simulationProc, this};
+}
+
+
+/**
+ * Stops the simulation thread and waits for it.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The method must not be called by the step callback. It does nothing if the thread isn't running.
+ */
+void graph::stopSimulation()
+{
+    if (m_simulationThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock {m_simulationLock};
+            m_stopSimulation = true;
+        }
+        m_simulationWakeUp.notify_all();
+        m_simulationThread.join();
+    }
+}
+
+
+/**
+ * Sets functions called by the simulation thread when this graph starts moving and when it comes to rest.
+ *
+ * Parameters:
+ * >startCallback
+ * Function called before the first step the thread makes after it has been started or after the graph has been at
+ * rest; it may be empty.
+ * >stopCallback
+ * Function called when the graph comes to rest (see the `autoStop` parameter); it may be empty.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The functions are called on the simulation thread without any lock held, so they may call other methods of this
+ * graph, except the `startSimulation` and `stopSimulation` methods. These are `OnStart` and `OnStop` events of the
+ * original C# code.
+ */
+void graph::setStateCallbacks(
+    _In_ std::function<void ()>&& startCallback, _In_ std::function<void ()>&& stopCallback)
+{
+    std::lock_guard<std::mutex> lock {m_simulationLock};
+    m_startCallback = std::move(startCallback);
+    m_stopCallback = std::move(stopCallback);
+}
+
+
+/**
+ * Thread procedure of the simulation thread.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * While this graph is at rest (see the `active` method), the thread makes no steps, calls no step callback and doesn't
+ * wake up until this graph is changed (see the `notifyChange` method) or the thread is stopped, so a graph at rest
+ * costs no CPU time.
+ */
+void graph::simulationProc()
+{
+    auto next = std::chrono::steady_clock::now();
+    bool resting = true;
+    std::unique_lock<std::mutex> lock {m_simulationLock};
+    while (!m_stopSimulation)
+    {
+        lock.unlock();
+        bool stepped = false;
+        bool rest;
+        {
+            STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+            STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
+            acceptChanges();
+            if (active())
+            {
+                auto start = std::chrono::steady_clock::now();
+                updatePhysics();
+                updateGraphBound();
+                publishSnapshot();
+                m_stepDuration = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                stepped = true;
+            }
+            rest = !active();
+        }
+        if (stepped)
+        {
+            if (resting)
+            {
+                resting = false;
+                lock.lock();
+                std::function<void ()> callback {m_startCallback};
+                lock.unlock();
+                if (callback)
+                {
+                    callback();
+                }
+            }
+            if (m_stepCallback)
+            {
+                m_stepCallback();
+            }
+        }
+        if (rest && !resting)
+        {
+            resting = true;
+            lock.lock();
+            std::function<void ()> callback {m_stopCallback};
+            lock.unlock();
+            if (callback)
+            {
+                callback();
+            }
+        }
+        lock.lock();
+        if (resting)
+        {
+            m_simulationWakeUp.wait(lock, [this] () -> bool {return m_stopSimulation || m_changed;});
+            next = std::chrono::steady_clock::now();
+        }
+        else
+        {
+            auto now = std::chrono::steady_clock::now();
+            next += std::chrono::microseconds {m_interval.load()};
+            if (next < now)
+            {
+                next = now;
+            }
+            m_simulationWakeUp.wait_until(lock, next, [this] () -> bool {return m_stopSimulation;});
+        }
+    }
+}
+
+
+/**
+ * Tells the simulation thread that this graph (or its parameters) has been changed, so the graph must leave the rest
+ * state (see the `active` method).
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains the `m_simulationLock` mutex; it may be called with the `m_verticesLock` and/or `m_edgesLock`
+ * mutexes held (the simulation thread never waits for them holding the `m_simulationLock`).
+ */
+void graph::notifyChange()
+{
+    {
+        std::lock_guard<std::mutex> lock {m_simulationLock};
+        m_changed = true;
+    }
+    m_simulationWakeUp.notify_all();
+}
+
+
+/**
+ * Resets the rest state of this graph if the graph has been changed since the last step (see the `notifyChange`
+ * method). The time slice of the `VerletIntegrator` starts again from the `timeSlice` parameter, and its stability
+ * limit is found for the changed springs. The graph bound is found again: a new vertex is placed next to its neighbour
+ * (see the `connect` method), maybe outside of the bound, and the Barnes Hut trees of the step are built over it.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Caller of this method must hold exclusive locks on both the `m_verticesLock` and `m_edgesLock` mutexes. The method
+ * obtains the `m_simulationLock` mutex.
+ */
+void graph::acceptChanges()
+{
+    std::lock_guard<std::mutex> lock {m_simulationLock};
+    if (m_changed)
+    {
+        m_changed = false;
+        updateGraphBound();
+        restartSimulation();
+    }
+}
+
+
+/**
+ * Resets the rest state of this graph and the time slice of the `VerletIntegrator`, and finds the stability limit of
+ * the time slice for the current springs.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains no lock. Caller of this method must hold exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes.
+ */
+void graph::restartSimulation()
+{
+    m_restSteps = 0;
+    m_timeSlice = m_parameters.timeSlice;
+    m_maxVelocity = 0.0f;
+    float rigidity = m_springs.getMaxRigidity(m_physics);
+    m_stableTimeSlice = (0.0f < rigidity) ? m_stability / std::sqrt(rigidity) : std::numeric_limits<float>::infinity();
+}
+
+
+/**
+ * Measures error of the Barnes Hut repulsion forces for the current state of this graph.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * Maximum and mean relative error of the forces computed by the `m_repulsionEngine` engine against the exact forces.
+ * Vertices with zero exact force (sleeping vertices among them) aren't counted.
+ *
+ * Remarks:
+ * This method obtains exclusive locks on both the `m_verticesLock` and `m_edgesLock` mutexes, just as the `update`
+ * method does, but it waits for them.
+ *
+ * The Barnes Hut engine works as the next step of the simulation would work (with the theta chosen for that step), but
+ * the vertices don't move and the statistics of the last step (see `getRepulsionStatistics`) don't change. The engine
+ * builds its own `BHUT flat_barnes_hut_tree`, so the `m_flatTree` kept between steps isn't refitted or rebuilt and the
+ * next step works as if the method hadn't been called; the engines that keep the tree are measured on a tree built
+ * from scratch, as after their rebuild. Forces of vertices that coincide with other vertices have random directions,
+ * so such vertices have large errors.
+ */
+repulsion_error graph::measureRepulsionError()
+{
+    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
+    repulsion_error result {0.0f, 0.0f};
+    if (m_vertices.empty())
+    {
+        return result;
+    }
+
+    repulsion_statistics statistics = m_repulsionStatistics;
+    __m128 zero = getZeroVector();
+    updateTheta();
+    BHUT flat_barnes_hut_tree tree {m_parameters.leafCapacity};
+    applyBarnesHutRepulsion(&tree);
+    const size_t size = m_physics.size();
+    std::vector<__m128, STLADD aligned_sse_allocator<__m128>> forces {};
+    forces.reserve(size);
+    for (size_t i = 0; size > i; ++i)
+    {
+        forces.push_back(m_physics.getForce(i));
+        m_physics.setForce(i, zero);
+    }
+    m_allPairs.load(&m_physics);
+    m_allPairs.applyForces(m_parameters.repulsion, getStepSeed(), &m_threadPool);
+    m_repulsionStatistics = statistics;
+
+    double sum = 0.0;
+    size_t count = 0;
+    sse_t value;
+    for (size_t i = 0; size > i; ++i)
+    {
+        __m128 exact = m_physics.getForce(i);
+        m_physics.setForce(i, zero);
+        __m128 temp = _mm_sub_ps(forces[i], exact);
+        temp = _mm_movelh_ps(_mm_mul_ps(temp, temp), _mm_mul_ps(exact, exact));
+        temp = _mm_hadd_ps(temp, temp);
+        _mm_store_ps(value.data, temp);
+        // `value.data[0]` is the squared error, `value.data[1]` is the squared exact force.
+        if (0.0f < value.data[1])
+        {
+            float error = std::sqrt(value.data[0] / value.data[1]);
+            result.maxError = std::max(result.maxError, error);
+            sum += error;
+            ++count;
+        }
+    }
+    result.meanError = count ? static_cast<float> (sum / count) : 0.0f;
+    return result;
+}
+
+
+/**
+ * Sets number of threads used to calculate physics of this graph.
+ *
+ * Parameters:
+ * >threadsNumber
+ * Number of threads, including the thread that makes a step (see the `update` and the `startSimulation` methods).
+ * Zero value is treated as one.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains exclusive lock on the `m_verticesLock` mutex only, that's enough to wait for the current
+ * animation step to finish (see the `update` method).
+ *
+ * Results of the physics calculation don't depend on number of threads.
+ */
+void graph::setThreadsNumber(_In_ const size_t threadsNumber)
+{
+    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+    m_threadPool.setThreadsNumber(threadsNumber);
+}
+
+
+/**
+ * Returns parameters of the simulation a new graph starts with.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * The default parameters (they're the constants of the original C# code).
+ */
+simulation_parameters graph::getDefaultParameters() noexcept
+{
+    simulation_parameters result;
+    result.stiffness = 750.0f;
+    result.repulsion = 10000.0f;
+    result.friction = 0.1f;
+    result.timeSlice = 0.01f;
+    result.maxTimeSlice = 0.05f;
+    result.maxDisplacement = 2.0f;
+    result.integrator = EulerIntegrator;
+    result.minTheta = 0.4f;
+    result.maxTheta = 1.0f;
+    result.leafCapacity = m_leafCapacity;
+    result.energyThreshold = 0.7f;
+    result.stopSteps = 10;
+    result.sleepVelocity = 0.5f;
+    // The Euler velocity is the force times the `timeSlice`, so this is the `sleepVelocity` test for the force.
+    result.sleepForce = 50.0f;
+    result.sleepSteps = 20;
+    result.seed = 0;
+    result.gravity = false;
+    result.autoStop = false;
+    result.sleep = false;
+    return result;
+}
+
+
+/**
+ * Returns stop conditions of a layout (see the `layout` method) that match the default parameters of the simulation.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * The default limits: the `FlatLayout` method, the default `energyThreshold` parameter, 100000 steps, no time limit
+ * and no cancel flag.
+ */
+layout_limits graph::getDefaultLayoutLimits() noexcept
+{
+    layout_limits result;
+    result.method = FlatLayout;
+    result.energyThreshold = getDefaultParameters().energyThreshold;
+    result.maxSteps = 100000;
+    result.maxDuration = std::chrono::microseconds::zero();
+    result.cancel = nullptr;
+    return result;
+}
+
+
+/**
+ * Returns the current parameters of the simulation.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * The parameters.
+ *
+ * Remarks:
+ * This method obtains shared lock on the `m_verticesLock` mutex.
+ */
+simulation_parameters graph::getParameters()
+{
+    STLADD lock_guard_shared<WAPI srw_lock> verticesLock {m_verticesLock};
+    return m_parameters;
+}
+
+
+/**
+ * Changes parameters of the simulation.
+ *
+ * Parameters:
+ * >parameters
+ * New parameters.
+ *
+ * Returns:
+ * `true` if the parameters have been changed, `false` if they're invalid: any value isn't finite, `stiffness` or
+ * `repulsion` is negative, `friction` is outside of [0, 1], `timeSlice` isn't positive or is greater than
+ * `maxTimeSlice`, `maxDisplacement` isn't positive, `integrator` is unknown, `minTheta` is negative or greater than
+ * `maxTheta`, `leafCapacity` is outside of [1, `m_maxLeafCapacity`], `energyThreshold` isn't positive or isn't less
+ * than `m_hotEnergy`, `stopSteps` is zero, `sleepVelocity` or `sleepForce` is negative, `sleepSteps` is outside of
+ * [1, 255].
+ *
+ * Remarks:
+ * This method obtains exclusive lock on the `m_verticesLock` mutex, that's enough to wait for the current step to
+ * finish (each step reads the parameters under this lock). So the new parameters take effect on the next step. If the
+ * graph is at rest, it's woken up, and so are all its sleeping vertices. A new `seed` re-seeds the random engine that
+ * places new vertices. A new `leafCapacity` makes the `m_flatTree` rebuilt on the next step.
+ */
+bool graph::setParameters(_In_ const simulation_parameters& parameters)
+{
+    const float values[] = {
+        parameters.stiffness,
+        parameters.repulsion,
+        parameters.friction,
+        parameters.timeSlice,
+        parameters.maxTimeSlice,
+        parameters.maxDisplacement,
+        parameters.minTheta,
+        parameters.maxTheta,
+        parameters.energyThreshold,
+        parameters.sleepVelocity,
+        parameters.sleepForce};
+    bool valid = std::all_of(
+        std::begin(values),
+        std::end(values),
+        [] (_In_ const float value) -> bool
+        {
+            return std::isfinite(value);
+        });
+    valid = valid &&
+        (0.0f <= parameters.stiffness) &&
+        (0.0f <= parameters.repulsion) &&
+        (0.0f <= parameters.friction) && (1.0f >= parameters.friction) &&
+        (0.0f < parameters.timeSlice) && (parameters.timeSlice <= parameters.maxTimeSlice) &&
+        (0.0f < parameters.maxDisplacement) &&
+        ((EulerIntegrator == parameters.integrator) || (VerletIntegrator == parameters.integrator)) &&
+        (0.0f <= parameters.minTheta) && (parameters.minTheta <= parameters.maxTheta) &&
+        (0 < parameters.leafCapacity) && (m_maxLeafCapacity >= parameters.leafCapacity) &&
+        (0.0f < parameters.energyThreshold) && (m_hotEnergy > parameters.energyThreshold) &&
+        (0 < parameters.stopSteps) &&
+        (0.0f <= parameters.sleepVelocity) && (0.0f <= parameters.sleepForce) &&
+        (0 < parameters.sleepSteps) && (UINT8_MAX >= parameters.sleepSteps);
+    if (valid)
+    {
+        STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+        if (m_parameters.seed != parameters.seed)
+        {
+            m_random.seed(parameters.seed);
+        }
+        m_parameters = parameters;
+        m_flatTree.setLeafCapacity(parameters.leafCapacity);
+        m_physics.wakeAll();
+        notifyChange();
+    }
+    return valid;
+}
+
+
+/**
+ * Returns the engine of the Barnes Hut repulsion.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * The engine.
+ *
+ * Remarks:
+ * This method obtains shared lock on the `m_verticesLock` mutex.
+ */
+repulsion_engine graph::getRepulsionEngine()
+{
+    STLADD lock_guard_shared<WAPI srw_lock> verticesLock {m_verticesLock};
+    return m_repulsionEngine;
+}
+
+
+/**
+ * Changes the engine of the Barnes Hut repulsion.
+ *
+ * Parameters:
+ * >engine
+ * New engine.
+ *
+ * Returns:
+ * `true` if the engine has been changed, `false` if it's unknown.
+ *
+ * Remarks:
+ * This method obtains exclusive lock on the `m_verticesLock` mutex, just as the `setParameters` method does, so the new
+ * engine takes effect on the next step. If the graph is at rest, it's woken up, and so are all its sleeping vertices.
+ * The engines that keep the `m_flatTree` between steps rebuild it on their first step after the switch.
+ */
+bool graph::setRepulsionEngine(_In_ const repulsion_engine engine)
+{
+    bool valid = (PointerBarnesHutTree <= engine) && (DualTreeFlatBarnesHutTree >= engine);
+    if (valid)
+    {
+        STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+        m_repulsionEngine = engine;
+        m_flatTree.discard();
+        m_physics.wakeAll();
+        notifyChange();
+    }
+    return valid;
+}
+
+
+/**
+ * Adds a new vertex to the graph if the latter doesn't have a vertex with the same name.
+ *
+ * Parameters:
+ * >name
+ * New vertex name.
+ * >bkgndColor
+ * Vertex background color.
+ * >textColor
+ * Vertex text color.
+ * >mass
+ * Vertex mass.
+ * >fixed
+ * Vertex movement ability.
+ *
+ * Returns:
+ * Pointer to the new vertex instance.
+ *
+ * Remarks:
+ * This method obtains exclusive lock on the `m_verticesLock` mutex only.
+ *
+ * To exploit `graph::addVertex(_In_ STLADD string_type&&)` method, this one calls that method. And that's why (because
+ * a vertex requires random coordinates) I didn't create new vertex class ctor.
+ */
+vertex* graph::addVertex(
+    _In_ STLADD string_type&& name,
+    _In_ const D2D1_COLOR_F& bkgndColor,
+    _In_ const D2D1_COLOR_F& textColor,
+    _In_ const float mass,
+    _In_ const bool fixed)
+{
+    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+    vertex* v = addVertex(std::move(name));
+    sse_t value = {bkgndColor.r, bkgndColor.g, bkgndColor.b, bkgndColor.a};
+    v->setColor(_mm_load_ps(value.data));
+    value = {textColor.r, textColor.g, textColor.b, textColor.a};
+    v->setTextColor(_mm_load_ps(value.data));
+    m_physics.setMass(v->getId(), mass);
+    m_physics.setFixed(v->getId(), fixed);
+    notifyChange();
+    return v;
+}
+
+
+/**
+ * Adds a new edge to the graph. The edge connects two specified vertices.
+ *
+ * Parameters:
+ * >tail
+ * Tail vertex, where the new edge begins.
+ * >head
+ * Head vertex, where the new edge ends.
+ * >length
+ * Size of the new edge.
+ * >stiffness
+ * New edge stiffness.
+ * >directed
+ * Determines edge style: is it directed or not.
+ * >color
+ * Edge drawing color.
+ *
+ * Returns:
+ * Pointer to the new edge instance.
+ *
+ * Remarks:
+ * This method obtains exclusive locks on the `m_verticesLock` and `m_edgesLock` mutexes: if it's the first edge of a
+ * vertex, the vertex is moved next to the other one (see the `connect` method).
+ */
+edge* graph::addEdge(
+    _In_ vertex* tail,
+    _In_ vertex* head,
+    _In_ const float length,
+    _In_ const float stiffness,
+    _In_ const bool directed,
+    _In_ const D2D1_COLOR_F& color)
+{
+    STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_verticesLock};
+    STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_edgesLock};
+    connect(tail->getId(), head->getId(), length);
+    m_edges.emplace_back(new edge {tail, head, length, stiffness, directed, color});
+    m_springs.add(tail->getId(), head->getId(), length, stiffness);
+    notifyChange();
+    return m_edges.back().get();
+}
+
+
+/**
+ * Adds a new edge to the graph. The edge connects two specified vertices.
+ *
+ * Parameters:
+ * >tail
+ * Tail vertex, where the new edge begins.
+ * >head
+ * Head vertex, where the new edge ends.
+ * >length
+ * Size of the new edge.
+ * >directed
+ * Determines edge style: is it directed or not.
+ * >color
+ * Edge drawing color.
+ *
+ * Returns:
+ * Pointer to the new edge instance.
+ *
+ * Stiffness of the new edge is assigned by this graph's 'stifness' parameter.
+ *
+ * Remarks:
+ * This method obtains shared lock on the `m_verticesLock` mutex to read the parameter, releases it and then obtains
+ * exclusive locks on the `m_verticesLock` and `m_edgesLock` mutexes.
+ */
+edge* graph::addEdge(
+    _In_ vertex* tail,
+    _In_ vertex* head,
+    _In_ const float length,
+    _In_ const bool directed,
+    _In_ const D2D1_COLOR_F& color)
+{
+    float stiffness;
+    {
+        STLADD lock_guard_shared<WAPI srw_lock> verticesLock {m_verticesLock};
+        stiffness = m_parameters.stiffness;
+    }
+    return addEdge(tail, head, length, stiffness, directed, color);
+}
+
+
+/**
+ * Adds a new vertex to the graph if the latter doesn't have a vertex with the same name.
+ *
+ * Parameters:
+ * >name
+ * New vertex name.
+ *
+ * Returns:
+ * Pointer to the new vertex instance.
+ *
+ * Remarks:
+ * The caller of this method MUST obtain exclusive lock on the `m_verticesLock` mutex. Because:
+ * a) This method changes the internal vertices container,
+ * b) This method returns pointer to a vertex, stored in the internal container. And at least shared lock must exist
+ *    after this method has returned the pointer to the caller. But because I use SRW lock, that neither can be
+ *    recursive nor can be upgraded from shared to exclusive mode, the caller has to obtain exclusive SRW lock from the
+ *    beginning.
+ *
+ * Therefore, BE CAREFUL: this method doesn't obtain any locks! It totally relies on caller.
+ *
+ * The new vertex is placed at the centroid of the graph (see the `updateGraphBound` method), moved off it by a random
+ * offset up to `m_placementJitter` along each axis. It's moved next to its neighbour when it gets its first edge (see
+ * the `connect` method).
+ */
+vertex* graph::addVertex(_In_ STLADD string_type&& name)
+{
+    // Here we can end up with issuing an unnecessary call to "get randomly distributed values".
+    __m128 offset = _mm_sub_ps(
+        _mm_mul_ps(m_random.next(), _mm_set1_ps(m_placementJitter * 2.0f)), _mm_set1_ps(m_placementJitter));
+    return addVertex(std::move(name), _mm_add_ps(m_centroid, _mm_movelh_ps(offset, getZeroVector())));
+}
+
+
+/**
+ * Adds a new vertex to the graph if the latter doesn't have a vertex with the same name.
+ *
+ * Parameters:
+ * >name
+ * New vertex name.
+ * >coordinates
+ * Coordinates of the new vertex.
+ *
+ * Returns:
+ * Pointer to the new vertex instance.
+ *
+ * Remarks:
+ * The caller of this method MUST obtain exclusive lock on the `m_verticesLock` mutex. Because:
+ * a) This method changes the internal vertices container,
+ * b) This method returns pointer to a vertex, stored in the internal container. And at least shared lock must exist
+ *    after this method has returned the pointer to the caller. But because I use SRW lock, that neither can be
+ *    recursive nor can be upgraded from shared to exclusive mode, the caller has to obtain exclusive SRW lock from the
+ *    beginning.
+ *
+ * Therefore, BE CAREFUL: this method doesn't obtain any locks! It totally relies on caller.
+ */
+vertex* __vectorcall graph::addVertex(_In_ STLADD string_type&& name, _In_ const __m128 coordinates)
+{
+    /*
+     * About order of evaluation of inside initializer-list.
+     * >8.5.4 List-initialization [dcl.init.list]
+     * >4 Within the initializer-list of a braced-init-list, the initializer-clauses, including any that result from
+     * >pack expansions (14.5.3), are evaluated in the order in which they appear. That is, every value computation and
+     * >side effect associated with a given initializer-clause is sequenced before every value computation and
+     * >side effect associated with any initializer-clause that follows it in the comma-separated list of the
+     * >initializer-list. [Note: This evaluation ordering holds regardless of the semantics of the initialization;
+     * >for example, it applies when the elements of the initializer-list are interpreted as arguments of a constructor
+     * >call, even though ordinarily there are no sequencing constraints on the arguments of a call. -end note].
+     *
+     * If MSVC 2015 Update 2 will really consider this as it's expected (MSVC before 2015 Update 2 release doesn't),
+     * the following code can be changed like this:
+     * // For MSVC 2015 Update 1 and below:
+     * STLADD string_type key {name};
+     * std::pair<vertices_cont_t::iterator, bool> result =
+     *     m_vertices.emplace(key, vertex {std::move(name), coordinates});
+     *
+     * // For MSVC 2015 Update 2 and above:
+     * std::pair<vertices_cont_t::iterator, bool> result =
+     *     m_vertices.insert({STLADD string_type {name}, vertex {std::move(name), coordinates}});
+     *
+     * Thus, the above code for 'VC 2015 Update 2' calls this template ctor of `std::pair`:
+     * std::pair(std::basic_string<...>& _Val1, arbor::vertex&& _Val2 = {...});
+     * with arguments deduced as:
+     *     - for template ctor itself: <std::basic_string<...>& __ptr64, arbor::vertex, void>,
+     *     - for `pair` template class: <std::basic_string<...> const, arbor::vertex>.
+     * Following [8.5.4.4] the code, at first, makes a copy of `name` argument (passing it as `_Val1` parameter),
+     * and after that the code moves `name` into `vertex` ctor.
+     */
+    std::pair<vertices_cont_t::iterator, bool> result =
+        m_vertices.insert({STLADD string_type {name}, vertex {std::move(name), &m_physics, m_physics.size()}});
+    if (result.second)
+    {
+        m_physics.add(coordinates);
+        m_connected.push_back(0);
+    }
+    return &(result.first->second);
+}
+
+
+/**
+ * Marks the vertices of a new edge as connected; if either of them hasn't had an edge yet, places it next to the other
+ * one.
+ *
+ * Parameters:
+ * >tail
+ * Identifier of the tail vertex.
+ * >head
+ * Identifier of the head vertex.
+ * >length
+ * Length of the new edge.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains no lock. Caller of this method must hold exclusive locks on both the `m_verticesLock` and
+ * `m_edgesLock` mutexes.
+ *
+ * If both vertices are new, the head one is placed next to the tail one, so a chain of edges streamed into the graph
+ * grows from the vertex it's attached to. A fixed vertex isn't moved. See the `getPlacementNear` method.
+ */
+void graph::connect(_In_ const size_t tail, _In_ const size_t head, _In_ const float length)
+{
+    if (!m_connected[head] && !m_physics.getFixed(head))
+    {
+        m_physics.setCoordinates(head, getPlacementNear(m_physics.getCoordinates(tail), length));
+    }
+    else if (!m_connected[tail] && !m_physics.getFixed(tail))
+    {
+        m_physics.setCoordinates(tail, getPlacementNear(m_physics.getCoordinates(head), length));
+    }
+    m_connected[tail] = 1;
+    m_connected[head] = 1;
+}
+
+
+/**
+ * Chooses coordinates of a new vertex connected to an existing one.
+ *
+ * Parameters:
+ * >neighbor
+ * Coordinates of the existing vertex.
+ * >length
+ * Length of the edge between the vertices.
+ *
+ * Returns:
+ * Coordinates at the `length` distance from the `neighbor`.
+ *
+ * Remarks:
+ * The spring of the edge is at rest, so the new vertex doesn't pull its neighbour. The direction is random, but it's
+ * biased away from the centroid of the graph, where the repulsion of the other vertices pushes the new vertex anyway:
+ * new leaves grow outward instead of falling into the laid out graph.
+ */
+__m128 __vectorcall graph::getPlacementNear(_In_ const __m128 neighbor, _In_ const float length) noexcept
+{
+    sse_t value;
+    _mm_store_ps(value.data, _mm_movelh_ps(m_random.next(), _mm_sub_ps(neighbor, m_centroid)));
+    float x = value.data[0] * 2.0f - 1.0f;
+    float y = value.data[1] * 2.0f - 1.0f;
+    float distance = std::sqrt(value.data[2] * value.data[2] + value.data[3] * value.data[3]);
+    if (0.0f < distance)
+    {
+        x += value.data[2] / distance;
+        y += value.data[3] / distance;
+    }
+    float size = std::sqrt(x * x + y * y);
+    if (0.0f < size)
+    {
+        x *= length / size;
+        y *= length / size;
+    }
+    else
+    {
+        x = length;
+    }
+    return _mm_add_ps(neighbor, _mm_setr_ps(x, y, 0.0f, 0.0f));
+}
+
+
+/**
+ * Recalculates bounds of the rectangle containing all vertices. New rectangle is stored as updated `m_graphBound`.
+ * Centroid of the vertices, found by the same pass, is stored as updated `m_centroid`.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method DOES NOT obtain any lock while it accesses the graph's vertices. Caller of this method must guarantee
+ * that other threads can't access graph's data while this method works. This method doesn't lock the vertices because
+ * edges and vertices locks must be obtained in the specific order only (see remarks section for the `graph::addEdge`
+ * method), but noone knows when this method will be called (after of before edges lock was/will be obtained).
+ *
+ * This is `ArborGVT::ArborSystem::updateGraphBounds` method in the original C# code.
+ */
+void graph::updateGraphBound()
+{
+    sse_t value;
+    value.data[0] = -m_placementBound;
+    value.data[1] = m_placementBound;
+    __m128 temp = _mm_load_ps(value.data);
+    temp  = _mm_shuffle_ps(temp, temp, 0b01010000);
+    __m128 sum = getZeroVector();
+    size_t count = 0;
+    for (size_t i = 0; m_physics.size() > i; ++i)
+    {
+        __m128 coordinate = m_physics.getCoordinates(i);
+        if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinate, coordinate))))
+        {
+            sum = _mm_add_ps(sum, coordinate);
+            ++count;
+            int compare = _mm_movemask_ps(_mm_cmplt_ps(coordinate, temp));
+            if (0b0001 & compare)
+            {
+                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b01100100);
+                temp = _mm_shuffle_ps(temp2, temp, 0b11101100);
+            }
+            if (0b0010 & compare)
+            {
+                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b00100100);
+                temp = _mm_shuffle_ps(temp2, temp, 0b11100111);
+            }
+            temp = _mm_shuffle_ps(temp, temp, 0b01001110);
+            compare = _mm_movemask_ps(_mm_cmpgt_ps(coordinate, temp));
+            if (0b0001 & compare)
+            {
+                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b01100100);
+                temp = _mm_shuffle_ps(temp2, temp, 0b11101100);
+            }
+            if (0b0010 & compare)
+            {
+                __m128 temp2 = _mm_shuffle_ps(coordinate, temp, 0b00100100);
+                temp = _mm_shuffle_ps(temp2, temp, 0b11100111);
+            }
+            temp = _mm_shuffle_ps(temp, temp, 0b01001110);
+        }
+    }
+    m_graphBound = temp;
+    m_centroid = count ? _mm_div_ps(sum, _mm_set1_ps(static_cast<float> (count))) : getZeroVector();
+}
+
+
+/**
+ * Makes animation step. This method increments the "view area" by one step toward the "graph area".
+ *
+ * Parameters:
+ * >viewBound
+ * The current view area.
+ * >graphBound
+ * The graph area.
+ * >renderSurfaceSize
+ * Size (in DIPs, logical size) of a surface where the graph is rendered.
+ *
+ * Returns:
+ * The next view area.
+ *
+ * Remarks:
+ * This method doesn't access any graph, so a renderer can animate its own view area toward the graph area of a
+ * snapshot (see the `acquireSnapshot` method) without any lock. The renderer calls this method once per frame, so the
+ * view animation doesn't depend on the simulation rate. Zero `viewBound` means that the animation hasn't begun yet; the
+ * method returns the `graphBound` in this case.
+ *
+ * This is `ArborGVT::ArborSystem::updateViewBounds` method in the original C# code.
+ */
+__m128 graph::getNextViewBound(
+    _In_ const __m128 viewBound, _In_ const __m128 graphBound, _In_ const __m128 renderSurfaceSize) noexcept
+{
+    __m128 result = graphBound;
+    if (0b1111 != (0b1111 & _mm_movemask_ps(_mm_cmpeq_ps(viewBound, getZeroVector()))))
     {
-        __m128 temp = _mm_sub_ps(m_graphBound, m_viewBound);
+        result = viewBound;
+        __m128 temp = _mm_sub_ps(graphBound, viewBound);
         sse_t value;
         value.data[0] = m_animationStep;
         __m128 temp2 = _mm_load_ps(value.data);
@@ -413,18 +1615,133 @@ void graph::updateViewBound(_In_ const __m128 renderSurfaceSize)
         temp2 = _mm_shuffle_ps(temp2, temp2, 0);
         if (0b0011 & _mm_movemask_ps(_mm_cmpgt_ps(temp, temp2)))
         {
-            m_viewBound = _mm_add_ps(m_viewBound, delta);
+            result = _mm_add_ps(viewBound, delta);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * Moves the `m_viewBound` by one animation step toward the `m_graphBound`.
+ *
+ * Parameters:
+ * >renderSurfaceSize
+ * Size (in DIPs, logical size) of a surface where this graph is rendered.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method DOES NOT obtain any lock. Caller of this method must hold the `m_verticesLock` mutex. See the
+ * `getNextViewBound` method.
+ */
+void graph::updateViewBound(_In_ const __m128 renderSurfaceSize) noexcept
+{
+    m_viewBound = getNextViewBound(m_viewBound, m_graphBound, renderSurfaceSize);
+}
+
+
+/**
+ * Publishes the current layout of this graph (coordinates of the vertices, the `m_graphBound`, numbers of vertices and
+ * edges, and the generation) as a new snapshot.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method DOES NOT obtain any lock. Caller of this method must hold exclusive locks on both the `m_verticesLock`
+ * and `m_edgesLock` mutexes; besides guarding the data, this makes the method the only writer of the `m_snapshots`.
+ *
+ * The snapshot is read by the `acquireSnapshot` method without any lock, so a renderer never waits for a step and a
+ * step never waits for a frame. Only one thread (the renderer's one) may call the `acquireSnapshot` method; the
+ * snapshot it returns stays unchanged until the next call.
+ */
+void graph::publishSnapshot()
+{
+    m_snapshots.getBack()->assign(m_physics, m_edges.size(), m_graphBound, m_generation, m_step);
+    m_snapshots.publish();
+}
+
+
+/**
+ * Updates physical parameters of this graph (moves to the next animation step).
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains no lock.
+ *
+ * The method counts steps in a row whose mean energy is below the `energyThreshold` parameter; when there are
+ * `stopSteps` of them and the `autoStop` parameter is set, the graph is at rest (see the `active` method). If the
+ * `sleep` parameter is set, single vertices fall asleep and wake up too (see the `updateRest` method). Velocities of
+ * the vertices are zeroed before the step only for the `EulerIntegrator`.
+ *
+ * This is `ArborGVT::ArborSystem::updatePhysics` method in the original C# code.
+ */
+void graph::updatePhysics()
+{
+    ++m_step;
+    // Random values used by the serial parts of the step (trees building) depend on the step number and the seed only.
+    seedRandomVector(getStepSeed());
+    // > Tend particles.
+    if (EulerIntegrator == m_parameters.integrator)
+    {
+        __m128 zero = getZeroVector();
+        for (size_t i = 0; m_physics.size() > i; ++i)
+        {
+            m_physics.setVelocity(i, zero);
+        }
+    }
+    if (m_parameters.sleep && (0 == m_step % m_parameters.sleepSteps))
+    {
+        m_physics.probeAll();
+    }
+    m_springs.wakeAdded(&m_physics);
+    applySprings();
+    m_repulsionStatistics.targets = m_physics.size() - m_physics.getSleepingNumber();
+    if (0.0f < m_parameters.repulsion)
+    {
+        chooseRepulsion();
+        if (m_exactRepulsion)
+        {
+            applyExactRepulsion();
+        }
+        else
+        {
+            updateTheta();
+            applyBarnesHutRepulsion(&m_flatTree);
+        }
+    }
+    updateVelocityAndPosition(
+        (VerletIntegrator == m_parameters.integrator) ? chooseTimeSlice() : m_parameters.timeSlice);
+    if (m_parameters.sleep)
+    {
+        updateRest();
+    }
+    if (m_parameters.energyThreshold > m_meanOfEnergy)
+    {
+        if (m_parameters.stopSteps > m_restSteps)
+        {
+            ++m_restSteps;
         }
     }
     else
     {
-        m_viewBound = m_graphBound;
+        m_restSteps = 0;
     }
 }
 
 
 /**
- * Updates physical parameters of this graph (moves to the next animation step).
+ * Chooses Barnes Hut theta for the current step of the simulation.
  *
  * Parameters:
  * None.
@@ -433,33 +1750,72 @@ void graph::updateViewBound(_In_ const __m128 renderSurfaceSize)
  * N/A.
  *
  * Remarks:
- * This method obtains no lock.
+ * Accuracy of the repulsion forces barely matters while the vertices move fast, so the theta is the `maxTheta`
+ * parameter while mean energy of the previous step isn't less than `m_hotEnergy` (and on the first step, when the
+ * energy is unknown). While the graph cools down to the `energyThreshold` parameter, the theta goes down to the
+ * `minTheta` parameter linearly with the logarithm of the energy: the energy changes by orders of magnitude during a
+ * layout.
  *
- * This is `ArborGVT::ArborSystem::updatePhysics` method in the original C# code.
+ * The `VerletIntegrator` keeps errors of the forces in the velocities, and a coarse approximation keeps its graph from
+ * cooling down, so its theta doesn't exceed `m_verletMaxTheta` (unless the `minTheta` parameter does).
  */
-void graph::updatePhysics()
+void graph::updateTheta()
 {
-    // > Tend particles.
-    __m128 zero = getZeroVector();
-    for (auto it = m_vertices.begin(); m_vertices.end() != it; ++it)
+    float maxTheta = m_parameters.maxTheta;
+    if ((VerletIntegrator == m_parameters.integrator) && (m_verletMaxTheta < maxTheta))
+    {
+        maxTheta = (m_verletMaxTheta > m_parameters.minTheta) ? m_verletMaxTheta : m_parameters.minTheta;
+    }
+    float theta;
+    if ((0.0f == m_meanOfEnergy) || (m_hotEnergy <= m_meanOfEnergy))
     {
-        it->second.setVelocity(zero);
+        theta = maxTheta;
     }
-//    if (0 < m_stiffness) -- these are "warning C4127: conditional expression is constant".
+    else if (m_parameters.energyThreshold >= m_meanOfEnergy)
     {
-        applySprings();
+        theta = m_parameters.minTheta;
     }
-    // > Euler integrator.
-//    if (0 < m_repulsion)
+    else
     {
-        applyBarnesHutRepulsion();
+        float ratio = std::log(m_meanOfEnergy / m_parameters.energyThreshold) /
+            std::log(m_hotEnergy / m_parameters.energyThreshold);
+        theta = m_parameters.minTheta + (maxTheta - m_parameters.minTheta) * ratio;
     }
-    updateVelocityAndPosition(m_timeSlice);
+    m_repulsionStatistics.theta = theta;
 }
 
 
 /**
- * Creates Barnes Hut simulation over this graph's vertices.
+ * Chooses between exact and Barnes Hut repulsion forces for the current step.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains no lock.
+ *
+ * A graph switches to a Barnes Hut tree when it reaches `m_exactRepulsionLimit` vertices, but it switches back only
+ * when it has fewer than `m_barnesHutRepulsionLimit` vertices, so a graph growing around the limit (or the levels of
+ * the `MultilevelLayout` near it) doesn't change the repulsion and the sleep rules (see the `updateRest` method) back
+ * and forth. Both ways compute the same forces, up to the Barnes Hut approximation. A tree kept by the `m_flatTree`
+ * is discarded when the graph switches, because the vertices have moved without it.
+ */
+void graph::chooseRepulsion()
+{
+    const size_t size = m_physics.size();
+    if (m_exactRepulsion ? (m_exactRepulsionLimit <= size) : (m_barnesHutRepulsionLimit > size))
+    {
+        m_exactRepulsion = !m_exactRepulsion;
+        m_flatTree.discard();
+    }
+}
+
+
+/**
+ * Applies exact repulsion forces to all vertices of this graph.
  *
  * Parameters:
  * None.
@@ -470,22 +1826,247 @@ void graph::updatePhysics()
  * Remarks:
  * This method obtains no lock.
  *
+ * The forces are computed by `BHUT all_pairs_repulsion` on all threads of the `m_threadPool`. Zero theta is reported
+ * for them. Sleeping vertices don't get the forces.
+ */
+void graph::applyExactRepulsion()
+{
+    m_allPairs.load(&m_physics);
+    m_allPairs.applyForces(m_parameters.repulsion, getStepSeed(), &m_threadPool);
+    size_t size = m_physics.size();
+    m_repulsionStatistics.theta = 0.0f;
+    m_repulsionStatistics.interactions = size ? m_repulsionStatistics.targets * (size - 1) : 0;
+}
+
+
+/**
+ * Creates Barnes Hut simulation over this graph's vertices.
+ *
+ * Parameters:
+ * >tree
+ * Flat tree of the engines that use `BHUT flat_barnes_hut_tree`: the `m_flatTree`, or a separate tree that doesn't
+ * change the state kept by the `m_flatTree` between steps (see the `measureRepulsionError` method).
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains no lock.
+ *
  * This is `ArborGVT::ArborSystem::applyBarnesHutRepulsion` method in the original C# code.
+ *
+ * The tree, selected by the `m_repulsionEngine` member, is built inside a storage owned by this graph. The storage is
+ * rewound here, not freed, so the previous step's tree is dropped at once and its memory is reused by the new one.
  */
-void graph::applyBarnesHutRepulsion()
+void graph::applyBarnesHutRepulsion(_Inout_ BHUT flat_barnes_hut_tree* tree)
 {
-    BHUT barnes_hut_tree simulation {m_graphBound, m_theta};
-    for (auto it = m_vertices.begin(); m_vertices.end() != it; ++it)
+    m_repulsionStatistics.interactions = 0;
+    switch (m_repulsionEngine)
     {
-        simulation.insert(&(it->second));
+        case PointerBarnesHutTree:
+        {
+            applyBarnesHutRepulsion(repulsion_engine_type<PointerBarnesHutTree> {}, tree);
+        }
+        break;
+
+        case FlatBarnesHutTree:
+        {
+            applyBarnesHutRepulsion(repulsion_engine_type<FlatBarnesHutTree> {}, tree);
+        }
+        break;
+
+        case SortedFlatBarnesHutTree:
+        {
+            applyBarnesHutRepulsion(repulsion_engine_type<SortedFlatBarnesHutTree> {}, tree);
+        }
+        break;
+
+        case IncrementalFlatBarnesHutTree:
+        {
+            applyBarnesHutRepulsion(repulsion_engine_type<IncrementalFlatBarnesHutTree> {}, tree);
+        }
+        break;
+
+        default:
+        {
+            applyBarnesHutRepulsion(repulsion_engine_type<DualTreeFlatBarnesHutTree> {}, tree);
+        }
+        break;
     }
-    for (auto it = m_vertices.begin(); m_vertices.end() != it; ++it)
+}
+
+
+/**
+ * Builds `BHUT barnes_hut_tree` over this graph's vertices and applies repulsion forces to them.
+ *
+ * Parameters:
+ * >tree
+ * Not used: the tree is built inside the `m_treeArena`.
+ *
+ * Returns:
+ * N/A.
+ */
+void graph::applyBarnesHutRepulsion(
+    _In_ repulsion_engine_type<PointerBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree*)
+{
+    m_treeArena.reset();
+    BHUT barnes_hut_tree simulation {m_graphBound, m_repulsionStatistics.theta, m_treeArena, &m_physics};
+    insertVertices(simulation);
+    applyRepulsion(simulation, &m_treeStacks);
+}
+
+
+/**
+ * Builds `BHUT flat_barnes_hut_tree` over this graph's vertices and applies repulsion forces to them.
+ *
+ * Parameters:
+ * >tree
+ * The tree.
+ *
+ * Returns:
+ * N/A.
+ */
+void graph::applyBarnesHutRepulsion(
+    _In_ repulsion_engine_type<FlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree)
+{
+    tree->reset(m_graphBound, m_repulsionStatistics.theta, &m_physics);
+    insertVertices(*tree);
+    applyRepulsion(*tree, &m_flatTreeStacks);
+}
+
+
+/**
+ * Builds `BHUT flat_barnes_hut_tree` over this graph's vertices by the Morton codes sorting and applies repulsion forces
+ * to the vertices.
+ *
+ * Parameters:
+ * >tree
+ * The tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Unlike the other engines, this one builds the tree using all threads of the `m_threadPool`.
+ */
+void graph::applyBarnesHutRepulsion(
+    _In_ repulsion_engine_type<SortedFlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree)
+{
+    tree->build(m_graphBound, m_repulsionStatistics.theta, &m_physics, &m_threadPool);
+    applyRepulsion(*tree, &m_flatTreeStacks);
+}
+
+
+/**
+ * Updates `BHUT flat_barnes_hut_tree`, built over this graph's vertices by the previous step, and applies repulsion
+ * forces to the vertices.
+ *
+ * Parameters:
+ * >tree
+ * The tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * See the `BHUT flat_barnes_hut_tree::update` method about when the tree is refitted and when it's rebuilt.
+ */
+void graph::applyBarnesHutRepulsion(
+    _In_ repulsion_engine_type<IncrementalFlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree)
+{
+    tree->update(m_graphBound, m_repulsionStatistics.theta, &m_physics, &m_threadPool);
+    applyRepulsion(*tree, &m_flatTreeStacks);
+}
+
+
+/**
+ * Updates `BHUT flat_barnes_hut_tree`, built over this graph's vertices by the previous step, and applies repulsion
+ * forces to the vertices by the dual tree walk.
+ *
+ * Parameters:
+ * >tree
+ * The tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The tree is kept as `IncrementalFlatBarnesHutTree` engine does it. See the `BHUT flat_barnes_hut_tree::applyForces`
+ * method about the walk; it uses all threads of the `m_threadPool` and its result doesn't depend on their number.
+ */
+void graph::applyBarnesHutRepulsion(
+    _In_ repulsion_engine_type<DualTreeFlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree)
+{
+    tree->update(m_graphBound, m_repulsionStatistics.theta, &m_physics, &m_threadPool);
+    m_repulsionStatistics.interactions = tree->applyForces(m_parameters.repulsion, getStepSeed(), &m_threadPool);
+}
+
+
+/**
+ * Places all vertices of this graph into the specified empty Barnes Hut tree, one by one.
+ *
+ * Parameters:
+ * >simulation
+ * Barnes Hut tree, either `BHUT barnes_hut_tree` or `BHUT flat_barnes_hut_tree`.
+ *
+ * Returns:
+ * N/A.
+ */
+template <typename T>
+void graph::insertVertices(_In_ T& simulation)
+{
+    for (size_t i = 0; m_physics.size() > i; ++i)
     {
-        simulation.applyForce(&(it->second), m_repulsion);
+        simulation.insert(i);
     }
 }
 
 
+/**
+ * Applies repulsion forces of the specified Barnes Hut tree to all vertices of this graph.
+ *
+ * Parameters:
+ * >simulation
+ * Barnes Hut tree, either `BHUT barnes_hut_tree` or `BHUT flat_barnes_hut_tree`, built over the `m_physics`.
+ * >stacks
+ * Container of stacks used to walk the `simulation` tree.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The tree is read-only here, and forces are applied by all threads of the `m_threadPool`: each thread takes its own
+ * contiguous range of the vertex identifiers and its own stack. Applying forces to a vertex writes to that vertex
+ * only.
+ *
+ * Result doesn't depend on number of threads. The tree is walked in the same order for each vertex, and the random
+ * engine is seeded by the step number and the vertex ordinal before each vertex is processed (a random direction is
+ * required when a vertex coincides with another one or with a branch's center of mass). Sleeping vertices are skipped.
+ */
+template <typename T, typename S>
+void graph::applyRepulsion(_In_ T& simulation, _In_ S* stacks)
+{
+    stacks->resize(m_threadPool.getThreadsNumber());
+    uint32_t seed = getStepSeed();
+    auto task = [this, &simulation, stacks, seed] (_In_ const size_t index, _In_ const size_t count) -> void
+    {
+        size_t size = m_physics.size();
+        size_t last = size * (index + 1) / count;
+        auto elements = &((*stacks)[index]);
+        for (size_t i = size * index / count; last > i; ++i)
+        {
+            if (m_physics.getSleeping(i))
+            {
+                continue;
+            }
+            seedRandomVector(seed + static_cast<uint32_t> (i) + 1);
+            simulation.applyForce(i, m_parameters.repulsion, elements);
+        }
+    };
+    m_threadPool.run(task);
+}
+
+
 /**
  * Changes forces, applied to both vertices of each edge.
  *
@@ -501,62 +2082,41 @@ void graph::applyBarnesHutRepulsion()
  * and vertices locks must be obtained in the specific order only (see remarks section for the `graph::addEdge` method),
  * but noone knows when this method will be called (after of before vertices lock was/will be obtained).
  *
+ * The forces are computed and applied by threads of the `m_threadPool`; the result doesn't depend on number of the
+ * threads (see `spring_set` class).
+ *
  * This is `ArborGVT::ArborSystem::applySprings` method in the original C# code.
  */
 void graph::applySprings()
 {
-    __m128 zero = getZeroVector();
-    for (auto it = m_edges.begin(); m_edges.end() != it; ++it)
+    m_springs.apply(&m_physics, getStepSeed(), &m_threadPool);
+}
+
+
+/**
+ * Chooses time slice of the current step for the `VerletIntegrator`.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * The time slice.
+ *
+ * Remarks:
+ * The fastest vertex of the last step mustn't move by more than the `maxDisplacement` parameter, and the time slice
+ * mustn't grow faster than by `m_timeSliceGrowth` times per step (a sudden long step after a calm one could throw the
+ * vertices apart, as stiff springs change their forces faster than velocities show it). The result is limited by the
+ * `timeSlice` and `maxTimeSlice` parameters. A change of the graph or of the parameters resets the time slice to the
+ * `timeSlice` one (see the `acceptChanges` method).
+ */
+float graph::chooseTimeSlice() const noexcept
+{
+    float result = std::min(m_timeSlice * m_timeSliceGrowth, m_stableTimeSlice);
+    if (0.0f < m_maxVelocity)
     {
-        vertex* tail = (*it)->getTail();
-        vertex* head = (*it)->getHead();
-        __m128 temp = _mm_sub_ps(head->getCoordinates(), tail->getCoordinates());
-        __m128 temp2;
-        if (simd_cpu_capabilities::sse41())
-        {
-            temp2 = _mm_dp_ps(temp, temp, 0b00111111);
-        }
-        else
-        {
-            temp2 = _mm_shuffle_ps(temp, temp, 0b01000100);
-            temp2 = _mm_mul_ps(temp2, temp2);
-            temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
-        }
-        temp2 = _mm_sqrt_ps(temp2);
-        __m128 oldSize = temp2;
-        if (0b1111 & _mm_movemask_ps(_mm_cmpeq_ps(temp2, zero)))
-        {
-            temp = randomVector(1.0f);
-            if (simd_cpu_capabilities::sse41())
-            {
-                temp2 = _mm_dp_ps(temp, temp, 0b00111111);
-            }
-            else
-            {
-                temp2 = _mm_mul_ps(temp, temp);
-                temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
-            }
-            temp2 = _mm_rsqrt_ps(temp2);
-        }
-        else
-        {
-            temp2 = _mm_rcp_ps(temp2);
-        }
-        temp = _mm_mul_ps(temp, temp2);
-        sse_t value;
-        value.data[0] = (*it)->getLength();
-        temp2 = _mm_load_ps(value.data);
-        temp2 = _mm_shuffle_ps(temp2, temp2, 0);
-        oldSize = _mm_sub_ps(temp2, oldSize);
-        value.data[0] = (*it)->getStiffness() * 0.5f;
-        temp2 = _mm_load_ps(value.data);
-        temp2 = _mm_shuffle_ps(temp2, temp2, 0);
-        temp2 = _mm_mul_ps(temp2, oldSize);
-        temp = _mm_mul_ps(temp, temp2);
-        head->applyForce(temp);
-        temp = _mm_sub_ps(zero, temp);
-        tail->applyForce(temp);
+        result = std::min(result, m_parameters.maxDisplacement / std::sqrt(m_maxVelocity));
     }
+    return std::min(std::max(result, m_parameters.timeSlice), m_parameters.maxTimeSlice);
 }
 
 
@@ -565,7 +2125,8 @@ void graph::applySprings()
  *
  * Parameters:
  * >time
- * Constant time slice between two consequent updates?
+ * Time slice of the step: the `timeSlice` parameter for the `EulerIntegrator`, or the one chosen by the
+ * `chooseTimeSlice` method for the `VerletIntegrator`.
  *
  * Returns:
  * N/A.
@@ -576,124 +2137,156 @@ void graph::applySprings()
  * edges and vertices locks must be obtained in the specific order only (see remarks section for the `graph::addEdge`
  * method), but noone knows when this method will be called (after of before edges lock was/will be obtained).
  *
+ * The `integrator` parameter chooses the `physics_state::integrate` or the `physics_state::integrateVerlet` kernel.
+ * Mean energy of the `VerletIntegrator` is measured by the forces, not by the velocities (see the latter method), so
+ * the `energyThreshold` parameter and the Barnes Hut theta mean the same for both integrators.
+ *
  * This is `ArborGVT::ArborSystem::updateVelocityAndPosition` method in the original C# code.
  */
 void graph::updateVelocityAndPosition(_In_ const float time)
 {
-    if (!m_vertices.size())
+    const size_t count = m_physics.size();
+    if (!count)
     {
         m_meanOfEnergy = 0.0f;
         return;
     }
 
-    /*
-     * > Calculate center drift.
-     */
-    __m128 zero = getZeroVector();
-    __m128 energyTotal = zero;
-    __m128 drift = zero;
-    for (auto it = m_vertices.cbegin(); m_vertices.cend() != it; ++it)
-    {
-        drift = _mm_sub_ps(drift, it->second.getCoordinates());
-    }
-    sse_t value;
-    value.data[0] = static_cast<float> (m_vertices.size());
-    __m128 size = _mm_load_ps(value.data);
-    size = _mm_shuffle_ps(size, size, 0);
-    drift = _mm_mul_ps(drift, _mm_rcp_ps(size));
+    // > Calculate center drift.
+    float scale = -1.0f / static_cast<float> (count);
+    __m128 drift = _mm_mul_ps(m_physics.getCoordinatesSum(), _mm_load_ps1(&scale));
     /*
      * > Main updates loop.
      *
-     * Initialize loop invariants.
+     * Center drift, center gravity, velocities and positions are updated by the vectorized kernel, see
+     * `physics_state::integrate` method. The following dot product: `velocity` * `velocity` gives energy? Never knew.
      */
-    __m128 repulsion;
-    if (m_gravity)
+    float gravity = m_parameters.gravity ? m_parameters.repulsion * (-0.01f) : 0.0f;
+    float energy;
+    if (VerletIntegrator == m_parameters.integrator)
     {
-        value.data[0] = m_repulsion * (-0.01f);
-        repulsion = _mm_load_ps(value.data);
-        repulsion = _mm_shuffle_ps(repulsion, repulsion, 0);
+        /*
+         * Velocities are kept between steps, so momentum of the graph must be kept too: the net force, which exact
+         * forces don't have, but Barnes Hut ones do, is taken off each vertex by the center drift. Otherwise the error
+         * of the approximation pushes the whole graph, and it never comes to rest.
+         *
+         * The friction is given per `timeSlice`, so a longer step loses more velocity.
+         */
+        drift = _mm_add_ps(drift, _mm_mul_ps(m_physics.getForcesSum(), _mm_load_ps1(&scale)));
+        float damping = std::pow(1.0f - m_parameters.friction, time / m_parameters.timeSlice);
+        float kick = (m_timeSlice + time) * 0.5f;
+        float forces;
+        energy = m_physics.integrateVerlet(drift, gravity, damping, kick, time, &forces, &m_maxVelocity);
+        m_timeSlice = time;
+        /*
+         * The energy is measured as the Euler scheme would measure it: a vertex pushed by a steady force moves about
+         * 1 / `friction` times faster than the Euler scheme moves it, and the Euler scheme's velocity is the force
+         * times the time slice, reduced by the friction. The graph is at rest when its vertices are neither pushed nor
+         * moving.
+         */
+        float forceScale = (1.0f - m_parameters.friction) * m_parameters.timeSlice;
+        energy = energy * m_parameters.friction * m_parameters.friction + forces * forceScale * forceScale;
     }
-    /*
-     * Original C# code compares `velocity` vector length against the predefined constant (1'000). To avoid
-     * redundant square root op (SQRTPS) I use `velocity * velocity` dot product as is and compare it against
-     * 1'000'000 value.
-     *
-     * lim (x * x) = 1'000'000
-     * x -> 1'000
-     */
-#if defined(__ICL)
-    value.data[0] = 1000000.0f;
-#else
-    value.data[0] = 1'000'000.0f;
-#endif
-    __m128 velocityVectorLength = _mm_load_ps(value.data);
-    velocityVectorLength = _mm_shuffle_ps(velocityVectorLength, velocityVectorLength, 0);
-    value.data[0] = 1.0f - m_friction;
-    __m128 frictionCompVector = _mm_load_ps(value.data);
-    frictionCompVector = _mm_shuffle_ps(frictionCompVector, frictionCompVector, 0);
-    value.data[0] = time;
-    __m128 timeVector = _mm_load_ps(value.data);
-    timeVector = _mm_shuffle_ps(timeVector, timeVector, 0);
-    __m128 temp;
-    for (auto it = m_vertices.begin(); m_vertices.end() != it; ++it)
-    {
-        // > Apply center drift.
-        it->second.applyForce(drift);
-        // > Apply center gravity.
-        if (m_gravity)
-        {
-            temp = _mm_mul_ps(it->second.getCoordinates(), repulsion);
-            it->second.applyForce(temp);
-        }
-        // > Update velocity.
-        if (!it->second.getFixed())
-        {
-            temp = _mm_mul_ps(it->second.getForce(), timeVector);
-            __m128 velocity = _mm_add_ps(it->second.getVelocity(), temp);
-            velocity = _mm_mul_ps(velocity, frictionCompVector);
-            if (simd_cpu_capabilities::sse41())
-            {
-                temp = _mm_dp_ps(velocity, velocity, 0b00111111);
-            }
-            else
-            {
-                temp = _mm_shuffle_ps(velocity, velocity, 0b01000100);
-                temp = _mm_mul_ps(temp, temp);
-                temp = _mm_add_ps(temp, _mm_shuffle_ps(temp, temp, 0b10110001));
-            }
-            if (0b1111 & _mm_movemask_ps(_mm_cmpgt_ps(temp, velocityVectorLength)))
+    else
+    {
+        energy = m_physics.integrate(drift, gravity, m_parameters.friction, time);
+    }
+    m_meanOfEnergy = energy / static_cast<float> (count);
+}
+
+
+/**
+ * Puts calm vertices of this graph to sleep and wakes up neighbours of moving vertices.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This method obtains no lock; it's called by a step after the vertices have been moved.
+ *
+ * A vertex falls asleep after `sleepSteps` steps in a row with velocity below the `sleepVelocity` parameter and net
+ * force below the `sleepForce` parameter (see the `physics_state::updateRest` method). A sleeping vertex is woken up
+ * when an edge is added to it (by the next step, see the `spring_set::wakeAdded` method), when the other vertex of its
+ * edge moves (see the `spring_set::wakeNeighbors` method), and when a vertex of the same Barnes Hut cell moves (see
+ * the `wakeNeighbors` method). With exact repulsion forces every vertex is a neighbour of all others, so all vertices
+ * are woken up while any of them moves: a small graph falls asleep as a whole.
+ *
+ * Those rules are local, but forces of a sleeping vertex may also change because distant vertices move (a growing
+ * graph spreads out, for example). So every `sleepSteps` steps all vertices are awake for one step (see the
+ * `physics_state::probeAll` method), and the vertices that aren't calm anymore stay awake. A graph where a few vertices
+ * have been added computes forces of those vertices and their neighbourhood, plus all forces once per `sleepSteps`
+ * steps, while the settled vertices still repulse them.
+ */
+void graph::updateRest()
+{
+    size_t moving = m_physics.updateRest(
+        m_parameters.sleepVelocity, m_parameters.sleepForce, static_cast<uint8_t> (m_parameters.sleepSteps));
+    m_springs.wakeNeighbors(&m_physics);
+    if (0.0f < m_parameters.repulsion)
+    {
+        if (m_exactRepulsion)
+        {
+            if (moving)
             {
-                velocity = _mm_mul_ps(velocity, _mm_rcp_ps(temp));
+                m_physics.wakeAll();
             }
-            it->second.setVelocity(velocity);
         }
-        else
+        else if (PointerBarnesHutTree == m_repulsionEngine)
         {
-            it->second.setVelocity(zero);
+            wakeNeighbors(repulsion_engine_type<PointerBarnesHutTree> {});
         }
-        it->second.setForce(zero);
-        // > Update positions.
-        __m128 velocity = it->second.getVelocity();
-        temp = _mm_mul_ps(velocity, timeVector);
-        temp = _mm_add_ps(it->second.getCoordinates(), temp);
-        it->second.setCoordinates(temp);
-        // > Update energy.
-        if (simd_cpu_capabilities::sse41())
+        else
         {
-            temp = _mm_dp_ps(velocity, velocity, 0b00111111);
+            wakeNeighbors(repulsion_engine_type<DualTreeFlatBarnesHutTree> {});
         }
-        else
+    }
+}
+
+
+/**
+ * Wakes up sleeping vertices that share a cell of `BHUT flat_barnes_hut_tree` with a moving vertex.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The tree has been built or updated by this step, so it's up to date with the vertices.
+ */
+template <repulsion_engine E>
+void graph::wakeNeighbors(_In_ repulsion_engine_type<E>)
+{
+    m_flatTree.wakeNeighbors(&m_threadPool);
+}
+
+
+/**
+ * Wakes up all vertices if any of them moves.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * `BHUT barnes_hut_tree` is dropped right after the forces are applied, so there are no cells to find neighbours in.
+ */
+void graph::wakeNeighbors(_In_ repulsion_engine_type<PointerBarnesHutTree>)
+{
+    for (size_t i = 0; m_physics.size() > i; ++i)
+    {
+        if (m_physics.getMoving(i))
         {
-            temp = _mm_shuffle_ps(velocity, velocity, 0b01000100);
-            temp = _mm_mul_ps(temp, temp);
-            temp = _mm_add_ps(temp, _mm_shuffle_ps(temp, temp, 0b10110001));
+            m_physics.wakeAll();
+            break;
         }
-        // The following dot product: `velocity` * `velocity` gives energy? Never knew.
-        energyTotal = _mm_add_ps(energyTotal, temp);
     }
-    temp = _mm_mul_ps(energyTotal, _mm_rcp_ps(size));
-    _mm_store_ps(value.data, temp);
-    m_meanOfEnergy = value.data[0];
 }
 
 ARBOR_END
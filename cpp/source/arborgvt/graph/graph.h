@@ -1,18 +1,131 @@
 ﻿#pragma once
+#include "barnhut/allpairs.h"
+#include "barnhut/barnhut.h"
+#include "barnhut/bhutpool.h"
+#include "barnhut/flattree.h"
 #include "ns/arbor.h"
 #include "graph/edge.h"
+#include "graph/hierarchy.h"
+#include "graph/params.h"
+#include "graph/physics.h"
+#include "graph/random.h"
+#include "graph/snapshot.h"
+#include "graph/springs.h"
 #include "graph/vector.h"
 #include "graph/vertex.h"
 #include "service/sse.h"
 #include "service/stladdon.h"
+#include "service/thrdpool.h"
 #include "service/winapi/srwlock.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
-#include <random>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 ARBOR_BEGIN
 
+typedef enum
+{
+    // `BHUT barnes_hut_tree`, a tree of polymorphic elements, which refer each other by pointers.
+    PointerBarnesHutTree,
+    // `BHUT flat_barnes_hut_tree`, a tree stored in contiguous arrays.
+    FlatBarnesHutTree,
+    // `BHUT flat_barnes_hut_tree` built from vertices sorted by Morton codes, on all threads of the graph's pool.
+    SortedFlatBarnesHutTree,
+    // `BHUT flat_barnes_hut_tree` kept across simulation steps: refitted while vertices move a little, and rebuilt like
+    // `SortedFlatBarnesHutTree` when they don't.
+    IncrementalFlatBarnesHutTree,
+    // The same tree as `IncrementalFlatBarnesHutTree`, but forces are computed by walking the tree against itself
+    // (pairs of branches interact at once), not by walking it for each vertex.
+    DualTreeFlatBarnesHutTree
+}
+repulsion_engine;
+
+// Parameters of the last repulsion pass of a `graph`.
+struct repulsion_statistics
+{
+    // Barnes Hut theta used by the pass (see the `graph::updateTheta` method).
+    float theta;
+    // Number of forces computed by the pass. Only the exact repulsion and the `DualTreeFlatBarnesHutTree` engine count
+    // them, the other engines report zero.
+    size_t interactions;
+    // Number of vertices the pass computed forces for: the vertices that weren't sleeping (see the
+    // `simulation_parameters::sleep` parameter).
+    size_t targets;
+};
+
+// Relative error of Barnes Hut repulsion forces against the exact ones (see the `graph::measureRepulsionError` method).
+struct repulsion_error
+{
+    float maxError;
+    float meanError;
+};
+
+// Reason the `graph::layout` method has stopped for.
+typedef enum
+{
+    // Mean energy of the vertices has been below `layout_limits::energyThreshold` for `stopSteps` steps in a row.
+    LayoutConverged,
+    // The layout has made `layout_limits::maxSteps` steps.
+    LayoutStepLimit,
+    // The layout has taken `layout_limits::maxDuration` time.
+    LayoutTimeLimit,
+    // The `layout_limits::cancel` flag has been set.
+    LayoutCancelled
+}
+layout_stop_reason;
+
+// Ways the `graph::layout` method lays out a graph.
+typedef enum
+{
+    // Simulation steps over the graph itself, from its current layout.
+    FlatLayout,
+    // The graph is coarsened (see `graph_hierarchy`), the coarse levels are laid out from the coarsest one, each finer
+    // level starts from the layout of the coarser one, and the graph itself is refined by simulation steps.
+    MultilevelLayout
+}
+layout_method;
+
+// Stop conditions of the `graph::layout` method (see the `graph::getDefaultLayoutLimits` method).
+struct layout_limits
+{
+    // How the graph is laid out.
+    layout_method method;
+    // Mean energy of the vertices the layout converges at; it's used instead of the `energyThreshold` parameter, so a
+    // layout may go on after the simulation would have stopped. A layout with non-positive threshold never converges.
+    float energyThreshold;
+    // Maximum number of steps; zero means no limit.
+    uint32_t maxSteps;
+    // Maximum wall-clock time of the layout; zero means no limit. It's checked after each step, so a layout may exceed
+    // it by one step.
+    std::chrono::microseconds maxDuration;
+    // Flag checked before each step, it may be set by another thread to cancel the layout; it may be null.
+    const std::atomic<bool>* cancel;
+};
+
+// Statistics of a layout made by the `graph::layout` method.
+struct layout_statistics
+{
+    layout_stop_reason reason;
+    // Number of steps the layout has made, steps of the coarse levels included.
+    uint32_t steps;
+    // Number of coarse levels of the `MultilevelLayout` (zero for the `FlatLayout`).
+    uint32_t levels;
+    // Mean energy of the vertices after the first step and after the last one (zero if no step has been made).
+    float initialEnergy;
+    float energy;
+    // Wall-clock time of the layout, locks waiting excluded.
+    std::chrono::microseconds duration;
+    // Parameters of the last repulsion pass.
+    repulsion_statistics repulsion;
+};
+
 /**
  * `graph` implements a graph.
  *
@@ -27,7 +140,7 @@ ARBOR_BEGIN
  *
  * Edges are stored inside `std::vector` container as objects wrapped by `std::unique_ptr`s. Each edge object must also
  * be aligned on a 16-byte boundary. This is guaranteed by `edge` instance itself (with overloaded `new` and `delete`
- * operators).
+ * operators). Physics reads length and stiffness of an edge from the `m_springs` arrays, not from the edge object.
  *
  * Just because I'm "copying" from the C# source code base I'm adding to the `graph` class methods that do some physical
  * calculations. Logically it's a part of another class, but I'm making `graph` class just like Csharp's `ArborSystem`.
@@ -39,15 +152,41 @@ ARBOR_BEGIN
 class graph_settings
 {
 protected:
-    static constexpr float m_stiffness = 750.0f;
-    static constexpr float m_repulsion = 10'000.0f;
-    static constexpr float m_friction = 0.1f;
     static constexpr float m_animationStep = 0.04f;
-    static constexpr float m_timeSlice = 0.01f;
-    static constexpr float m_energyThreshold = 0.7f;
-    static constexpr float m_theta = 0.4f;
-    static constexpr bool m_gravity = false;
-    static constexpr bool m_autoStop = false;
+    // Graph bound of an empty graph is the square from -`m_placementBound` to `m_placementBound`; the graph bound never
+    // gets smaller than it.
+    static constexpr float m_placementBound = 2.0f;
+    // A vertex placed near its neighbours (see the `placeNearNeighbors` method) is moved off their center by up to
+    // `m_placementJitter` along each axis, so vertices with the same neighbours don't coincide.
+    static constexpr float m_placementJitter = 0.5f;
+    // Mean energy of the vertices above which Barnes Hut theta is `simulation_parameters::maxTheta`.
+    static constexpr float m_hotEnergy = 1000.0f;
+    // Maximum factor by which the time slice of the `VerletIntegrator` grows from one step to the next one.
+    static constexpr float m_timeSliceGrowth = 1.1f;
+    // The `VerletIntegrator` time slice multiplied by the square root of the greatest rigidity of a vertex (see the
+    // `spring_set::getMaxRigidity` method) doesn't exceed this value; the scheme becomes unstable at the square root of
+    // two.
+    static constexpr float m_stability = 1.0f;
+    // Maximum Barnes Hut theta of the `VerletIntegrator` (see the `updateTheta` method).
+    static constexpr float m_verletMaxTheta = 0.7f;
+    // Engine of the Barnes Hut repulsion a new graph starts with (see the `setRepulsionEngine` method).
+    static constexpr repulsion_engine m_defaultRepulsionEngine = DualTreeFlatBarnesHutTree;
+    // Default and maximum `simulation_parameters::leafCapacity`.
+    static constexpr uint32_t m_leafCapacity = 8;
+    static constexpr uint32_t m_maxLeafCapacity = 64;
+    // A graph gets exact repulsion forces (see `BHUT all_pairs_repulsion`) instead of a Barnes Hut tree until it has
+    // this number of vertices; it's where the exact forces stop being computed faster.
+    static constexpr size_t m_exactRepulsionLimit = 512;
+    // A graph with Barnes Hut repulsion gets exact forces again when it has fewer vertices than this (see the
+    // `chooseRepulsion` method).
+    static constexpr size_t m_barnesHutRepulsionLimit = 448;
+    // Default interval between two steps of the simulation thread, in microseconds (`ParamTimeout` of the C# code).
+    static constexpr std::chrono::microseconds::rep m_simulationInterval = 10'000;
+    // The `MultilevelLayout` coarsens a graph down to this number of vertices (see `graph_hierarchy`).
+    static constexpr size_t m_coarsestLevelSize = 64;
+    // Signature ('ARBL') and version of a layout file (see the `saveLayout` method).
+    static constexpr uint32_t m_layoutSignature = 0x4c425241;
+    static constexpr uint16_t m_layoutVersion = 1;
 };
 #endif
 
@@ -61,6 +200,14 @@ protected:
         std::equal_to<STLADD string_type>,
         STLADD aligned_sse_allocator<std::pair<const STLADD string_type, vertex>>> vertices_cont_t;
     typedef std::vector<std::unique_ptr<edge>, STLADD default_allocator<std::unique_ptr<edge>>> edges_cont_t;
+    typedef std::vector<
+        BHUT barnes_hut_tree::elements_stack_t,
+        STLADD default_allocator<BHUT barnes_hut_tree::elements_stack_t>> tree_stacks_cont_t;
+    typedef std::vector<
+        BHUT flat_barnes_hut_tree::elements_stack_t,
+        STLADD default_allocator<BHUT flat_barnes_hut_tree::elements_stack_t>> flat_tree_stacks_cont_t;
+    typedef std::vector<uint8_t, STLADD default_allocator<uint8_t>> bytes_cont_t;
+    typedef std::vector<uint32_t, STLADD default_allocator<uint32_t>> ids_cont_t;
 
     // Prepare tag dispatch pattern.
     template <typename T>
@@ -85,6 +232,12 @@ protected:
     typedef is_pair_type<true> is_pair_t;
     typedef is_pair_type<false> is_not_pair_t;
 
+    // Tag type to dispatch calls by the `m_repulsionEngine` member.
+    template <repulsion_engine>
+    struct repulsion_engine_type
+    {
+    };
+
     template <typename T, typename U>
     static T getReference(_In_ U value, is_pair_t) noexcept
     {
@@ -163,14 +316,50 @@ public:
         :
         m_vertices {},
         m_edges {},
-        m_distribution {-2.0f, 2.0f},
+        m_physics {},
+        m_springs {},
+        m_snapshots {},
+        m_treeArena {},
+        m_flatTree {m_leafCapacity},
+        m_allPairs {},
+        m_treeStacks {},
+        m_flatTreeStacks {},
+        m_threadPool {std::thread::hardware_concurrency()},
         m_verticesLock {},
         m_edgesLock {},
-        m_meanOfEnergy {0.0f}
+        m_connected {},
+        m_parameters (getDefaultParameters()),
+        m_repulsionEngine {m_defaultRepulsionEngine},
+        m_exactRepulsion {true},
+        m_meanOfEnergy {0.0f},
+        m_timeSlice {m_parameters.timeSlice},
+        m_maxVelocity {0.0f},
+        m_stableTimeSlice {m_parameters.timeSlice},
+        m_restSteps {0},
+        m_repulsionStatistics {m_parameters.maxTheta, 0, 0},
+        m_step {0},
+        m_random {m_parameters.seed},
+        m_generation {0},
+        m_simulationThread {},
+        m_simulationLock {},
+        m_simulationWakeUp {},
+        m_stepCallback {},
+        m_startCallback {},
+        m_stopCallback {},
+        m_interval {m_simulationInterval},
+        m_stepDuration {0},
+        m_stopSimulation {false},
+        m_changed {false}
     {
-        sse_t value = {m_distribution.a(), m_distribution.a(), m_distribution.b(), m_distribution.b()};
+        sse_t value = {-m_placementBound, -m_placementBound, m_placementBound, m_placementBound};
         m_graphBound = _mm_load_ps(value.data);
         m_viewBound = getZeroVector();
+        m_centroid = getZeroVector();
+    }
+
+    ~graph()
+    {
+        stopSimulation();
     }
 
     static void* operator new(_In_ const size_t size)
@@ -196,7 +385,7 @@ public:
     }
 
     void addEdge(_In_ STLADD string_type&& tail, _In_ STLADD string_type&& head, _In_ float length);
-    void clear() noexcept;
+    void clear();
 
     auto verticesBegin() noexcept
     {
@@ -218,6 +407,11 @@ public:
         return const_vertices_iterator {m_vertices.end()};
     }
 
+    __m128 __vectorcall getCoordinates(_In_ const vertex& v) const noexcept
+    {
+        return m_physics.getCoordinates(v.getId());
+    }
+
     auto edgesBegin() noexcept
     {
         return edges_iterator {m_edges.begin()};
@@ -240,14 +434,7 @@ public:
 
     bool active() const noexcept
     {
-        if (m_autoStop)
-        {
-            return (m_energyThreshold < m_meanOfEnergy) || (0.0f == m_meanOfEnergy);
-        }
-        else
-        {
-            return true;
-        }
+        return !m_parameters.autoStop || (m_parameters.stopSteps > m_restSteps);
     }
 
     __m128 __vectorcall getViewBound() const noexcept
@@ -255,7 +442,61 @@ public:
         return m_viewBound;
     }
 
+    size_t getThreadsNumber() const noexcept
+    {
+        return m_threadPool.getThreadsNumber();
+    }
+
+    void setThreadsNumber(_In_ const size_t threadsNumber);
+
+    repulsion_statistics getRepulsionStatistics() const noexcept
+    {
+        return m_repulsionStatistics;
+    }
+
+    repulsion_error measureRepulsionError();
+    static simulation_parameters getDefaultParameters() noexcept;
+    static layout_limits getDefaultLayoutLimits() noexcept;
+    simulation_parameters getParameters();
+    bool setParameters(_In_ const simulation_parameters& parameters);
+    repulsion_engine getRepulsionEngine();
+    bool setRepulsionEngine(_In_ const repulsion_engine engine);
+
+    uint32_t getGeneration() const noexcept
+    {
+        return m_generation;
+    }
+
+    const layout_snapshot& acquireSnapshot() noexcept
+    {
+        return m_snapshots.acquire();
+    }
+
+    static __m128 __vectorcall getNextViewBound(
+        _In_ const __m128 viewBound, _In_ const __m128 graphBound, _In_ const __m128 renderSurfaceSize) noexcept;
     void __vectorcall update(_In_ const __m128 renderSurfaceSize);
+    layout_statistics layout(_In_ const layout_limits& limits, _Out_ layout_snapshot* positions);
+    HRESULT saveLayout(_In_z_ LPCTSTR fileName);
+    HRESULT loadLayout(_In_z_ LPCTSTR fileName);
+    void startSimulation(_In_ std::function<void ()>&& stepCallback);
+    void stopSimulation();
+    void setStateCallbacks(_In_ std::function<void ()>&& startCallback, _In_ std::function<void ()>&& stopCallback);
+
+    std::chrono::microseconds getSimulationInterval() const noexcept
+    {
+        return std::chrono::microseconds {m_interval.load()};
+    }
+
+    void setSimulationInterval(_In_ const std::chrono::microseconds interval) noexcept
+    {
+        m_interval = interval.count();
+    }
+
+    std::chrono::microseconds getStepDuration() const noexcept
+    {
+        return std::chrono::microseconds {m_stepDuration.load()};
+    }
+
     vertex* addVertex(
         _In_ STLADD string_type&& name,
         _In_ const D2D1_COLOR_F& bkgndColor,
@@ -278,27 +519,115 @@ public:
 
 
 private:
+    // Header of a layout file, followed by `verticesNumber` records (see the `saveLayout` method).
+    struct layout_file_header
+    {
+        uint32_t signature;
+        uint16_t version;
+        // Size of a character of the vertex names.
+        uint16_t characterSize;
+        uint32_t verticesNumber;
+    };
+
+    // Record of a vertex in a layout file, followed by `nameLength` characters of the vertex name (not terminated).
+    struct layout_file_record
+    {
+        float x;
+        float y;
+        float velocityX;
+        float velocityY;
+        uint32_t nameLength;
+    };
+
+    // Returns seed of the random values used by the current step of the simulation.
+    uint32_t getStepSeed() const noexcept
+    {
+        return (m_step * 0x9e3779b9) ^ m_parameters.seed;
+    }
+
     vertex* addVertex(_In_ STLADD string_type&& name);
     vertex* __vectorcall addVertex(_In_ STLADD string_type&& name, _In_ const __m128 coordinates);
+    HRESULT applyLayout(_In_ const bytes_cont_t& buffer);
+    void placeNearNeighbors(_Inout_ bytes_cont_t* placed);
+    void connect(_In_ const size_t tail, _In_ const size_t head, _In_ const float length);
+    __m128 __vectorcall getPlacementNear(_In_ const __m128 neighbor, _In_ const float length) noexcept;
     void updateGraphBound();
-    void __vectorcall updateViewBound(_In_ const __m128 renderSurfaceSize);
+    void __vectorcall updateViewBound(_In_ const __m128 renderSurfaceSize) noexcept;
+    void publishSnapshot();
+    void notifyChange();
+    void acceptChanges();
+    void restartSimulation();
+    void layoutLevel(
+        _In_ const layout_limits& limits,
+        _In_ const std::chrono::steady_clock::time_point start,
+        _Inout_ layout_statistics* statistics);
+    void layoutLevels(
+        _In_ const layout_limits& limits,
+        _In_ const std::chrono::steady_clock::time_point start,
+        _Inout_ layout_statistics* statistics);
+    void simulationProc();
     void updatePhysics();
-    void applyBarnesHutRepulsion();
+    void updateTheta();
+    void chooseRepulsion();
+    void applyExactRepulsion();
+    void applyBarnesHutRepulsion(_Inout_ BHUT flat_barnes_hut_tree* tree);
+    void applyBarnesHutRepulsion(_In_ repulsion_engine_type<PointerBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree*);
+    void applyBarnesHutRepulsion(
+        _In_ repulsion_engine_type<FlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree);
+    void applyBarnesHutRepulsion(
+        _In_ repulsion_engine_type<SortedFlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree);
+    void applyBarnesHutRepulsion(
+        _In_ repulsion_engine_type<IncrementalFlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree);
+    void applyBarnesHutRepulsion(
+        _In_ repulsion_engine_type<DualTreeFlatBarnesHutTree>, _Inout_ BHUT flat_barnes_hut_tree* tree);
+    template <typename T>
+    void insertVertices(_In_ T& simulation);
+    template <typename T, typename S>
+    void applyRepulsion(_In_ T& simulation, _In_ S* stacks);
     void applySprings();
+    float chooseTimeSlice() const noexcept;
     void __fastcall updateVelocityAndPosition(_In_ const float time);
+    void updateRest();
+    template <repulsion_engine E>
+    void wakeNeighbors(_In_ repulsion_engine_type<E>);
+    void wakeNeighbors(_In_ repulsion_engine_type<PointerBarnesHutTree>);
 
 #if defined(__ICL)
-    static constexpr float m_stiffness = 750.0f;
-    // Intel C++ 16.0 doesn't support single-quotation mark as a digit separator for floating point types,
-    // it's a known bug with internal tracker DPD200379927.
-    static constexpr float m_repulsion = 10000.0f;
-    static constexpr float m_friction = 0.1f;
     static constexpr float m_animationStep = 0.04f;
-    static constexpr float m_timeSlice = 0.01f;
-    static constexpr float m_energyThreshold = 0.7f;
-    static constexpr float m_theta = 0.4f;
-    static constexpr bool m_gravity = false;
-    static constexpr bool m_autoStop = false;
+    // Graph bound of an empty graph is the square from -`m_placementBound` to `m_placementBound`; the graph bound never
+    // gets smaller than it.
+    static constexpr float m_placementBound = 2.0f;
+    // A vertex placed near its neighbours (see the `placeNearNeighbors` method) is moved off their center by up to
+    // `m_placementJitter` along each axis, so vertices with the same neighbours don't coincide.
+    static constexpr float m_placementJitter = 0.5f;
+    // Mean energy of the vertices above which Barnes Hut theta is `simulation_parameters::maxTheta`.
+    static constexpr float m_hotEnergy = 1000.0f;
+    // Maximum factor by which the time slice of the `VerletIntegrator` grows from one step to the next one.
+    static constexpr float m_timeSliceGrowth = 1.1f;
+    // The `VerletIntegrator` time slice multiplied by the square root of the greatest rigidity of a vertex (see the
+    // `spring_set::getMaxRigidity` method) doesn't exceed this value; the scheme becomes unstable at the square root of
+    // two.
+    static constexpr float m_stability = 1.0f;
+    // Maximum Barnes Hut theta of the `VerletIntegrator` (see the `updateTheta` method).
+    static constexpr float m_verletMaxTheta = 0.7f;
+    // Engine of the Barnes Hut repulsion a new graph starts with (see the `setRepulsionEngine` method).
+    static constexpr repulsion_engine m_defaultRepulsionEngine = DualTreeFlatBarnesHutTree;
+    // Default and maximum `simulation_parameters::leafCapacity`.
+    static constexpr uint32_t m_leafCapacity = 8;
+    static constexpr uint32_t m_maxLeafCapacity = 64;
+    // A graph gets exact repulsion forces (see `BHUT all_pairs_repulsion`) instead of a Barnes Hut tree until it has
+    // this number of vertices; it's where the exact forces stop being computed faster.
+    static constexpr size_t m_exactRepulsionLimit = 512;
+    // A graph with Barnes Hut repulsion gets exact forces again when it has fewer vertices than this (see the
+    // `chooseRepulsion` method).
+    static constexpr size_t m_barnesHutRepulsionLimit = 448;
+    // Default interval between two steps of the simulation thread, in microseconds (`ParamTimeout` of the C# code).
+    static constexpr std::chrono::microseconds::rep m_simulationInterval = 10000;
+    // The `MultilevelLayout` coarsens a graph down to this number of vertices (see `graph_hierarchy`).
+    static constexpr size_t m_coarsestLevelSize = 64;
+    // Signature ('ARBL') and version of a layout file (see the `saveLayout` method).
+    static constexpr uint32_t m_layoutSignature = 0x4c425241;
+    static constexpr uint16_t m_layoutVersion = 1;
 #endif
 
     /*
@@ -316,6 +645,10 @@ private:
      * animate initial movement of graph vertices from outside of the HWND inward the HWND client area. That's why the
      * `m_viewBound` grows, that's why the `m_viewBound` and the target render area are inversely proportional.
      *
+     * The `m_viewBound` is moved only by the `update` method. A renderer that reads layout snapshots (see the
+     * `acquireSnapshot` method) keeps its own view area and moves it toward the snapshot's graph area by the
+     * `getNextViewBound` method.
+     *
      * You can avoid using it and implement that movement by itself (with WAM, for example). But this class will do
      * another animation anyway (a one for Barnes Hut algorithm). Therefore you will end up with two or even more
      * animation sequences.
@@ -326,12 +659,72 @@ private:
      */
     __m128 m_graphBound;
     __m128 m_viewBound;
+    // Centroid of the vertices after the last step, formatted as [x, y, 0, 0]; new vertices without edges are placed
+    // there (see the `addVertex` method).
+    __m128 m_centroid;
     vertices_cont_t m_vertices;
     edges_cont_t m_edges;
-    std::uniform_real_distribution<float> m_distribution;
+    // Physical parameters of the vertices, indexed by `vertex::getId`. The physics passes iterate over this storage,
+    // not over the `m_vertices`.
+    physics_state m_physics;
+    // Physical parameters of the edges, sorted by tail vertices (so their order differs from the `m_edges` one). The
+    // springs pass iterates over this storage, not over the `m_edges`.
+    spring_set m_springs;
+    // Layouts published after each step, read by the renderer without the `m_verticesLock` and `m_edgesLock` locks
+    // (see the `acquireSnapshot` method).
+    snapshot_buffer m_snapshots;
+    // Storages for Barnes Hut trees (see `m_repulsionEngine` member); they're reused by each step of the simulation.
+    BHUT node_arena m_treeArena;
+    BHUT flat_barnes_hut_tree m_flatTree;
+    // Storage for exact repulsion (see `m_exactRepulsion` member).
+    BHUT all_pairs_repulsion m_allPairs;
+    // Stacks used to walk Barnes Hut trees, one per thread of the `m_threadPool`.
+    tree_stacks_cont_t m_treeStacks;
+    flat_tree_stacks_cont_t m_flatTreeStacks;
+    MISCUTIL thread_pool m_threadPool;
     WAPI srw_lock m_verticesLock;
     WAPI srw_lock m_edgesLock;
+    // Flags of the vertices that have an edge, indexed by `vertex::getId`; guarded by the `m_verticesLock` mutex (see
+    // the `connect` method).
+    bytes_cont_t m_connected;
+    // Parameters of the simulation, guarded by the `m_verticesLock` mutex (see the `setParameters` method).
+    simulation_parameters m_parameters;
+    // Engine of the Barnes Hut repulsion, guarded by the `m_verticesLock` mutex (see the `setRepulsionEngine` method).
+    repulsion_engine m_repulsionEngine;
+    // Does a step compute exact repulsion forces rather than Barnes Hut ones? See the `chooseRepulsion` method.
+    bool m_exactRepulsion;
     float m_meanOfEnergy;
+    // Time slice of the last step and the greatest squared velocity of a vertex after that step; they're used by the
+    // `VerletIntegrator` only (see the `chooseTimeSlice` method).
+    float m_timeSlice;
+    float m_maxVelocity;
+    // The greatest time slice the springs are stable with; it's updated by the `acceptChanges` method.
+    float m_stableTimeSlice;
+    // Number of the last steps in a row whose mean energy was below the `energyThreshold` parameter (it stops growing
+    // at the `stopSteps` parameter). It's guarded by the `m_verticesLock` mutex.
+    uint32_t m_restSteps;
+    repulsion_statistics m_repulsionStatistics;
+    // Number of the current physics step; it's used to seed random engines (see the `getStepSeed` method).
+    uint32_t m_step;
+    // Random engine that places new vertices; it's seeded by the `seed` parameter.
+    random_engine m_random;
+    // Number of the `clear` method calls.
+    uint32_t m_generation;
+    // The simulation thread and its state (see the `startSimulation` method). The `m_startCallback`, `m_stopCallback`,
+    // `m_stopSimulation` and `m_changed` members are guarded by the `m_simulationLock` mutex.
+    std::thread m_simulationThread;
+    std::mutex m_simulationLock;
+    std::condition_variable m_simulationWakeUp;
+    std::function<void ()> m_stepCallback;
+    std::function<void ()> m_startCallback;
+    std::function<void ()> m_stopCallback;
+    // Interval between two steps of the simulation thread, in microseconds.
+    std::atomic<std::chrono::microseconds::rep> m_interval;
+    // Duration of the last step made by the simulation thread, in microseconds.
+    std::atomic<std::chrono::microseconds::rep> m_stepDuration;
+    bool m_stopSimulation;
+    // Has the graph (or its parameters) been changed since the last step? See the `notifyChange` method.
+    bool m_changed;
 };
 
 ARBOR_END
@@ -0,0 +1,340 @@
+﻿#include "graph/hierarchy.h"
+#include "graph/vector.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+ARBOR_BEGIN
+
+/**
+ * Builds levels of the hierarchy for a graph.
+ *
+ * Parameters:
+ * >state
+ * Vertices of the graph.
+ * >springs
+ * Springs of the graph.
+ * >coarsestSize
+ * Coarsening stops at a level with this number of vertices or fewer.
+ * >random
+ * Random engine of the matching order (see the `coarsen` method).
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Levels built before are dropped. Building takes O(V + E log E) time per level, and each level is at most
+ * `m_maxReduction` of the finer one, so the whole hierarchy takes about as long as a few simulation steps.
+ */
+void graph_hierarchy::build(
+    _In_ const physics_state& state,
+    _In_ const spring_set& springs,
+    _In_ const size_t coarsestSize,
+    _Inout_ random_engine* random)
+{
+    m_levels.clear();
+    const physics_state* finerState = &state;
+    const spring_set* finerSprings = &springs;
+    while (coarsestSize < finerState->size())
+    {
+        std::unique_ptr<level> next = coarsen(*finerState, *finerSprings, random);
+        if (static_cast<float> (finerState->size()) * m_maxReduction < static_cast<float> (next->physics.size()))
+        {
+            break;
+        }
+        m_levels.push_back(std::move(next));
+        finerState = &m_levels.back()->physics;
+        finerSprings = &m_levels.back()->springs;
+    }
+}
+
+
+/**
+ * Places vertices of the finer level at their clusters.
+ *
+ * Parameters:
+ * >level
+ * Index of the level whose clusters are used.
+ * >springs
+ * Springs of the finer level.
+ * >finer
+ * Vertices of the finer level: the previous level, or the graph itself for the first one.
+ * >jitter
+ * A vertex that shares its cluster with others is moved off the cluster by this distance, so the vertices don't
+ * coincide.
+ * >random
+ * Random engine of the offsets.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Velocities of the finer vertices are zeroed, and the vertices are woken up. Fixed vertices aren't moved.
+ *
+ * The coarse layout is scaled about its center by the square root of the ratio of the finer and coarse numbers of
+ * vertices: area of a layout grows with number of its vertices, and a level started at the scale of the coarser one
+ * spends most of its steps on slow expansion, and may come to rest before it has expanded. A layout with fixed
+ * vertices isn't scaled, since they keep their places.
+ *
+ * A vertex is moved off its cluster toward the clusters of its neighbours, with a random deviation: vertices of a
+ * cluster placed at random would be twisted against their neighbours, and a twisted grid, for example, is a local
+ * minimum of the layout energy, which the finer level can't get out of.
+ */
+void graph_hierarchy::prolong(
+    _In_ const size_t level,
+    _In_ const spring_set& springs,
+    _Inout_ physics_state* finer,
+    _In_ const float jitter,
+    _Inout_ random_engine* random) const
+{
+    const graph_hierarchy::level& coarse = *m_levels[level];
+    __m128 center = _mm_div_ps(
+        coarse.physics.getCoordinatesSum(), _mm_set1_ps(static_cast<float> (coarse.physics.size())));
+    float ratio = static_cast<float> (finer->size()) / static_cast<float> (coarse.physics.size());
+    for (size_t i = 0; coarse.physics.size() > i; ++i)
+    {
+        if (coarse.physics.getFixed(i))
+        {
+            ratio = 1.0f;
+            break;
+        }
+    }
+    __m128 scale = _mm_set1_ps(std::sqrt(ratio));
+    ids_cont_t sizes(coarse.physics.size(), 0);
+    for (uint32_t parent : coarse.parents)
+    {
+        ++sizes[parent];
+    }
+    // Sum of directions from the cluster of each finer vertex to the clusters of its neighbours, as [x, y] pairs.
+    std::vector<float, STLADD default_allocator<float>> directions(finer->size() * 2, 0.0f);
+    const uint32_t* tails = springs.getTails();
+    const uint32_t* heads = springs.getHeads();
+    for (size_t i = 0; springs.size() > i; ++i)
+    {
+        uint32_t tail = coarse.parents[tails[i]];
+        uint32_t head = coarse.parents[heads[i]];
+        if (tail != head)
+        {
+            sse_t value;
+            _mm_store_ps(
+                value.data, _mm_sub_ps(coarse.physics.getCoordinates(head), coarse.physics.getCoordinates(tail)));
+            directions[tails[i] * 2] += value.data[0];
+            directions[tails[i] * 2 + 1] += value.data[1];
+            directions[heads[i] * 2] -= value.data[0];
+            directions[heads[i] * 2 + 1] -= value.data[1];
+        }
+    }
+    for (size_t i = 0; finer->size() > i; ++i)
+    {
+        if (!finer->getFixed(i))
+        {
+            uint32_t parent = coarse.parents[i];
+            __m128 coordinates =
+                _mm_add_ps(center, _mm_mul_ps(_mm_sub_ps(coarse.physics.getCoordinates(parent), center), scale));
+            if (1 < sizes[parent])
+            {
+                sse_t value;
+                _mm_store_ps(value.data, random->next());
+                float x = value.data[0] - 0.5f;
+                float y = value.data[1] - 0.5f;
+                float distance = std::sqrt(directions[i * 2] * directions[i * 2] + directions[i * 2 + 1] *
+                    directions[i * 2 + 1]);
+                if (0.0f < distance)
+                {
+                    x += directions[i * 2] / distance;
+                    y += directions[i * 2 + 1] / distance;
+                }
+                float size = std::sqrt(x * x + y * y);
+                if (0.0f < size)
+                {
+                    coordinates = _mm_add_ps(coordinates, _mm_setr_ps(x * jitter / size, y * jitter / size, 0.0f, 0.0f));
+                }
+            }
+            finer->setCoordinates(i, coordinates);
+            finer->setVelocity(i, getZeroVector());
+            finer->wake(i);
+        }
+    }
+}
+
+
+/**
+ * Makes the next level of the hierarchy.
+ *
+ * Parameters:
+ * >state
+ * Vertices of the finer level.
+ * >springs
+ * Springs of the finer level.
+ * >random
+ * Random engine of the matching order.
+ *
+ * Returns:
+ * The new level.
+ *
+ * Remarks:
+ * Vertices of the same degree are matched in random order. In the order of identifiers, vertices of a grid added row
+ * by row would be matched along the rows only, and the level would be a grid twice as narrow; a few such levels lay
+ * out as a strip, which the finer levels fold instead of spreading it.
+ */
+std::unique_ptr<graph_hierarchy::level> graph_hierarchy::coarsen(
+    _In_ const physics_state& state, _In_ const spring_set& springs, _Inout_ random_engine* random)
+{
+    const uint32_t none = UINT32_MAX;
+    const size_t count = state.size();
+    const size_t springsNumber = springs.size();
+    const uint32_t* tails = springs.getTails();
+    const uint32_t* heads = springs.getHeads();
+
+    // Neighbours of the i-th vertex are `neighbors` elements from `offsets[i]` to `offsets[i + 1]`.
+    ids_cont_t offsets(count + 1, 0);
+    for (size_t i = 0; springsNumber > i; ++i)
+    {
+        if (tails[i] != heads[i])
+        {
+            ++offsets[tails[i] + 1];
+            ++offsets[heads[i] + 1];
+        }
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    ids_cont_t neighbors(offsets[count]);
+    {
+        ids_cont_t next {offsets.begin(), offsets.end() - 1};
+        for (size_t i = 0; springsNumber > i; ++i)
+        {
+            if (tails[i] != heads[i])
+            {
+                neighbors[next[tails[i]]++] = heads[i];
+                neighbors[next[heads[i]]++] = tails[i];
+            }
+        }
+    }
+
+    std::unique_ptr<level> result = std::make_unique<level>();
+    ids_cont_t& parents = result->parents;
+    parents.assign(count, none);
+    ids_cont_t order(count);
+    std::iota(order.begin(), order.end(), 0);
+    for (size_t i = count; 1 < i; --i)
+    {
+        size_t j = static_cast<size_t> (_mm_cvtss_f32(random->next()) * static_cast<float> (i));
+        std::swap(order[i - 1], order[(i > j) ? j : i - 1]);
+    }
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&offsets] (_In_ const uint32_t left, _In_ const uint32_t right) -> bool
+        {
+            return offsets[left + 1] - offsets[left] < offsets[right + 1] - offsets[right];
+        });
+    const float* masses = state.getMasses();
+    uint32_t clusters = 0;
+    for (uint32_t v : order)
+    {
+        if (none == parents[v])
+        {
+            uint32_t match = none;
+            for (uint32_t j = offsets[v]; offsets[v + 1] > j; ++j)
+            {
+                uint32_t u = neighbors[j];
+                if ((none == parents[u]) && (u != v) && ((none == match) || (masses[u] < masses[match])))
+                {
+                    match = u;
+                }
+            }
+            if (none != match)
+            {
+                parents[v] = clusters;
+                parents[match] = clusters;
+                ++clusters;
+            }
+        }
+    }
+    for (uint32_t v = 0; count > v; ++v)
+    {
+        if (none == parents[v])
+        {
+            if ((1 == offsets[v + 1] - offsets[v]) && (none != parents[neighbors[offsets[v]]]))
+            {
+                parents[v] = parents[neighbors[offsets[v]]];
+            }
+            else
+            {
+                parents[v] = clusters++;
+            }
+        }
+    }
+
+    // A cluster is placed at the center of its vertices, or of its fixed vertices if it has any.
+    std::vector<float, STLADD default_allocator<float>> sums(clusters * 4, 0.0f);
+    ids_cont_t members(clusters * 2, 0);
+    for (uint32_t v = 0; count > v; ++v)
+    {
+        uint32_t c = parents[v];
+        sse_t coordinates;
+        _mm_store_ps(coordinates.data, state.getCoordinates(v));
+        bool fixed = state.getFixed(v);
+        sums[c * 4 + (fixed ? 2 : 0)] += coordinates.data[0];
+        sums[c * 4 + (fixed ? 3 : 1)] += coordinates.data[1];
+        ++members[c * 2 + (fixed ? 1 : 0)];
+    }
+    for (uint32_t c = 0; clusters > c; ++c)
+    {
+        bool fixed = (0 != members[c * 2 + 1]);
+        float number = static_cast<float> (members[c * 2 + (fixed ? 1 : 0)]);
+        size_t index = c * 4 + (fixed ? 2 : 0);
+        result->physics.add(_mm_setr_ps(sums[index] / number, sums[index + 1] / number, 0.0f, 0.0f));
+        result->physics.setFixed(c, fixed);
+    }
+    std::vector<float, STLADD default_allocator<float>> clusterMasses(clusters, 0.0f);
+    for (uint32_t v = 0; count > v; ++v)
+    {
+        clusterMasses[parents[v]] += masses[v];
+    }
+    for (uint32_t c = 0; clusters > c; ++c)
+    {
+        result->physics.setMass(c, clusterMasses[c]);
+    }
+
+    // Springs between the same pair of clusters are adjacent after sorting by the pair.
+    std::vector<cluster_spring, STLADD default_allocator<cluster_spring>> pairs {};
+    pairs.reserve(springsNumber);
+    const float* lengths = springs.getLengths();
+    const float* stiffnesses = springs.getStiffnesses();
+    for (size_t i = 0; springsNumber > i; ++i)
+    {
+        uint64_t tail = parents[tails[i]];
+        uint64_t head = parents[heads[i]];
+        if (tail != head)
+        {
+            pairs.push_back({(std::min(tail, head) << 32) | std::max(tail, head), lengths[i], stiffnesses[i]});
+        }
+    }
+    std::sort(
+        pairs.begin(),
+        pairs.end(),
+        [] (_In_ const cluster_spring& left, _In_ const cluster_spring& right) -> bool
+        {
+            return left.key < right.key;
+        });
+    for (size_t i = 0; pairs.size() > i;)
+    {
+        float length = 0.0f;
+        float stiffness = 0.0f;
+        size_t j = i;
+        for (; (pairs.size() > j) && (pairs[i].key == pairs[j].key); ++j)
+        {
+            length += pairs[j].length;
+            stiffness += pairs[j].stiffness;
+        }
+        result->springs.add(
+            static_cast<size_t> (pairs[i].key >> 32),
+            static_cast<size_t> (pairs[i].key & UINT32_MAX),
+            length / static_cast<float> (j - i),
+            stiffness);
+        i = j;
+    }
+    return result;
+}
+
+ARBOR_END
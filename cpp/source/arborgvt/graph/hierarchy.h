@@ -0,0 +1,103 @@
+﻿#pragma once
+#include "graph/physics.h"
+#include "graph/random.h"
+#include "graph/springs.h"
+#include "ns/arbor.h"
+#include "service/stladdon.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+ARBOR_BEGIN
+
+/**
+ * `graph_hierarchy` class keeps coarse versions of a graph (levels), used by the multilevel layout (see
+ * `graph::layout`).
+ *
+ * Remarks:
+ * The first level is made of the graph's vertices and springs, each next one of the previous level's; level number
+ * `size() - 1` is the coarsest one. A vertex of a level (a cluster) stands for one or more vertices of the finer level:
+ * - pairs of neighbours are matched, each vertex with its lightest unmatched neighbour; vertices are visited from the
+ *   least connected ones (in random order among vertices of the same degree), so leaves are matched with their
+ *   parents first;
+ * - a leaf left unmatched (its parent has been matched to another leaf) is collapsed into its parent's cluster, so a
+ *   star collapses in one level;
+ * - the rest of the vertices are clusters of their own.
+ * So a level has half as many vertices as the finer one, or fewer. A cluster is placed at the center of its vertices,
+ * its mass is the sum of their masses, so its repulsion is their repulsion as seen from afar, and it's fixed if any of
+ * them is. Springs between two clusters are merged into one, with the mean length and the sum of stiffnesses;
+ * springs inside a cluster are dropped.
+ *
+ * Coarsening stops at a level of `coarsestSize` vertices or fewer, or when a level would keep more than
+ * `m_maxReduction` of the finer level's vertices (a graph of isolated vertices, for example, can't be coarsened).
+ */
+class graph_hierarchy
+{
+public:
+    typedef std::vector<uint32_t, STLADD default_allocator<uint32_t>> ids_cont_t;
+
+    graph_hierarchy()
+        :
+        m_levels {}
+    {
+    }
+
+    graph_hierarchy(_In_ const graph_hierarchy&) = delete;
+    graph_hierarchy& operator =(_In_ const graph_hierarchy&) = delete;
+
+    size_t size() const noexcept
+    {
+        return m_levels.size();
+    }
+
+    physics_state* getPhysics(_In_ const size_t level) noexcept
+    {
+        return &m_levels[level]->physics;
+    }
+
+    spring_set* getSprings(_In_ const size_t level) noexcept
+    {
+        return &m_levels[level]->springs;
+    }
+
+    void build(
+        _In_ const physics_state& state,
+        _In_ const spring_set& springs,
+        _In_ const size_t coarsestSize,
+        _Inout_ random_engine* random);
+    void __fastcall prolong(
+        _In_ const size_t level,
+        _In_ const spring_set& springs,
+        _Inout_ physics_state* finer,
+        _In_ const float jitter,
+        _Inout_ random_engine* random) const;
+
+
+private:
+    // A level keeps at most this part of the finer level's vertices.
+    static constexpr float m_maxReduction = 0.75f;
+
+    struct level
+    {
+        physics_state physics;
+        spring_set springs;
+        // Identifier of the cluster of each vertex of the finer level.
+        ids_cont_t parents;
+    };
+
+    // A spring between two clusters; `key` is the smaller cluster identifier in the upper half and the greater one in
+    // the lower half.
+    struct cluster_spring
+    {
+        uint64_t key;
+        float length;
+        float stiffness;
+    };
+
+    static std::unique_ptr<level> coarsen(
+        _In_ const physics_state& state, _In_ const spring_set& springs, _Inout_ random_engine* random);
+
+    std::vector<std::unique_ptr<level>, STLADD default_allocator<std::unique_ptr<level>>> m_levels;
+};
+
+ARBOR_END
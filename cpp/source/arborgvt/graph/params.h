@@ -0,0 +1,80 @@
+﻿#pragma once
+#include "ns/arbor.h"
+#include <cstdint>
+
+ARBOR_BEGIN
+
+typedef enum
+{
+    // The scheme of the original C# code: velocity of each vertex is zeroed before each step, so a vertex moves by its
+    // force times the squared time slice (reduced by the friction), and the time slice is constant.
+    EulerIntegrator,
+    // Leapfrog (velocity Verlet) scheme: velocities are kept between steps, and the time slice of each step is chosen
+    // by the fastest vertex and the stiffest springs, from `timeSlice` to `maxTimeSlice`.
+    VerletIntegrator
+}
+integration_method;
+
+/**
+ * `simulation_parameters` structure keeps parameters of a graph simulation that can be changed while the simulation
+ * runs (see the `graph::setParameters` method). A new value takes effect on the next step.
+ */
+struct simulation_parameters
+{
+    // Stiffness of an edge added without its own stiffness. Changing it doesn't change the edges already added.
+    float stiffness;
+    // Repulsion between each pair of vertices.
+    float repulsion;
+    // Part of the velocity a vertex loses on each step (on each `timeSlice` of time for the `VerletIntegrator`), from 0
+    // to 1.
+    float friction;
+    /*
+     * Time slice of a step. It's the least time slice of the `VerletIntegrator`: the time slice grows while no vertex
+     * moves by more than `maxDisplacement` per step and the springs stay stable, up to `maxTimeSlice`.
+     */
+    float timeSlice;
+    float maxTimeSlice;
+    float maxDisplacement;
+    integration_method integrator;
+    /*
+     * Barnes Hut theta is chosen by each step of the simulation: it's `maxTheta` (a coarse approximation) while mean
+     * energy of the vertices is high, and it goes down to `minTheta` while the energy falls to `energyThreshold`. Equal
+     * values fix the theta.
+     */
+    float minTheta;
+    float maxTheta;
+    /*
+     * Maximum number of vertices in a leaf of the Barnes Hut tree, from 1 to 64. A larger leaf makes the tree shallower
+     * but computes more forces exactly; forces of a leaf are computed by whole SIMD vectors, so multiples of eight
+     * suit best. The `PointerBarnesHutTree` engine ignores it, its leaves hold one vertex each.
+     */
+    uint32_t leafCapacity;
+    // Mean energy of the vertices below which the graph cools down (see `autoStop`).
+    float energyThreshold;
+    // Number of steps in a row with mean energy below the `energyThreshold`, after which the graph is at rest.
+    uint32_t stopSteps;
+    /*
+     * A vertex is calm on a step if its velocity is less than `sleepVelocity` and the net force applied to it (divided
+     * by its mass) is less than `sleepForce`; after `sleepSteps` calm steps in a row (from 1 to 255) it falls asleep if
+     * `sleep` is set: its forces aren't computed and it isn't moved until a vertex connected to it or a vertex in its
+     * cell of the Barnes Hut tree moves. A change of the graph or of the parameters wakes up the vertices it affects.
+     */
+    float sleepVelocity;
+    float sleepForce;
+    uint32_t sleepSteps;
+    /*
+     * Seed of the random numbers of the graph: coordinates of new vertices added without them and directions of forces
+     * between vertices at the same point. Two graphs with the same seed and parameters, which get the same calls, lay
+     * out the same way bit for bit on the same CPU. Changing the seed restarts the sequence of coordinates of new
+     * vertices, and so does the `graph::clear` method.
+     */
+    uint32_t seed;
+    // Does a force proportional to the coordinates of a vertex pull it to the origin?
+    bool gravity;
+    // Does the simulation stop making steps while the graph is at rest? Any change of the graph (or of its parameters)
+    // wakes the simulation up.
+    bool autoStop;
+    bool sleep;
+};
+
+ARBOR_END
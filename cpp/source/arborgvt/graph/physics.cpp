@@ -0,0 +1,594 @@
+﻿#include "graph/physics.h"
+
+ARBOR_BEGIN
+
+/**
+ * Sums up coordinates of all vertices.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * Sum of the coordinates, formatted as [x, y, 0, 0].
+ *
+ * Remarks:
+ * Four vertices are summed at once; the padding elements are zero.
+ */
+__m128 physics_state::getCoordinatesSum() const noexcept
+{
+    __m128 x = _mm_setzero_ps();
+    __m128 y = x;
+    for (size_t i = 0; m_x.size() > i; i += 4)
+    {
+        x = _mm_add_ps(x, _mm_load_ps(&m_x[i]));
+        y = _mm_add_ps(y, _mm_load_ps(&m_y[i]));
+    }
+    x = _mm_hadd_ps(x, y);
+    x = _mm_hadd_ps(x, x);
+    return _mm_movelh_ps(x, _mm_setzero_ps());
+}
+
+
+/**
+ * Sums up forces applied to all vertices.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * Sum of the forces, formatted as [x, y, 0, 0].
+ *
+ * Remarks:
+ * The forces are already multiplied by the inverse masses (see the `applyForce` method). Four vertices are summed at
+ * once; the padding elements are zero.
+ */
+__m128 physics_state::getForcesSum() const noexcept
+{
+    __m128 x = _mm_setzero_ps();
+    __m128 y = x;
+    for (size_t i = 0; m_forceX.size() > i; i += 4)
+    {
+        x = _mm_add_ps(x, _mm_load_ps(&m_forceX[i]));
+        y = _mm_add_ps(y, _mm_load_ps(&m_forceY[i]));
+    }
+    x = _mm_hadd_ps(x, y);
+    x = _mm_hadd_ps(x, x);
+    return _mm_movelh_ps(x, _mm_setzero_ps());
+}
+
+
+/**
+ * Updates velocity and position of each vertex. A force applied to each vertex is zeroed.
+ *
+ * Parameters:
+ * >drift
+ * Force applied to each vertex in addition to its own force, formatted as [x, y, 0, 0].
+ * >gravity
+ * Factor of the force that pulls each vertex to the origin: coordinates of the vertex multiplied by the `gravity` are
+ * applied to the vertex. Zero value turns the gravity off.
+ * >friction
+ * Friction setting.
+ * >time
+ * Time slice of the step.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * The `drift` and the gravity are applied as the `applyForce` method does it (they're multiplied by the inverse mass).
+ * Velocity of a fixed or sleeping vertex is set to zero, so it isn't moved. Velocity of other vertices is the sum of
+ * the current velocity and the force multiplied by the `time`, reduced by the `friction`. If squared length of the
+ * velocity is greater than 1'000'000, the velocity is divided by the squared length (that's how the original C# code
+ * limits the velocity).
+ *
+ * The work is done by the `integrateAvx2` or the `integrateSse` method, chosen by the CPU once, when this object is
+ * created. Each of them is compiled twice, with and without the gravity, so the loop doesn't compute the gravity when
+ * it's turned off.
+ */
+float physics_state::integrate(
+    _In_ const __m128 drift, _In_ const float gravity, _In_ const float friction, _In_ const float time) noexcept
+{
+    if (0.0f != gravity)
+    {
+        return m_avx2 ?
+            integrateAvx2<true>(drift, gravity, friction, time) :
+            integrateSse<true>(drift, gravity, friction, time);
+    }
+    else
+    {
+        return m_avx2 ?
+            integrateAvx2<false>(drift, gravity, friction, time) :
+            integrateSse<false>(drift, gravity, friction, time);
+    }
+}
+
+
+/**
+ * Updates velocity and position of each vertex, using AVX2 instructions.
+ *
+ * Parameters:
+ * >drift
+ * Force applied to each vertex in addition to its own force, formatted as [x, y, 0, 0].
+ * >gravity
+ * Factor of the force that pulls each vertex to the origin; it's used only if `G` is `true`.
+ * >friction
+ * Friction setting.
+ * >time
+ * Time slice of the step.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * See the `integrate` method. Eight vertices are processed at once. Padding elements belong to fixed vertices of zero
+ * coordinates, so they remain zero and don't change the result.
+ */
+template <bool G>
+float physics_state::integrateAvx2(
+    _In_ const __m128 drift, _In_ const float gravity, _In_ const float friction, _In_ const float time) noexcept
+{
+    const float one = 1.0f;
+    const float maxVelocity = 1000000.0f;
+    const float frictionComp = 1.0f - friction;
+    const __m256 ones = _mm256_broadcast_ss(&one);
+    const __m256 velocityLimit = _mm256_broadcast_ss(&maxVelocity);
+    const __m256 frictionVector = _mm256_broadcast_ss(&frictionComp);
+    const __m256 timeVector = _mm256_broadcast_ss(&time);
+    const __m256 gravityVector = _mm256_broadcast_ss(&gravity);
+    const __m256 driftX = _mm256_broadcastss_ps(drift);
+    const __m256 driftY = _mm256_broadcastss_ps(_mm_shuffle_ps(drift, drift, 0b01010101));
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 energy = zero;
+    for (size_t i = 0; m_x.size() > i; i += 8)
+    {
+        __m256 x = _mm256_load_ps(&m_x[i]);
+        __m256 y = _mm256_load_ps(&m_y[i]);
+        __m256 inverseMass = _mm256_load_ps(&m_inverseMasses[i]);
+        // > Apply center drift and center gravity.
+        __m256 forceX = addGravity(driftX, x, gravityVector, gravity_type<G> {});
+        __m256 forceY = addGravity(driftY, y, gravityVector, gravity_type<G> {});
+        forceX = _mm256_add_ps(_mm256_load_ps(&m_forceX[i]), _mm256_mul_ps(forceX, inverseMass));
+        forceY = _mm256_add_ps(_mm256_load_ps(&m_forceY[i]), _mm256_mul_ps(forceY, inverseMass));
+        // > Update velocity.
+        __m256 velocityX = _mm256_add_ps(_mm256_load_ps(&m_velocityX[i]), _mm256_mul_ps(forceX, timeVector));
+        __m256 velocityY = _mm256_add_ps(_mm256_load_ps(&m_velocityY[i]), _mm256_mul_ps(forceY, timeVector));
+        velocityX = _mm256_mul_ps(velocityX, frictionVector);
+        velocityY = _mm256_mul_ps(velocityY, frictionVector);
+        __m256 length = _mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY));
+        __m256 scale =
+            _mm256_blendv_ps(ones, _mm256_rcp_ps(length), _mm256_cmp_ps(length, velocityLimit, _CMP_GT_OQ));
+        __m128i flags = _mm_or_si128(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*> (&m_fixed[i])),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*> (&m_sleeping[i])));
+        __m256i fixed = _mm256_cvtepu8_epi32(flags);
+        __m256 movable = _mm256_castsi256_ps(_mm256_cmpeq_epi32(fixed, _mm256_setzero_si256()));
+        velocityX = _mm256_and_ps(_mm256_mul_ps(velocityX, scale), movable);
+        velocityY = _mm256_and_ps(_mm256_mul_ps(velocityY, scale), movable);
+        _mm256_store_ps(&m_velocityX[i], velocityX);
+        _mm256_store_ps(&m_velocityY[i], velocityY);
+        _mm256_store_ps(&m_forceX[i], zero);
+        _mm256_store_ps(&m_forceY[i], zero);
+        _mm256_store_ps(
+            &m_netForces[i],
+            _mm256_and_ps(
+                _mm256_add_ps(_mm256_mul_ps(forceX, forceX), _mm256_mul_ps(forceY, forceY)), movable));
+        // > Update positions.
+        _mm256_store_ps(&m_x[i], _mm256_add_ps(x, _mm256_mul_ps(velocityX, timeVector)));
+        _mm256_store_ps(&m_y[i], _mm256_add_ps(y, _mm256_mul_ps(velocityY, timeVector)));
+        // > Update energy.
+        energy = _mm256_add_ps(energy, _mm256_mul_ps(velocityX, velocityX));
+        energy = _mm256_add_ps(energy, _mm256_mul_ps(velocityY, velocityY));
+    }
+    __m128 temp = _mm_add_ps(_mm256_castps256_ps128(energy), _mm256_extractf128_ps(energy, 1));
+    _mm256_zeroupper();
+    temp = _mm_hadd_ps(temp, temp);
+    temp = _mm_hadd_ps(temp, temp);
+    return _mm_cvtss_f32(temp);
+}
+
+
+/**
+ * Updates velocity and position of each vertex, using SSE instructions.
+ *
+ * Parameters:
+ * >drift
+ * Force applied to each vertex in addition to its own force, formatted as [x, y, 0, 0].
+ * >gravity
+ * Factor of the force that pulls each vertex to the origin; it's used only if `G` is `true`.
+ * >friction
+ * Friction setting.
+ * >time
+ * Time slice of the step.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * This is the `integrateAvx2` method for CPUs without AVX2 support, four vertices at once.
+ */
+template <bool G>
+float physics_state::integrateSse(
+    _In_ const __m128 drift, _In_ const float gravity, _In_ const float friction, _In_ const float time) noexcept
+{
+    const float one = 1.0f;
+    const float maxVelocity = 1000000.0f;
+    const float frictionComp = 1.0f - friction;
+    const __m128 ones = _mm_load_ps1(&one);
+    const __m128 velocityLimit = _mm_load_ps1(&maxVelocity);
+    const __m128 frictionVector = _mm_load_ps1(&frictionComp);
+    const __m128 timeVector = _mm_load_ps1(&time);
+    const __m128 gravityVector = _mm_load_ps1(&gravity);
+    const __m128 driftX = _mm_shuffle_ps(drift, drift, 0);
+    const __m128 driftY = _mm_shuffle_ps(drift, drift, 0b01010101);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i zeroInteger = _mm_setzero_si128();
+    __m128 energy = zero;
+    for (size_t i = 0; m_x.size() > i; i += 4)
+    {
+        __m128 x = _mm_load_ps(&m_x[i]);
+        __m128 y = _mm_load_ps(&m_y[i]);
+        __m128 inverseMass = _mm_load_ps(&m_inverseMasses[i]);
+        __m128 forceX = addGravity(driftX, x, gravityVector, gravity_type<G> {});
+        __m128 forceY = addGravity(driftY, y, gravityVector, gravity_type<G> {});
+        forceX = _mm_add_ps(_mm_load_ps(&m_forceX[i]), _mm_mul_ps(forceX, inverseMass));
+        forceY = _mm_add_ps(_mm_load_ps(&m_forceY[i]), _mm_mul_ps(forceY, inverseMass));
+        __m128 velocityX = _mm_add_ps(_mm_load_ps(&m_velocityX[i]), _mm_mul_ps(forceX, timeVector));
+        __m128 velocityY = _mm_add_ps(_mm_load_ps(&m_velocityY[i]), _mm_mul_ps(forceY, timeVector));
+        velocityX = _mm_mul_ps(velocityX, frictionVector);
+        velocityY = _mm_mul_ps(velocityY, frictionVector);
+        __m128 length = _mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY));
+        __m128 limited = _mm_cmpgt_ps(length, velocityLimit);
+        __m128 scale = _mm_or_ps(_mm_and_ps(limited, _mm_rcp_ps(length)), _mm_andnot_ps(limited, ones));
+        // Four fixed and sleeping flags widened from bytes to 32-bit integers.
+        __m128i fixed = _mm_cvtsi32_si128(
+            *reinterpret_cast<const int*> (&m_fixed[i]) | *reinterpret_cast<const int*> (&m_sleeping[i]));
+        fixed = _mm_unpacklo_epi16(_mm_unpacklo_epi8(fixed, zeroInteger), zeroInteger);
+        __m128 movable = _mm_castsi128_ps(_mm_cmpeq_epi32(fixed, zeroInteger));
+        velocityX = _mm_and_ps(_mm_mul_ps(velocityX, scale), movable);
+        velocityY = _mm_and_ps(_mm_mul_ps(velocityY, scale), movable);
+        _mm_store_ps(&m_velocityX[i], velocityX);
+        _mm_store_ps(&m_velocityY[i], velocityY);
+        _mm_store_ps(&m_forceX[i], zero);
+        _mm_store_ps(&m_forceY[i], zero);
+        _mm_store_ps(
+            &m_netForces[i],
+            _mm_and_ps(_mm_add_ps(_mm_mul_ps(forceX, forceX), _mm_mul_ps(forceY, forceY)), movable));
+        _mm_store_ps(&m_x[i], _mm_add_ps(x, _mm_mul_ps(velocityX, timeVector)));
+        _mm_store_ps(&m_y[i], _mm_add_ps(y, _mm_mul_ps(velocityY, timeVector)));
+        energy = _mm_add_ps(energy, _mm_mul_ps(velocityX, velocityX));
+        energy = _mm_add_ps(energy, _mm_mul_ps(velocityY, velocityY));
+    }
+    energy = _mm_hadd_ps(energy, energy);
+    energy = _mm_hadd_ps(energy, energy);
+    return _mm_cvtss_f32(energy);
+}
+
+
+/**
+ * Updates velocity and position of each vertex by the leapfrog (velocity Verlet) scheme. A force applied to each vertex
+ * is zeroed.
+ *
+ * Parameters:
+ * >drift
+ * Force applied to each vertex in addition to its own force, formatted as [x, y, 0, 0].
+ * >gravity
+ * Factor of the force that pulls each vertex to the origin: coordinates of the vertex multiplied by the `gravity` are
+ * applied to the vertex. Zero value turns the gravity off.
+ * >damping
+ * Factor each velocity is multiplied by on this step.
+ * >kick
+ * Time the force accelerates each vertex for: the mean of the previous and this time slices.
+ * >time
+ * Time slice of the step.
+ * >forces
+ * Receives sum of squared forces applied to the vertices, other than fixed and sleeping ones (the forces include the
+ * drift and the gravity, and they're multiplied by the inverse masses).
+ * >maxVelocity
+ * Receives the greatest squared velocity of a vertex.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * Velocities are kept between steps and taken as velocities at the middle of the previous step, so the force computed
+ * at the current positions updates them by the half of the previous time slice and the half of this one (the closing
+ * 'kick' of the previous step and the opening 'kick' of this one are merged), and the vertex 'drifts' by the new
+ * velocity for the whole `time`. Unlike the `integrate` method, the scheme keeps its second order accuracy when the
+ * time slice changes from step to step, so the caller can choose the slice by the greatest velocity.
+ *
+ * Velocity of a fixed or sleeping vertex is set to zero. Length of a velocity is limited by 1'000.
+ *
+ * Velocities of this scheme keep going after the forces have been balanced, and the forces measure how far the
+ * vertices are from the balance, so both sums are returned. Velocities of the `integrate` method are the forces times
+ * the time slice, reduced by the friction, so the caller can compare the results of both schemes.
+ */
+float physics_state::integrateVerlet(
+    _In_ const __m128 drift,
+    _In_ const float gravity,
+    _In_ const float damping,
+    _In_ const float kick,
+    _In_ const float time,
+    _Out_ float* forces,
+    _Out_ float* maxVelocity) noexcept
+{
+    if (0.0f != gravity)
+    {
+        return m_avx2 ?
+            integrateVerletAvx2<true>(drift, gravity, damping, kick, time, forces, maxVelocity) :
+            integrateVerletSse<true>(drift, gravity, damping, kick, time, forces, maxVelocity);
+    }
+    else
+    {
+        return m_avx2 ?
+            integrateVerletAvx2<false>(drift, gravity, damping, kick, time, forces, maxVelocity) :
+            integrateVerletSse<false>(drift, gravity, damping, kick, time, forces, maxVelocity);
+    }
+}
+
+
+/**
+ * Updates velocity and position of each vertex by the leapfrog scheme, using AVX2 instructions.
+ *
+ * Parameters:
+ * >drift
+ * Force applied to each vertex in addition to its own force, formatted as [x, y, 0, 0].
+ * >gravity
+ * Factor of the force that pulls each vertex to the origin; it's used only if `G` is `true`.
+ * >damping
+ * Factor each velocity is multiplied by on this step.
+ * >kick
+ * Time the force accelerates each vertex for.
+ * >time
+ * Time slice of the step.
+ * >forces
+ * Receives sum of squared forces applied to the vertices, other than fixed and sleeping ones (the forces include the
+ * drift and the gravity, and they're multiplied by the inverse masses).
+ * >maxVelocity
+ * Receives the greatest squared velocity of a vertex.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * See the `integrateVerlet` method. Eight vertices are processed at once.
+ */
+template <bool G>
+float physics_state::integrateVerletAvx2(
+    _In_ const __m128 drift,
+    _In_ const float gravity,
+    _In_ const float damping,
+    _In_ const float kick,
+    _In_ const float time,
+    _Out_ float* forces,
+    _Out_ float* maxVelocity) noexcept
+{
+    const float one = 1.0f;
+    const float limit = 1000.0f;
+    const float squaredLimit = limit * limit;
+    const __m256 ones = _mm256_broadcast_ss(&one);
+    const __m256 velocityLimit = _mm256_broadcast_ss(&limit);
+    const __m256 squaredVelocityLimit = _mm256_broadcast_ss(&squaredLimit);
+    const __m256 dampingVector = _mm256_broadcast_ss(&damping);
+    const __m256 kickVector = _mm256_broadcast_ss(&kick);
+    const __m256 timeVector = _mm256_broadcast_ss(&time);
+    const __m256 gravityVector = _mm256_broadcast_ss(&gravity);
+    const __m256 driftX = _mm256_broadcastss_ps(drift);
+    const __m256 driftY = _mm256_broadcastss_ps(_mm_shuffle_ps(drift, drift, 0b01010101));
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 energy = zero;
+    __m256 forcesSum = zero;
+    __m256 maximum = zero;
+    for (size_t i = 0; m_x.size() > i; i += 8)
+    {
+        __m256 x = _mm256_load_ps(&m_x[i]);
+        __m256 y = _mm256_load_ps(&m_y[i]);
+        __m256 inverseMass = _mm256_load_ps(&m_inverseMasses[i]);
+        // > Apply center drift and center gravity.
+        __m256 forceX = addGravity(driftX, x, gravityVector, gravity_type<G> {});
+        __m256 forceY = addGravity(driftY, y, gravityVector, gravity_type<G> {});
+        forceX = _mm256_add_ps(_mm256_load_ps(&m_forceX[i]), _mm256_mul_ps(forceX, inverseMass));
+        forceY = _mm256_add_ps(_mm256_load_ps(&m_forceY[i]), _mm256_mul_ps(forceY, inverseMass));
+        // > Kick.
+        __m256 velocityX = _mm256_add_ps(_mm256_load_ps(&m_velocityX[i]), _mm256_mul_ps(forceX, kickVector));
+        __m256 velocityY = _mm256_add_ps(_mm256_load_ps(&m_velocityY[i]), _mm256_mul_ps(forceY, kickVector));
+        velocityX = _mm256_mul_ps(velocityX, dampingVector);
+        velocityY = _mm256_mul_ps(velocityY, dampingVector);
+        __m256 length = _mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY));
+        __m256 limited = _mm256_cmp_ps(length, squaredVelocityLimit, _CMP_GT_OQ);
+        __m256 scale = _mm256_blendv_ps(ones, _mm256_mul_ps(velocityLimit, _mm256_rsqrt_ps(length)), limited);
+        __m128i flags = _mm_or_si128(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*> (&m_fixed[i])),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*> (&m_sleeping[i])));
+        __m256i fixed = _mm256_cvtepu8_epi32(flags);
+        __m256 movable = _mm256_castsi256_ps(_mm256_cmpeq_epi32(fixed, _mm256_setzero_si256()));
+        velocityX = _mm256_and_ps(_mm256_mul_ps(velocityX, scale), movable);
+        velocityY = _mm256_and_ps(_mm256_mul_ps(velocityY, scale), movable);
+        _mm256_store_ps(&m_velocityX[i], velocityX);
+        _mm256_store_ps(&m_velocityY[i], velocityY);
+        _mm256_store_ps(&m_forceX[i], zero);
+        _mm256_store_ps(&m_forceY[i], zero);
+        // > Drift.
+        _mm256_store_ps(&m_x[i], _mm256_add_ps(x, _mm256_mul_ps(velocityX, timeVector)));
+        _mm256_store_ps(&m_y[i], _mm256_add_ps(y, _mm256_mul_ps(velocityY, timeVector)));
+        // > Update energy.
+        __m256 force = _mm256_and_ps(
+            _mm256_add_ps(_mm256_mul_ps(forceX, forceX), _mm256_mul_ps(forceY, forceY)), movable);
+        _mm256_store_ps(&m_netForces[i], force);
+        forcesSum = _mm256_add_ps(forcesSum, force);
+        length = _mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY));
+        energy = _mm256_add_ps(energy, length);
+        maximum = _mm256_max_ps(maximum, length);
+    }
+    __m128 temp = _mm_add_ps(_mm256_castps256_ps128(energy), _mm256_extractf128_ps(energy, 1));
+    __m128 forcesTemp = _mm_add_ps(_mm256_castps256_ps128(forcesSum), _mm256_extractf128_ps(forcesSum, 1));
+    __m128 greatest = _mm_max_ps(_mm256_castps256_ps128(maximum), _mm256_extractf128_ps(maximum, 1));
+    _mm256_zeroupper();
+    greatest = _mm_max_ps(greatest, _mm_movehl_ps(greatest, greatest));
+    greatest = _mm_max_ss(greatest, _mm_shuffle_ps(greatest, greatest, 0b01010101));
+    *maxVelocity = _mm_cvtss_f32(greatest);
+    temp = _mm_hadd_ps(temp, forcesTemp);
+    temp = _mm_hadd_ps(temp, temp);
+    *forces = _mm_cvtss_f32(_mm_shuffle_ps(temp, temp, 0b01010101));
+    return _mm_cvtss_f32(temp);
+}
+
+
+/**
+ * Updates velocity and position of each vertex by the leapfrog scheme, using SSE instructions.
+ *
+ * Parameters:
+ * >drift
+ * Force applied to each vertex in addition to its own force, formatted as [x, y, 0, 0].
+ * >gravity
+ * Factor of the force that pulls each vertex to the origin; it's used only if `G` is `true`.
+ * >damping
+ * Factor each velocity is multiplied by on this step.
+ * >kick
+ * Time the force accelerates each vertex for.
+ * >time
+ * Time slice of the step.
+ * >forces
+ * Receives sum of squared forces applied to the vertices, other than fixed and sleeping ones (the forces include the
+ * drift and the gravity, and they're multiplied by the inverse masses).
+ * >maxVelocity
+ * Receives the greatest squared velocity of a vertex.
+ *
+ * Returns:
+ * Sum of squared velocities of all vertices.
+ *
+ * Remarks:
+ * This is the `integrateVerletAvx2` method for CPUs without AVX2 support, four vertices at once.
+ */
+template <bool G>
+float physics_state::integrateVerletSse(
+    _In_ const __m128 drift,
+    _In_ const float gravity,
+    _In_ const float damping,
+    _In_ const float kick,
+    _In_ const float time,
+    _Out_ float* forces,
+    _Out_ float* maxVelocity) noexcept
+{
+    const float one = 1.0f;
+    const float limit = 1000.0f;
+    const float squaredLimit = limit * limit;
+    const __m128 ones = _mm_load_ps1(&one);
+    const __m128 velocityLimit = _mm_load_ps1(&limit);
+    const __m128 squaredVelocityLimit = _mm_load_ps1(&squaredLimit);
+    const __m128 dampingVector = _mm_load_ps1(&damping);
+    const __m128 kickVector = _mm_load_ps1(&kick);
+    const __m128 timeVector = _mm_load_ps1(&time);
+    const __m128 gravityVector = _mm_load_ps1(&gravity);
+    const __m128 driftX = _mm_shuffle_ps(drift, drift, 0);
+    const __m128 driftY = _mm_shuffle_ps(drift, drift, 0b01010101);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i zeroInteger = _mm_setzero_si128();
+    __m128 energy = zero;
+    __m128 forcesSum = zero;
+    __m128 maximum = zero;
+    for (size_t i = 0; m_x.size() > i; i += 4)
+    {
+        __m128 x = _mm_load_ps(&m_x[i]);
+        __m128 y = _mm_load_ps(&m_y[i]);
+        __m128 inverseMass = _mm_load_ps(&m_inverseMasses[i]);
+        __m128 forceX = addGravity(driftX, x, gravityVector, gravity_type<G> {});
+        __m128 forceY = addGravity(driftY, y, gravityVector, gravity_type<G> {});
+        forceX = _mm_add_ps(_mm_load_ps(&m_forceX[i]), _mm_mul_ps(forceX, inverseMass));
+        forceY = _mm_add_ps(_mm_load_ps(&m_forceY[i]), _mm_mul_ps(forceY, inverseMass));
+        __m128 velocityX = _mm_add_ps(_mm_load_ps(&m_velocityX[i]), _mm_mul_ps(forceX, kickVector));
+        __m128 velocityY = _mm_add_ps(_mm_load_ps(&m_velocityY[i]), _mm_mul_ps(forceY, kickVector));
+        velocityX = _mm_mul_ps(velocityX, dampingVector);
+        velocityY = _mm_mul_ps(velocityY, dampingVector);
+        __m128 length = _mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY));
+        __m128 limited = _mm_cmpgt_ps(length, squaredVelocityLimit);
+        __m128 scale = _mm_or_ps(
+            _mm_and_ps(limited, _mm_mul_ps(velocityLimit, _mm_rsqrt_ps(length))), _mm_andnot_ps(limited, ones));
+        __m128i fixed = _mm_cvtsi32_si128(
+            *reinterpret_cast<const int*> (&m_fixed[i]) | *reinterpret_cast<const int*> (&m_sleeping[i]));
+        fixed = _mm_unpacklo_epi16(_mm_unpacklo_epi8(fixed, zeroInteger), zeroInteger);
+        __m128 movable = _mm_castsi128_ps(_mm_cmpeq_epi32(fixed, zeroInteger));
+        velocityX = _mm_and_ps(_mm_mul_ps(velocityX, scale), movable);
+        velocityY = _mm_and_ps(_mm_mul_ps(velocityY, scale), movable);
+        _mm_store_ps(&m_velocityX[i], velocityX);
+        _mm_store_ps(&m_velocityY[i], velocityY);
+        _mm_store_ps(&m_forceX[i], zero);
+        _mm_store_ps(&m_forceY[i], zero);
+        _mm_store_ps(&m_x[i], _mm_add_ps(x, _mm_mul_ps(velocityX, timeVector)));
+        _mm_store_ps(&m_y[i], _mm_add_ps(y, _mm_mul_ps(velocityY, timeVector)));
+        __m128 force = _mm_and_ps(_mm_add_ps(_mm_mul_ps(forceX, forceX), _mm_mul_ps(forceY, forceY)), movable);
+        _mm_store_ps(&m_netForces[i], force);
+        forcesSum = _mm_add_ps(forcesSum, force);
+        length = _mm_add_ps(_mm_mul_ps(velocityX, velocityX), _mm_mul_ps(velocityY, velocityY));
+        energy = _mm_add_ps(energy, length);
+        maximum = _mm_max_ps(maximum, length);
+    }
+    maximum = _mm_max_ps(maximum, _mm_movehl_ps(maximum, maximum));
+    maximum = _mm_max_ss(maximum, _mm_shuffle_ps(maximum, maximum, 0b01010101));
+    *maxVelocity = _mm_cvtss_f32(maximum);
+    energy = _mm_hadd_ps(energy, forcesSum);
+    energy = _mm_hadd_ps(energy, energy);
+    *forces = _mm_cvtss_f32(_mm_shuffle_ps(energy, energy, 0b01010101));
+    return _mm_cvtss_f32(energy);
+}
+
+
+/**
+ * Puts calm vertices to sleep.
+ *
+ * Parameters:
+ * >velocity
+ * Velocity limit: a vertex is calm on a step if length of its velocity is less than the limit.
+ * >force
+ * Force limit: a vertex is calm on a step only if length of the net force applied to it on the step is less than the
+ * limit too.
+ * >steps
+ * Number of calm steps in a row after which a vertex falls asleep.
+ *
+ * Returns:
+ * Number of moving vertices: awake vertices which weren't calm on this step.
+ *
+ * Remarks:
+ * The method must be called after the `integrate` or the `integrateVerlet` method, which keep the net force of each
+ * vertex (with the drift and the gravity, multiplied by the inverse mass) in the `m_netForces`. The leapfrog scheme
+ * keeps velocities, so a vertex that turns around under a large force is slow for a few steps; the force test keeps it
+ * from falling asleep there. The Euler scheme sets velocity of a vertex to zero before each step (see
+ * `graph::updatePhysics` method), so its velocity is the force times the time slice, and the velocity test alone
+ * would do. A fixed vertex is always calm (its net force is taken as zero), so it falls asleep too and its forces
+ * aren't computed.
+ *
+ * Counters of calm steps are reset by the `wake` method, so a vertex woken by its neighbour (see the
+ * `spring_set::wakeNeighbors` and `BHUT flat_barnes_hut_tree::wakeNeighbors` methods) doesn't fall asleep until it's
+ * been calm for `steps` steps again.
+ */
+size_t physics_state::updateRest(
+    _In_ const float velocity, _In_ const float force, _In_ const uint8_t steps) noexcept
+{
+    const float limit = velocity * velocity;
+    const float forceLimit = force * force;
+    size_t result = 0;
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        m_moving[i] = 0;
+        if (m_sleeping[i])
+        {
+            continue;
+        }
+        if ((limit > m_velocityX[i] * m_velocityX[i] + m_velocityY[i] * m_velocityY[i]) &&
+            (forceLimit > m_netForces[i]))
+        {
+            if (steps <= ++m_calmSteps[i])
+            {
+                m_sleeping[i] = 1;
+            }
+        }
+        else
+        {
+            m_calmSteps[i] = 0;
+            m_moving[i] = 1;
+            ++result;
+        }
+    }
+    return result;
+}
+
+ARBOR_END
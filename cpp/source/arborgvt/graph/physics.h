@@ -0,0 +1,357 @@
+﻿#pragma once
+#include "ns/arbor.h"
+#include "service/sse.h"
+#include "service/stladdon.h"
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+#include <utility>
+#include <vector>
+
+ARBOR_BEGIN
+
+/**
+ * `physics_state` class keeps physical parameters of graph vertices: coordinates, velocities, forces and masses.
+ *
+ * Remarks:
+ * Each parameter is stored in its own contiguous array, indexed by a vertex identifier. Identifiers are dense: the
+ * `add` method returns the size of the arrays before the call. So a physics pass reads only the arrays it needs, one
+ * cache line holds the same parameter of sixteen vertices, and the arrays can be read by whole SSE/AVX vectors. Names,
+ * colors and other attributes of vertices, which aren't used by physics, stay in `vertex` objects.
+ *
+ * The arrays are aligned on a 32-byte boundary and padded to a multiple of `m_stride` elements by zero coordinates,
+ * velocities, forces and masses of fixed vertices, so the `integrate` method processes whole AVX2 vectors (eight
+ * vertices per instruction, or four per SSE instruction if the CPU doesn't support AVX2) without a scalar tail loop.
+ * Each vector returned by this class is formatted as [x, y, 0, 0] (mass is returned as a vector of four equal values),
+ * and only the x and y lanes of a vector passed to this class are stored.
+ *
+ * A vertex may sleep (see the `updateRest` method): the integrator doesn't move a sleeping vertex, and force passes
+ * skip it as a target, but it still repulses other vertices. A vertex is woken by the `wake` method; a new vertex is
+ * awake.
+ */
+class physics_state
+{
+public:
+    typedef std::vector<float, STLADD aligned_allocator<float, 32>> floats_cont_t;
+    typedef std::vector<uint8_t, STLADD default_allocator<uint8_t>> flags_cont_t;
+
+    physics_state()
+        :
+        m_x {},
+        m_y {},
+        m_velocityX {},
+        m_velocityY {},
+        m_forceX {},
+        m_forceY {},
+        m_masses {},
+        m_inverseMasses {},
+        m_fixed {},
+        m_sleeping {},
+        m_moving {},
+        m_calmSteps {},
+        m_netForces {},
+        m_size {0},
+        m_avx2 {simd_cpu_capabilities::avx2()}
+    {
+    }
+
+    physics_state(_In_ const physics_state&) = delete;
+    physics_state& operator =(_In_ const physics_state&) = delete;
+
+    size_t __vectorcall add(_In_ const __m128 coordinates)
+    {
+        size_t id = m_size;
+        if (m_x.size() == id)
+        {
+            size_t size = id + m_stride;
+            m_x.resize(size, 0.0f);
+            m_y.resize(size, 0.0f);
+            m_velocityX.resize(size, 0.0f);
+            m_velocityY.resize(size, 0.0f);
+            m_forceX.resize(size, 0.0f);
+            m_forceY.resize(size, 0.0f);
+            m_masses.resize(size, 0.0f);
+            m_inverseMasses.resize(size, 0.0f);
+            m_fixed.resize(size, 1);
+            m_sleeping.resize(size, 0);
+            m_moving.resize(size, 0);
+            m_calmSteps.resize(size, 0);
+            m_netForces.resize(size, 0.0f);
+        }
+        ++m_size;
+        setCoordinates(id, coordinates);
+        setMass(id, 1.0f);
+        setFixed(id, false);
+        wake(id);
+        return id;
+    }
+
+    void clear() noexcept
+    {
+        m_size = 0;
+        m_x.clear();
+        m_y.clear();
+        m_velocityX.clear();
+        m_velocityY.clear();
+        m_forceX.clear();
+        m_forceY.clear();
+        m_masses.clear();
+        m_inverseMasses.clear();
+        m_fixed.clear();
+        m_sleeping.clear();
+        m_moving.clear();
+        m_calmSteps.clear();
+        m_netForces.clear();
+    }
+
+    size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    // Exchanges the vertices of this state and of the `right` one (see `graph_hierarchy`).
+    void swap(_Inout_ physics_state& right) noexcept
+    {
+        m_x.swap(right.m_x);
+        m_y.swap(right.m_y);
+        m_velocityX.swap(right.m_velocityX);
+        m_velocityY.swap(right.m_velocityY);
+        m_forceX.swap(right.m_forceX);
+        m_forceY.swap(right.m_forceY);
+        m_masses.swap(right.m_masses);
+        m_inverseMasses.swap(right.m_inverseMasses);
+        m_fixed.swap(right.m_fixed);
+        m_sleeping.swap(right.m_sleeping);
+        m_moving.swap(right.m_moving);
+        m_calmSteps.swap(right.m_calmSteps);
+        m_netForces.swap(right.m_netForces);
+        std::swap(m_size, right.m_size);
+    }
+
+    __m128 __vectorcall getCoordinates(_In_ const size_t id) const noexcept
+    {
+        return _mm_unpacklo_ps(_mm_load_ss(&m_x[id]), _mm_load_ss(&m_y[id]));
+    }
+
+    void __vectorcall setCoordinates(_In_ const size_t id, _In_ const __m128 value) noexcept
+    {
+        _mm_store_ss(&m_x[id], value);
+        _mm_store_ss(&m_y[id], _mm_shuffle_ps(value, value, 0b01010101));
+    }
+
+    __m128 __vectorcall getVelocity(_In_ const size_t id) const noexcept
+    {
+        return _mm_unpacklo_ps(_mm_load_ss(&m_velocityX[id]), _mm_load_ss(&m_velocityY[id]));
+    }
+
+    void __vectorcall setVelocity(_In_ const size_t id, _In_ const __m128 value) noexcept
+    {
+        _mm_store_ss(&m_velocityX[id], value);
+        _mm_store_ss(&m_velocityY[id], _mm_shuffle_ps(value, value, 0b01010101));
+    }
+
+    __m128 __vectorcall getForce(_In_ const size_t id) const noexcept
+    {
+        return _mm_unpacklo_ps(_mm_load_ss(&m_forceX[id]), _mm_load_ss(&m_forceY[id]));
+    }
+
+    void __vectorcall setForce(_In_ const size_t id, _In_ const __m128 value) noexcept
+    {
+        _mm_store_ss(&m_forceX[id], value);
+        _mm_store_ss(&m_forceY[id], _mm_shuffle_ps(value, value, 0b01010101));
+    }
+
+    __m128 __vectorcall getMass(_In_ const size_t id) const noexcept
+    {
+        return _mm_load_ps1(&m_masses[id]);
+    }
+
+    void setMass(_In_ const size_t id, _In_ const float value) noexcept
+    {
+        m_masses[id] = value;
+        m_inverseMasses[id] = 1.0f / value;
+    }
+
+    bool getFixed(_In_ const size_t id) const noexcept
+    {
+        return 0 != m_fixed[id];
+    }
+
+    void setFixed(_In_ const size_t id, _In_ const bool value) noexcept
+    {
+        m_fixed[id] = value ? 1 : 0;
+    }
+
+    bool getSleeping(_In_ const size_t id) const noexcept
+    {
+        return 0 != m_sleeping[id];
+    }
+
+    // Was the vertex moving at the last `updateRest` call (it was awake and its velocity wasn't below the limit)?
+    bool getMoving(_In_ const size_t id) const noexcept
+    {
+        return 0 != m_moving[id];
+    }
+
+    // Wakes the vertex up if it's sleeping, and restarts counting of its calm steps if it isn't.
+    void wake(_In_ const size_t id) noexcept
+    {
+        m_sleeping[id] = 0;
+        m_calmSteps[id] = 0;
+    }
+
+    void wakeAll() noexcept
+    {
+        std::fill(m_sleeping.begin(), m_sleeping.end(), uint8_t {0});
+        std::fill(m_calmSteps.begin(), m_calmSteps.end(), uint8_t {0});
+    }
+
+    // Wakes up all vertices for one step: counters of calm steps are kept, so a vertex that is still calm falls asleep
+    // again at the next `updateRest` call.
+    void probeAll() noexcept
+    {
+        std::fill(m_sleeping.begin(), m_sleeping.end(), uint8_t {0});
+    }
+
+    size_t getSleepingNumber() const noexcept
+    {
+        return std::count(m_sleeping.cbegin(), m_sleeping.cend(), uint8_t {1});
+    }
+
+    void __vectorcall applyForce(_In_ const size_t id, _In_ const __m128 value) noexcept
+    {
+        __m128 temp = _mm_mul_ps(value, _mm_load_ps1(&m_inverseMasses[id]));
+        m_forceX[id] += _mm_cvtss_f32(temp);
+        m_forceY[id] += _mm_cvtss_f32(_mm_shuffle_ps(temp, temp, 0b01010101));
+    }
+
+    __m128 getCoordinatesSum() const noexcept;
+    __m128 getForcesSum() const noexcept;
+    float __vectorcall integrate(
+        _In_ const __m128 drift, _In_ const float gravity, _In_ const float friction, _In_ const float time) noexcept;
+    float __vectorcall integrateVerlet(
+        _In_ const __m128 drift,
+        _In_ const float gravity,
+        _In_ const float damping,
+        _In_ const float kick,
+        _In_ const float time,
+        _Out_ float* forces,
+        _Out_ float* maxVelocity) noexcept;
+    size_t __fastcall updateRest(
+        _In_ const float velocity, _In_ const float force, _In_ const uint8_t steps) noexcept;
+
+    const float* getX() const noexcept
+    {
+        return m_x.data();
+    }
+
+    const float* getY() const noexcept
+    {
+        return m_y.data();
+    }
+
+    const float* getMasses() const noexcept
+    {
+        return m_masses.data();
+    }
+
+    const float* getInverseMasses() const noexcept
+    {
+        return m_inverseMasses.data();
+    }
+
+    float* getForceX() noexcept
+    {
+        return m_forceX.data();
+    }
+
+    float* getForceY() noexcept
+    {
+        return m_forceY.data();
+    }
+
+
+private:
+    // Number of floats in an AVX2 vector.
+    static constexpr size_t m_stride = 8;
+
+    // Tag type to choose a kernel with or without the gravity.
+    template <bool>
+    struct gravity_type
+    {
+    };
+    typedef gravity_type<true> gravity_t;
+    typedef gravity_type<false> no_gravity_t;
+
+    template <bool G>
+    float __vectorcall integrateAvx2(
+        _In_ const __m128 drift, _In_ const float gravity, _In_ const float friction, _In_ const float time) noexcept;
+    template <bool G>
+    float __vectorcall integrateSse(
+        _In_ const __m128 drift, _In_ const float gravity, _In_ const float friction, _In_ const float time) noexcept;
+    template <bool G>
+    float __vectorcall integrateVerletAvx2(
+        _In_ const __m128 drift,
+        _In_ const float gravity,
+        _In_ const float damping,
+        _In_ const float kick,
+        _In_ const float time,
+        _Out_ float* forces,
+        _Out_ float* maxVelocity) noexcept;
+    template <bool G>
+    float __vectorcall integrateVerletSse(
+        _In_ const __m128 drift,
+        _In_ const float gravity,
+        _In_ const float damping,
+        _In_ const float kick,
+        _In_ const float time,
+        _Out_ float* forces,
+        _Out_ float* maxVelocity) noexcept;
+    static __m256 __vectorcall addGravity(
+        _In_ const __m256 force, _In_ const __m256 coordinate, _In_ const __m256 gravity, _In_ gravity_t) noexcept
+    {
+        return _mm256_add_ps(force, _mm256_mul_ps(coordinate, gravity));
+    }
+
+    static __m256 __vectorcall addGravity(
+        _In_ const __m256 force, _In_ const __m256, _In_ const __m256, _In_ no_gravity_t) noexcept
+    {
+        return force;
+    }
+
+    static __m128 __vectorcall addGravity(
+        _In_ const __m128 force, _In_ const __m128 coordinate, _In_ const __m128 gravity, _In_ gravity_t) noexcept
+    {
+        return _mm_add_ps(force, _mm_mul_ps(coordinate, gravity));
+    }
+
+    static __m128 __vectorcall addGravity(
+        _In_ const __m128 force, _In_ const __m128, _In_ const __m128, _In_ no_gravity_t) noexcept
+    {
+        return force;
+    }
+
+    floats_cont_t m_x;
+    floats_cont_t m_y;
+    floats_cont_t m_velocityX;
+    floats_cont_t m_velocityY;
+    floats_cont_t m_forceX;
+    floats_cont_t m_forceY;
+    floats_cont_t m_masses;
+    // `1 / m_masses`, so applying a force is a multiplication.
+    floats_cont_t m_inverseMasses;
+    flags_cont_t m_fixed;
+    // Non-zero for a sleeping vertex (see the `updateRest` method).
+    flags_cont_t m_sleeping;
+    // Non-zero for a vertex that wasn't calm at the last `updateRest` call.
+    flags_cont_t m_moving;
+    // Number of the last steps in a row the vertex has been calm.
+    flags_cont_t m_calmSteps;
+    // Squared length of the net force of the vertex on the last integrated step; zero for a fixed or sleeping vertex.
+    floats_cont_t m_netForces;
+    // Number of vertices; the arrays are padded beyond it.
+    size_t m_size;
+    const bool m_avx2;
+};
+
+ARBOR_END
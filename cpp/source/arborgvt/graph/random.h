@@ -0,0 +1,72 @@
+﻿#pragma once
+#include "ns/arbor.h"
+#include <cstdint>
+#include <emmintrin.h>
+#include <sal.h>
+
+ARBOR_BEGIN
+
+/**
+ * `random_engine` class generates pseudo-random numbers by four xoshiro128+ generators at once, one per lane of an SSE
+ * vector.
+ *
+ * Remarks:
+ * State of the engine is four SSE integer vectors, so seeding it costs a few dozen instructions, not a system call and
+ * initialization of 5 KB of the `std::mt19937` state. Each call of the `next` method makes four 32-bit numbers by a
+ * handful of SSE2 integer instructions and turns their upper 24 bits into floats. The sequence depends on the seed only
+ * and doesn't depend on the compiler or its standard library (`std::uniform_real_distribution` does), so a seeded
+ * graph lays out the same way, bit for bit, on each run.
+ *
+ * The state is filled by the SplitMix32 sequence started from the seed, so close seeds give unrelated sequences. Words
+ * of the sequence are distinct, so a lane never gets the all-zero state, which xoshiro128+ can't leave.
+ */
+class random_engine
+{
+public:
+    explicit random_engine(_In_ const uint32_t value = 0) noexcept
+    {
+        seed(value);
+    }
+
+    void seed(_In_ const uint32_t value) noexcept
+    {
+        alignas(16) uint32_t state[16];
+        uint32_t x = value;
+        for (uint32_t& word : state)
+        {
+            x += 0x9e3779b9;
+            uint32_t z = x;
+            z = (z ^ (z >> 16)) * 0x85ebca6b;
+            z = (z ^ (z >> 13)) * 0xc2b2ae35;
+            word = z ^ (z >> 16);
+        }
+        m_s0 = _mm_load_si128(reinterpret_cast<const __m128i*> (&state[0]));
+        m_s1 = _mm_load_si128(reinterpret_cast<const __m128i*> (&state[4]));
+        m_s2 = _mm_load_si128(reinterpret_cast<const __m128i*> (&state[8]));
+        m_s3 = _mm_load_si128(reinterpret_cast<const __m128i*> (&state[12]));
+    }
+
+    // Returns four random floats, uniformly distributed in [0, 1).
+    __m128 __vectorcall next() noexcept
+    {
+        __m128i result = _mm_add_epi32(m_s0, m_s3);
+        __m128i temp = _mm_slli_epi32(m_s1, 9);
+        m_s2 = _mm_xor_si128(m_s2, m_s0);
+        m_s3 = _mm_xor_si128(m_s3, m_s1);
+        m_s1 = _mm_xor_si128(m_s1, m_s2);
+        m_s0 = _mm_xor_si128(m_s0, m_s3);
+        m_s2 = _mm_xor_si128(m_s2, temp);
+        m_s3 = _mm_or_si128(_mm_slli_epi32(m_s3, 11), _mm_srli_epi32(m_s3, 21));
+        // The upper 24 bits are exactly representable by a float; the lower bits of xoshiro128+ are the weak ones.
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+    }
+
+
+private:
+    __m128i m_s0;
+    __m128i m_s1;
+    __m128i m_s2;
+    __m128i m_s3;
+};
+
+ARBOR_END
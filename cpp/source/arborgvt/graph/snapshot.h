@@ -0,0 +1,168 @@
+﻿#pragma once
+#include "graph/physics.h"
+#include "graph/vector.h"
+#include "ns/arbor.h"
+#include "service/sse.h"
+#include "service/stladdon.h"
+#include <atomic>
+#include <cstdint>
+#include <immintrin.h>
+#include <vector>
+
+ARBOR_BEGIN
+
+/**
+ * `layout_snapshot` class keeps a copy of graph layout made after a simulation step: coordinates of the vertices,
+ * indexed by a vertex identifier, and the graph bound.
+ *
+ * Remarks:
+ * A snapshot also keeps numbers of vertices and edges the graph had when the snapshot was made, and the graph
+ * generation (it's changed by each `graph::clear` call, so a reader knows that identifiers it has met before don't
+ * belong to the graph anymore). Vertices and edges are never removed from a graph, other than by `graph::clear`, so
+ * vertices with identifiers less than `getVerticesNumber()` and the first `getEdgesNumber()` edges of the same
+ * generation exist in the graph.
+ *
+ * The coordinates are formatted as [x, y, 0, 0], the graph bound is formatted as [bottom-y, right-x, top-y, left-x].
+ */
+class layout_snapshot
+{
+public:
+    typedef physics_state::floats_cont_t floats_cont_t;
+
+    layout_snapshot()
+        :
+        m_x {},
+        m_y {},
+        m_verticesNumber {0},
+        m_edgesNumber {0},
+        m_generation {0},
+        m_step {0}
+    {
+        m_graphBound = getZeroVector();
+    }
+
+    layout_snapshot(_In_ const layout_snapshot&) = delete;
+    layout_snapshot& operator =(_In_ const layout_snapshot&) = delete;
+
+    // Copies the layout into this snapshot. Capacity of the arrays is kept, so once the snapshot has grown to the size
+    // of the graph, no memory is allocated.
+    void __vectorcall assign(
+        _In_ const physics_state& state,
+        _In_ const size_t edgesNumber,
+        _In_ const __m128 graphBound,
+        _In_ const uint32_t generation,
+        _In_ const uint32_t step)
+    {
+        m_verticesNumber = state.size();
+        m_x.assign(state.getX(), state.getX() + m_verticesNumber);
+        m_y.assign(state.getY(), state.getY() + m_verticesNumber);
+        m_edgesNumber = edgesNumber;
+        m_graphBound = graphBound;
+        m_generation = generation;
+        m_step = step;
+    }
+
+    __m128 __vectorcall getCoordinates(_In_ const size_t id) const noexcept
+    {
+        return _mm_unpacklo_ps(_mm_load_ss(&m_x[id]), _mm_load_ss(&m_y[id]));
+    }
+
+    size_t getVerticesNumber() const noexcept
+    {
+        return m_verticesNumber;
+    }
+
+    size_t getEdgesNumber() const noexcept
+    {
+        return m_edgesNumber;
+    }
+
+    __m128 __vectorcall getGraphBound() const noexcept
+    {
+        return m_graphBound;
+    }
+
+    uint32_t getGeneration() const noexcept
+    {
+        return m_generation;
+    }
+
+    uint32_t getStep() const noexcept
+    {
+        return m_step;
+    }
+
+
+private:
+    __m128 m_graphBound;
+    floats_cont_t m_x;
+    floats_cont_t m_y;
+    size_t m_verticesNumber;
+    size_t m_edgesNumber;
+    uint32_t m_generation;
+    uint32_t m_step;
+};
+
+
+/**
+ * `snapshot_buffer` class passes `layout_snapshot`s from a writer (the graph) to a reader (a renderer) without locks.
+ *
+ * Remarks:
+ * This is a triple buffer. The writer owns the 'back' snapshot and fills it, the reader owns the 'front' snapshot and
+ * reads it, and the third one is the last published snapshot. Publishing swaps the back snapshot with the published
+ * one by a single atomic exchange and marks the published one as fresh; acquiring swaps the front snapshot with the
+ * published one, if the last is fresh. So neither side ever waits for the other, the reader always gets the latest
+ * complete snapshot, and a snapshot isn't changed while the reader uses it (until the next `acquire` call).
+ *
+ * There must be one writer and one reader at a time: calls of `getBack` and `publish` must be serialized (the graph
+ * makes them under its exclusive vertices lock), and so must be calls of `acquire` (the graph window makes them on its
+ * own thread).
+ */
+class snapshot_buffer
+{
+public:
+    snapshot_buffer()
+        :
+        m_snapshots {},
+        m_back {0},
+        m_front {1},
+        m_published {2}
+    {
+    }
+
+    snapshot_buffer(_In_ const snapshot_buffer&) = delete;
+    snapshot_buffer& operator =(_In_ const snapshot_buffer&) = delete;
+
+    layout_snapshot* getBack() noexcept
+    {
+        return &m_snapshots[m_back];
+    }
+
+    void publish() noexcept
+    {
+        m_back = static_cast<uint8_t> (m_published.exchange(static_cast<uint8_t> (m_back | m_fresh)) & m_indexMask);
+    }
+
+    const layout_snapshot& acquire() noexcept
+    {
+        if (m_fresh & m_published.load())
+        {
+            m_front = static_cast<uint8_t> (m_published.exchange(m_front) & m_indexMask);
+        }
+        return m_snapshots[m_front];
+    }
+
+
+private:
+    // The `m_published` value is an index of the published snapshot, combined with the `m_fresh` flag if the reader
+    // hasn't acquired that snapshot yet.
+    static constexpr uint8_t m_indexMask = 0b0011;
+    static constexpr uint8_t m_fresh = 0b0100;
+
+    layout_snapshot m_snapshots[3];
+    uint8_t m_back;
+    uint8_t m_front;
+    std::atomic<uint8_t> m_published;
+};
+
+ARBOR_END
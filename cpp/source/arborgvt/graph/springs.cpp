@@ -0,0 +1,557 @@
+﻿#include "graph/springs.h"
+#include "graph/vector.h"
+#include <algorithm>
+#include <intrin.h>
+#include <numeric>
+
+ARBOR_BEGIN
+
+/**
+ * Checks whether this set has a spring between the specified vertices.
+ *
+ * Parameters:
+ * >tail
+ * Identifier of the tail vertex.
+ * >head
+ * Identifier of the head vertex.
+ *
+ * Returns:
+ * true if there's a spring from the `tail` vertex to the `head` one; otherwise false.
+ */
+bool spring_set::contains(_In_ const size_t tail, _In_ const size_t head) const noexcept
+{
+    const uint32_t tailId = static_cast<uint32_t> (tail);
+    const uint32_t headId = static_cast<uint32_t> (head);
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        if ((m_tails[i] == tailId) && (m_heads[i] == headId))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Changes forces, applied to both vertices of each spring.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ * >seed
+ * Seed of the random engines.
+ * >pool
+ * Threads used to compute and to apply the forces.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Force of a spring is its direction (from the tail vertex to the head one) multiplied by half of the stiffness and by
+ * difference between length of the spring and distance between the vertices. The force is applied to the head vertex,
+ * and the opposite one is applied to the tail vertex, just as `physics_state::applyForce` method does it. If both the
+ * vertices have the same coordinates, the direction is random.
+ *
+ * The arrays are sorted first (see the `sort` method) if neither the tails nor the heads are in ascending order. Then
+ * each thread of the `pool`
+ * computes forces of its own range of springs by the `computeForcesAvx2` or the `computeForcesSse` method (chosen by
+ * the CPU once, when this object is created). Then the forces are added to the vertices: by the `scatterForces` method
+ * if the `pool` has one thread, otherwise by the `gatherForces` method, called by each thread for its own range of
+ * vertices. The ranges of vertices are chosen so that each of them has about the same number of springs.
+ */
+void spring_set::apply(_In_ physics_state* state, _In_ const uint32_t seed, _In_ MISCUTIL thread_pool* pool)
+{
+    if (0 == m_size)
+    {
+        return;
+    }
+    if ((m_sortedSize != m_size) && !m_headsOrdered)
+    {
+        sort();
+        m_incidencesValid = false;
+    }
+    size_t size = 2 * m_tails.size();
+    if (m_contributionsX.size() != size)
+    {
+        m_contributionsX.resize(size, 0.0f);
+        m_contributionsY.resize(size, 0.0f);
+    }
+    auto computeTask = [this, state, seed] (_In_ const size_t index, _In_ const size_t count) -> void
+    {
+        size_t blocks = m_tails.size() / m_stride;
+        size_t first = blocks * index / count * m_stride;
+        size_t last = blocks * (index + 1) / count * m_stride;
+        last = (m_size < last) ? m_size : last;
+        if (m_avx2)
+        {
+            computeForcesAvx2(state, first, last, seed);
+        }
+        else
+        {
+            computeForcesSse(state, first, last, seed);
+        }
+    };
+    pool->run(computeTask);
+    if (1 == pool->getThreadsNumber())
+    {
+        scatterForces(state);
+        return;
+    }
+    if (!m_incidencesValid)
+    {
+        buildIncidences();
+        m_incidencesValid = true;
+    }
+    auto gatherTask = [this, state] (_In_ const size_t index, _In_ const size_t count) -> void
+    {
+        auto end = m_offsets.cend() - 1;
+        size_t vertices = end - m_offsets.cbegin();
+        size_t total = m_offsets.back();
+        size_t first = std::lower_bound(m_offsets.cbegin(), end, total * index / count) - m_offsets.cbegin();
+        size_t last = vertices;
+        if (count != index + 1)
+        {
+            last = std::lower_bound(m_offsets.cbegin(), end, total * (index + 1) / count) - m_offsets.cbegin();
+        }
+        gatherForces(state, first, last);
+    };
+    pool->run(gatherTask);
+}
+
+
+/**
+ * Wakes up vertices of the springs added since the last call.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * A new spring changes forces of both its vertices. Only those vertices are woken up (see `m_addedEnds`), the other
+ * vertices are woken up by the `wakeNeighbors` method once these ones move.
+ */
+void spring_set::wakeAdded(_In_ physics_state* state)
+{
+    for (uint32_t id: m_addedEnds)
+    {
+        state->wake(id);
+    }
+    m_addedEnds.clear();
+}
+
+
+/**
+ * Wakes up vertices whose neighbours are moving.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices; `physics_state::updateRest` method has been called for them.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * A vertex is woken up if the other vertex of its spring is moving (see the `physics_state::getMoving` method), so a
+ * disturbance spreads along the edges by one edge per step, and vertices of a moving region don't fall asleep.
+ */
+void spring_set::wakeNeighbors(_In_ physics_state* state)
+{
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        uint32_t tail = m_tails[i];
+        uint32_t head = m_heads[i];
+        if (state->getMoving(tail))
+        {
+            state->wake(head);
+        }
+        if (state->getMoving(head))
+        {
+            state->wake(tail);
+        }
+    }
+}
+
+
+/**
+ * Finds the greatest rigidity of a vertex: sum of stiffnesses of its springs multiplied by its inverse mass.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ *
+ * Returns:
+ * The greatest rigidity, or zero if there are no springs.
+ *
+ * Remarks:
+ * Squared frequency of the fastest oscillation the springs can make is not greater than the doubled result, so the
+ * result limits the time slice an integrator is stable with.
+ */
+float spring_set::getMaxRigidity(_In_ const physics_state& state) const
+{
+    floats_cont_t rigidities(state.size(), 0.0f);
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        rigidities[m_tails[i]] += m_stiffnesses[i];
+        rigidities[m_heads[i]] += m_stiffnesses[i];
+    }
+    const float* inverseMasses = state.getInverseMasses();
+    float result = 0.0f;
+    for (size_t i = 0; rigidities.size() > i; ++i)
+    {
+        result = std::max(result, rigidities[i] * inverseMasses[i]);
+    }
+    return result;
+}
+
+
+/**
+ * Sorts the springs by identifiers of their tail vertices.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The first `m_sortedSize` springs are sorted already. The rest of them is sorted, and then both ranges are merged, so
+ * the cost is linear in number of the springs plus the sort of the new ones only. The sort and the merge are stable
+ * (of two springs with the same tail, the sorted one goes first), so springs sharing a tail vertex keep the order they
+ * were added in.
+ */
+void spring_set::sort()
+{
+    std::vector<uint32_t, STLADD default_allocator<uint32_t>> order(m_size - m_sortedSize);
+    std::iota(order.begin(), order.end(), static_cast<uint32_t> (m_sortedSize));
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [this] (_In_ const uint32_t left, _In_ const uint32_t right) -> bool
+        {
+            return m_tails[left] < m_tails[right];
+        });
+    ids_cont_t tails(m_tails.size(), 0);
+    ids_cont_t heads(m_heads.size(), 0);
+    floats_cont_t lengths(m_lengths.size(), 0.0f);
+    floats_cont_t stiffnesses(m_stiffnesses.size(), 0.0f);
+    size_t sorted = 0;
+    auto added = order.cbegin();
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        size_t source;
+        if ((order.cend() == added) || ((m_sortedSize > sorted) && (m_tails[sorted] <= m_tails[*added])))
+        {
+            source = sorted++;
+        }
+        else
+        {
+            source = *added++;
+        }
+        tails[i] = m_tails[source];
+        heads[i] = m_heads[source];
+        lengths[i] = m_lengths[source];
+        stiffnesses[i] = m_stiffnesses[source];
+    }
+    m_tails.swap(tails);
+    m_heads.swap(heads);
+    m_lengths.swap(lengths);
+    m_stiffnesses.swap(stiffnesses);
+    m_sortedSize = m_size;
+}
+
+
+/**
+ * Builds lists of springs of each vertex.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is a counting sort of the springs ends by the vertex identifier. Springs of a vertex are listed in the order of
+ * the springs; if both ends of a spring are the same vertex, the head end is listed first (that's the order the
+ * `scatterForces` method adds the forces in).
+ */
+void spring_set::buildIncidences()
+{
+    uint32_t vertices = 0;
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        vertices = std::max(vertices, std::max(m_tails[i], m_heads[i]) + 1);
+    }
+    m_offsets.assign(vertices + 1, 0);
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        ++m_offsets[m_heads[i] + 1];
+        ++m_offsets[m_tails[i] + 1];
+    }
+    for (size_t i = 1; m_offsets.size() > i; ++i)
+    {
+        m_offsets[i] += m_offsets[i - 1];
+    }
+    ids_cont_t positions {m_offsets.cbegin(), m_offsets.cend() - 1};
+    const uint32_t tailsOffset = static_cast<uint32_t> (m_tails.size());
+    m_incidences.resize(2 * m_size);
+    for (uint32_t i = 0; m_size > i; ++i)
+    {
+        m_incidences[positions[m_heads[i]]++] = i;
+        m_incidences[positions[m_tails[i]]++] = tailsOffset + i;
+    }
+}
+
+
+/**
+ * Computes forces of the specified springs, using AVX2 instructions.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ * >first
+ * Number of the first spring; it must be a multiple of `m_stride`.
+ * >last
+ * Number of the spring that follows the last one.
+ * >seed
+ * Seed of the random engine.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * See the `apply` method. Eight springs are processed at once: coordinates and inverse masses of their vertices are
+ * gathered by vertex identifiers. Lanes of springs which vertices have the same coordinates get random directions by
+ * the `setRandomDirections` method; the random engine is seeded by the `seed` and the number of the first spring of
+ * the eight before that, so the directions don't depend on number of threads.
+ */
+void spring_set::computeForcesAvx2(
+    _In_ const physics_state* state, _In_ const size_t first, _In_ const size_t last, _In_ const uint32_t seed)
+{
+    const float half = 0.5f;
+    const __m256 halfVector = _mm256_broadcast_ss(&half);
+    const __m256 zero = _mm256_setzero_ps();
+    const float* x = state->getX();
+    const float* y = state->getY();
+    const float* inverseMasses = state->getInverseMasses();
+    const size_t tailsOffset = m_tails.size();
+    alignas(32) float directionX[m_stride];
+    alignas(32) float directionY[m_stride];
+    for (size_t i = first; last > i; i += m_stride)
+    {
+        __m256i tails = _mm256_load_si256(reinterpret_cast<const __m256i*> (&m_tails[i]));
+        __m256i heads = _mm256_load_si256(reinterpret_cast<const __m256i*> (&m_heads[i]));
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(x, heads, 4), _mm256_i32gather_ps(x, tails, 4));
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(y, heads, 4), _mm256_i32gather_ps(y, tails, 4));
+        __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        __m256 reciprocal = _mm256_rcp_ps(distance);
+        dx = _mm256_mul_ps(dx, reciprocal);
+        dy = _mm256_mul_ps(dy, reciprocal);
+        size_t count = last - i;
+        count = (m_stride < count) ? m_stride : count;
+        unsigned int lanes = _mm256_movemask_ps(_mm256_cmp_ps(distance, zero, _CMP_EQ_OQ)) & ((1u << count) - 1);
+        if (lanes)
+        {
+            _mm256_store_ps(directionX, dx);
+            _mm256_store_ps(directionY, dy);
+            seedRandomVector(seed - static_cast<uint32_t> (i) - 1);
+            setRandomDirections(lanes, directionX, directionY);
+            dx = _mm256_load_ps(directionX);
+            dy = _mm256_load_ps(directionY);
+        }
+        // force = direction * stiffness / 2 * (length - distance)
+        __m256 scale = _mm256_mul_ps(_mm256_load_ps(&m_stiffnesses[i]), halfVector);
+        scale = _mm256_mul_ps(scale, _mm256_sub_ps(_mm256_load_ps(&m_lengths[i]), distance));
+        dx = _mm256_mul_ps(dx, scale);
+        dy = _mm256_mul_ps(dy, scale);
+        __m256 inverseMass = _mm256_i32gather_ps(inverseMasses, heads, 4);
+        _mm256_store_ps(&m_contributionsX[i], _mm256_mul_ps(dx, inverseMass));
+        _mm256_store_ps(&m_contributionsY[i], _mm256_mul_ps(dy, inverseMass));
+        inverseMass = _mm256_sub_ps(zero, _mm256_i32gather_ps(inverseMasses, tails, 4));
+        _mm256_store_ps(&m_contributionsX[tailsOffset + i], _mm256_mul_ps(dx, inverseMass));
+        _mm256_store_ps(&m_contributionsY[tailsOffset + i], _mm256_mul_ps(dy, inverseMass));
+    }
+    _mm256_zeroupper();
+}
+
+
+/**
+ * Computes forces of the specified springs, using SSE instructions.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ * >first
+ * Number of the first spring; it must be a multiple of `m_stride`.
+ * >last
+ * Number of the spring that follows the last one.
+ * >seed
+ * Seed of the random engine.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * This is the `computeForcesAvx2` method for CPUs without AVX2 support, four springs at once. There's no SSE gather
+ * instruction, so coordinates and inverse masses are loaded one by one.
+ */
+void spring_set::computeForcesSse(
+    _In_ const physics_state* state, _In_ const size_t first, _In_ const size_t last, _In_ const uint32_t seed)
+{
+    auto gather = [] (_In_ const float* values, _In_reads_(4) const uint32_t* ids) -> __m128
+    {
+        return _mm_setr_ps(values[ids[0]], values[ids[1]], values[ids[2]], values[ids[3]]);
+    };
+
+    const float half = 0.5f;
+    const __m128 halfVector = _mm_load_ps1(&half);
+    const __m128 zero = _mm_setzero_ps();
+    const float* x = state->getX();
+    const float* y = state->getY();
+    const float* inverseMasses = state->getInverseMasses();
+    const size_t tailsOffset = m_tails.size();
+    alignas(16) float directionX[m_stride];
+    alignas(16) float directionY[m_stride];
+    for (size_t i = first; last > i; i += 4)
+    {
+        const uint32_t* tails = &m_tails[i];
+        const uint32_t* heads = &m_heads[i];
+        __m128 dx = _mm_sub_ps(gather(x, heads), gather(x, tails));
+        __m128 dy = _mm_sub_ps(gather(y, heads), gather(y, tails));
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 reciprocal = _mm_rcp_ps(distance);
+        dx = _mm_mul_ps(dx, reciprocal);
+        dy = _mm_mul_ps(dy, reciprocal);
+        size_t count = last - i;
+        count = (4 < count) ? 4 : count;
+        unsigned int lanes = _mm_movemask_ps(_mm_cmpeq_ps(distance, zero)) & ((1u << count) - 1);
+        if (lanes)
+        {
+            _mm_store_ps(directionX, dx);
+            _mm_store_ps(directionY, dy);
+            seedRandomVector(seed - static_cast<uint32_t> (i) - 1);
+            setRandomDirections(lanes, directionX, directionY);
+            dx = _mm_load_ps(directionX);
+            dy = _mm_load_ps(directionY);
+        }
+        __m128 scale = _mm_mul_ps(_mm_load_ps(&m_stiffnesses[i]), halfVector);
+        scale = _mm_mul_ps(scale, _mm_sub_ps(_mm_load_ps(&m_lengths[i]), distance));
+        dx = _mm_mul_ps(dx, scale);
+        dy = _mm_mul_ps(dy, scale);
+        __m128 inverseMass = gather(inverseMasses, heads);
+        _mm_store_ps(&m_contributionsX[i], _mm_mul_ps(dx, inverseMass));
+        _mm_store_ps(&m_contributionsY[i], _mm_mul_ps(dy, inverseMass));
+        inverseMass = _mm_sub_ps(zero, gather(inverseMasses, tails));
+        _mm_store_ps(&m_contributionsX[tailsOffset + i], _mm_mul_ps(dx, inverseMass));
+        _mm_store_ps(&m_contributionsY[tailsOffset + i], _mm_mul_ps(dy, inverseMass));
+    }
+}
+
+
+/**
+ * Replaces directions of the specified springs by random unit vectors.
+ *
+ * Parameters:
+ * >lanes
+ * Bit mask of the springs; the least significant bit stands for the first element of the arrays.
+ * >directionX
+ * X coordinates of the directions.
+ * >directionY
+ * Y coordinates of the directions.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The springs are processed in ascending order.
+ */
+void spring_set::setRandomDirections(
+    _In_ unsigned int lanes, _Inout_updates_(8) float* directionX, _Inout_updates_(8) float* directionY)
+{
+    for (; lanes; lanes &= lanes - 1)
+    {
+        unsigned long lane;
+        _BitScanForward(&lane, lanes);
+        __m128 temp = randomVector(1.0f);
+        __m128 temp2 = _mm_mul_ps(temp, temp);
+        temp2 = _mm_add_ps(temp2, _mm_shuffle_ps(temp2, temp2, 0b10110001));
+        temp = _mm_mul_ps(temp, _mm_rsqrt_ps(temp2));
+        _mm_store_ss(&directionX[lane], temp);
+        _mm_store_ss(&directionY[lane], _mm_shuffle_ps(temp, temp, 0b01010101));
+    }
+}
+
+
+/**
+ * Adds computed forces of all springs to forces of their vertices, in order of the springs.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ *
+ * Returns:
+ * N/A.
+ */
+void spring_set::scatterForces(_In_ physics_state* state) const noexcept
+{
+    float* forceX = state->getForceX();
+    float* forceY = state->getForceY();
+    const size_t tailsOffset = m_tails.size();
+    for (size_t i = 0; m_size > i; ++i)
+    {
+        uint32_t head = m_heads[i];
+        uint32_t tail = m_tails[i];
+        forceX[head] += m_contributionsX[i];
+        forceY[head] += m_contributionsY[i];
+        forceX[tail] += m_contributionsX[tailsOffset + i];
+        forceY[tail] += m_contributionsY[tailsOffset + i];
+    }
+}
+
+
+/**
+ * Adds computed forces of springs to forces of the specified vertices.
+ *
+ * Parameters:
+ * >state
+ * Physical parameters of the vertices.
+ * >first
+ * Identifier of the first vertex.
+ * >last
+ * Identifier of the vertex that follows the last one.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Each vertex is written only by this call, so calls for different ranges can run at once. The forces of a vertex are
+ * added in the same order as the `scatterForces` method adds them. A sleeping vertex is skipped: the integrator ignores
+ * its force anyway.
+ */
+void spring_set::gatherForces(_In_ physics_state* state, _In_ const size_t first, _In_ const size_t last) const noexcept
+{
+    float* forceX = state->getForceX();
+    float* forceY = state->getForceY();
+    for (size_t i = first; last > i; ++i)
+    {
+        if (state->getSleeping(i))
+        {
+            continue;
+        }
+        float x = forceX[i];
+        float y = forceY[i];
+        for (uint32_t j = m_offsets[i]; m_offsets[i + 1] > j; ++j)
+        {
+            uint32_t contribution = m_incidences[j];
+            x += m_contributionsX[contribution];
+            y += m_contributionsY[contribution];
+        }
+        forceX[i] = x;
+        forceY[i] = y;
+    }
+}
+
+ARBOR_END
@@ -0,0 +1,210 @@
+﻿#pragma once
+#include "graph/physics.h"
+#include "ns/arbor.h"
+#include "service/sse.h"
+#include "service/stladdon.h"
+#include "service/thrdpool.h"
+#include <cstdint>
+#include <immintrin.h>
+#include <utility>
+#include <vector>
+
+ARBOR_BEGIN
+
+/**
+ * `spring_set` class keeps physical parameters of graph edges: identifiers of the tail and head vertices, lengths and
+ * stiffnesses.
+ *
+ * Remarks:
+ * Each parameter is stored in its own contiguous array, indexed by a spring number; vertex identifiers are 32-bit
+ * numbers (`physics_state` identifiers). So computing spring forces is a linear pass over four arrays, which reads
+ * coordinates of eight springs' vertices by two AVX2 gather instructions per array (or four springs by scalar loads if
+ * the CPU doesn't support AVX2). Colors, drawing style and user data of edges, which aren't used by physics, stay in
+ * `edge` objects.
+ *
+ * Several springs may share a vertex, so forces of different springs can't be added to the vertex by different threads
+ * at once. The `apply` method works in two passes. First, threads compute forces of their own ranges of springs and
+ * store them into the `m_contributionsX` and `m_contributionsY` arrays. Second, each thread takes its own range of
+ * vertices and adds to each of them forces of its springs, found by the `m_offsets` and `m_incidences` arrays (list of
+ * springs of each vertex). The forces of a vertex are added in order of the springs, so the sum is the same, bit for
+ * bit, as the sum of the serial pass (used by a pool of one thread), whatever number of threads is used.
+ *
+ * Vertices are read and written by random access, so the order of springs matters for a large graph: if neither the
+ * tail nor the head identifiers are in ascending order (edges were added in arbitrary order), the arrays are sorted by
+ * the tail identifier before the forces are applied, so springs sharing a tail vertex access the same cache lines one
+ * after another. Only the springs beyond the sorted ones are sorted, and they're merged into the sorted ones, so adding
+ * a few edges to a large graph doesn't sort it again. If the head identifiers are already in ascending order (that's
+ * how edges and their new vertices are usually added), the arrays are left as they are: sorting by tails would scatter
+ * the heads. The arrays are aligned on a 32-byte boundary and padded to a multiple of `m_stride` elements; the padding
+ * springs are never applied.
+ *
+ * Vertices of the springs added since the last `wakeAdded` call are kept by the `m_addedEnds` array, since merged
+ * springs don't stay together.
+ */
+class spring_set
+{
+public:
+    typedef std::vector<uint32_t, STLADD aligned_allocator<uint32_t, 32>> ids_cont_t;
+    typedef std::vector<float, STLADD aligned_allocator<float, 32>> floats_cont_t;
+
+    spring_set()
+        :
+        m_tails {},
+        m_heads {},
+        m_lengths {},
+        m_stiffnesses {},
+        m_contributionsX {},
+        m_contributionsY {},
+        m_offsets {},
+        m_incidences {},
+        m_addedEnds {},
+        m_size {0},
+        m_sortedSize {0},
+        m_headsOrdered {true},
+        m_incidencesValid {false},
+        m_avx2 {simd_cpu_capabilities::avx2()}
+    {
+    }
+
+    spring_set(_In_ const spring_set&) = delete;
+    spring_set& operator =(_In_ const spring_set&) = delete;
+
+    void add(_In_ const size_t tail, _In_ const size_t head, _In_ const float length, _In_ const float stiffness)
+    {
+        size_t index = m_size;
+        if (m_tails.size() == index)
+        {
+            size_t size = index + m_stride;
+            m_tails.resize(size, 0);
+            m_heads.resize(size, 0);
+            m_lengths.resize(size, 0.0f);
+            m_stiffnesses.resize(size, 0.0f);
+        }
+        ++m_size;
+        m_tails[index] = static_cast<uint32_t> (tail);
+        m_heads[index] = static_cast<uint32_t> (head);
+        m_lengths[index] = length;
+        m_stiffnesses[index] = stiffness;
+        m_incidencesValid = false;
+        m_addedEnds.push_back(m_tails[index]);
+        m_addedEnds.push_back(m_heads[index]);
+        if ((m_sortedSize == index) && ((0 == index) || (m_tails[index - 1] <= m_tails[index])))
+        {
+            m_sortedSize = m_size;
+        }
+        if (0 != index)
+        {
+            m_headsOrdered = m_headsOrdered && (m_heads[index - 1] <= m_heads[index]);
+        }
+    }
+
+    void clear() noexcept
+    {
+        m_size = 0;
+        m_sortedSize = 0;
+        m_headsOrdered = true;
+        m_incidencesValid = false;
+        m_tails.clear();
+        m_heads.clear();
+        m_lengths.clear();
+        m_stiffnesses.clear();
+        m_contributionsX.clear();
+        m_contributionsY.clear();
+        m_offsets.clear();
+        m_incidences.clear();
+        m_addedEnds.clear();
+    }
+
+    size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    // Exchanges the springs of this set and of the `right` one (see `graph_hierarchy`).
+    void swap(_Inout_ spring_set& right) noexcept
+    {
+        m_tails.swap(right.m_tails);
+        m_heads.swap(right.m_heads);
+        m_lengths.swap(right.m_lengths);
+        m_stiffnesses.swap(right.m_stiffnesses);
+        m_contributionsX.swap(right.m_contributionsX);
+        m_contributionsY.swap(right.m_contributionsY);
+        m_offsets.swap(right.m_offsets);
+        m_incidences.swap(right.m_incidences);
+        m_addedEnds.swap(right.m_addedEnds);
+        std::swap(m_size, right.m_size);
+        std::swap(m_sortedSize, right.m_sortedSize);
+        std::swap(m_headsOrdered, right.m_headsOrdered);
+        std::swap(m_incidencesValid, right.m_incidencesValid);
+    }
+
+    // Parameters of the springs, in the order of the last `apply` call; each array has `size()` valid elements.
+    const uint32_t* getTails() const noexcept
+    {
+        return m_tails.data();
+    }
+
+    const uint32_t* getHeads() const noexcept
+    {
+        return m_heads.data();
+    }
+
+    const float* getLengths() const noexcept
+    {
+        return m_lengths.data();
+    }
+
+    const float* getStiffnesses() const noexcept
+    {
+        return m_stiffnesses.data();
+    }
+
+    bool __fastcall contains(_In_ const size_t tail, _In_ const size_t head) const noexcept;
+    void __fastcall apply(_In_ physics_state* state, _In_ const uint32_t seed, _In_ MISCUTIL thread_pool* pool);
+    void __fastcall wakeAdded(_In_ physics_state* state);
+    void __fastcall wakeNeighbors(_In_ physics_state* state);
+    float __fastcall getMaxRigidity(_In_ const physics_state& state) const;
+
+
+private:
+    // Number of floats in an AVX2 vector.
+    static constexpr size_t m_stride = 8;
+
+    void sort();
+    void buildIncidences();
+    void __fastcall computeForcesAvx2(
+        _In_ const physics_state* state, _In_ const size_t first, _In_ const size_t last, _In_ const uint32_t seed);
+    void __fastcall computeForcesSse(
+        _In_ const physics_state* state, _In_ const size_t first, _In_ const size_t last, _In_ const uint32_t seed);
+    static void __fastcall setRandomDirections(
+        _In_ unsigned int lanes, _Inout_updates_(8) float* directionX, _Inout_updates_(8) float* directionY);
+    void __fastcall scatterForces(_In_ physics_state* state) const noexcept;
+    void __fastcall gatherForces(
+        _In_ physics_state* state, _In_ const size_t first, _In_ const size_t last) const noexcept;
+
+    ids_cont_t m_tails;
+    ids_cont_t m_heads;
+    floats_cont_t m_lengths;
+    floats_cont_t m_stiffnesses;
+    // Forces of the springs, already multiplied by inverse masses of the vertices. Forces applied to the head vertices
+    // are stored first, then forces applied to the tail vertices (from the `m_tails.size()` element).
+    floats_cont_t m_contributionsX;
+    floats_cont_t m_contributionsY;
+    // Springs of the vertex with the i identifier are `m_incidences` elements from `m_offsets[i]` to
+    // `m_offsets[i + 1]`; each element is an index in the `m_contributionsX` and `m_contributionsY` arrays.
+    ids_cont_t m_offsets;
+    ids_cont_t m_incidences;
+    // Tail and head identifiers of the springs added since the last `wakeAdded` call.
+    ids_cont_t m_addedEnds;
+    // Number of springs; the arrays are padded beyond it.
+    size_t m_size;
+    // Number of the first springs, which are in ascending order of the tail identifiers.
+    size_t m_sortedSize;
+    // Are the head identifiers in ascending order?
+    bool m_headsOrdered;
+    // Do the `m_offsets` and `m_incidences` arrays correspond to the springs?
+    bool m_incidencesValid;
+    const bool m_avx2;
+};
+
+ARBOR_END
@@ -1,6 +1,6 @@
-﻿#include "graph/vector.h"
+﻿#include "graph/random.h"
+#include "graph/vector.h"
 #include "service/sse.h"
-#include <random>
 
 ARBOR_BEGIN
 
@@ -19,6 +19,15 @@ public:
 };
 static zero_initializer zero_init {};
 
+/*
+ * Each thread has its own random engine, so `randomVector` can be called by several threads at once. The engine is
+ * re-seeded lazily, when it's used after the `seedRandomVector` call for the first time: force passes set a seed for
+ * each range of vertices, but rarely need a random value.
+ */
+static thread_local random_engine engine {};
+static thread_local uint32_t pendingSeed = 0;
+static thread_local bool seedPending = false;
+
 
 /**
  * Gets vector of four packed single precision floating-point zero values.
@@ -50,12 +59,13 @@ __m128 __vectorcall getZeroVector()
  */
 __m128 __vectorcall randomVector(_In_ const __m128 c)
 {
-    static std::random_device rd {};
-    static std::mt19937 engine {rd()};
-    static std::uniform_real_distribution<float> distribution {0.0f, 1.0f};
-    sse_t value = {distribution(engine), 0.5f, distribution(engine), 0.5f};
-    __m128 temp = _mm_load_ps(value.data);
-    temp = _mm_hsub_ps(temp, temp);
+    if (seedPending)
+    {
+        engine.seed(pendingSeed);
+        seedPending = false;
+    }
+    __m128 temp = _mm_sub_ps(engine.next(), _mm_set1_ps(0.5f));
+    temp = _mm_shuffle_ps(temp, temp, 0b01000100);
     return _mm_mul_ps(temp, c);
 }
 
@@ -109,4 +119,26 @@ inline __m128 __vectorcall randomVector(_In_ const float a)
     return randomVector(a * 2.0f, a * 2.0f);
 }
 
+
+/**
+ * Sets seed of the random engine used by the calling thread.
+ *
+ * Parameters:
+ * >seed
+ * New seed value.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * Sequence of values returned by `randomVector` functions on the calling thread after this call depends on the `seed`
+ * only. So a caller, which sets a seed before a piece of work, gets the same "random" values for that piece of work,
+ * whatever thread does the work.
+ */
+void __fastcall seedRandomVector(_In_ const uint32_t seed) noexcept
+{
+    pendingSeed = seed;
+    seedPending = true;
+}
+
 ARBOR_END
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "ns/arbor.h"
+#include <cstdint>
 #include <sal.h>
 #include <xmmintrin.h>
 
@@ -10,5 +11,6 @@ extern __m128 __vectorcall getZeroVector();
 extern __m128 __vectorcall randomVector(_In_ const __m128 c);
 extern __m128 __vectorcall randomVector(_In_ const float x, _In_ const float y);
 extern __m128 __vectorcall randomVector(_In_ const float a);
+extern void __fastcall seedRandomVector(_In_ const uint32_t seed) noexcept;
 
 ARBOR_END
@@ -1,5 +1,5 @@
 ﻿#pragma once
-#include "graph/vector.h"
+#include "graph/physics.h"
 #include "ns/arbor.h"
 #include "service/sse.h"
 #include "service/stladdon.h"
@@ -12,6 +12,11 @@ ARBOR_BEGIN
  *
  * Remarks:
  * An instance of the `vertex` class MUST be aligned on a 16-byte boundary!
+ *
+ * The class keeps attributes of a vertex that physics doesn't use: name, colors and user-defined data. Coordinates,
+ * velocity, force, mass and the fixed flag of a vertex are stored by `physics_state` of the graph, at the vertex
+ * identifier; the accessors of these parameters forward to it. Just like the accessors of the former fields, they
+ * don't lock the graph.
  */
 class vertex
 {
@@ -28,41 +33,14 @@ public:
         }
     }
 
-    explicit vertex(_In_ STLADD string_type&& name)
+    vertex(_In_ STLADD string_type&& name, _In_ physics_state* physics, _In_ const size_t id)
         :
+        m_physics {physics},
+        m_id {id},
         m_name {std::move(name)},
-        m_data {nullptr},
-        m_fixed {false}
+        m_data {nullptr}
     {
         sse_t value;
-        /*
-         * Set `m_coordinates` to QNaN.
-         *
-         * I use QNaN (as .NET Framework 4.6 does (remember about roots of the code)); therefore the code mostly doesn't
-         * throw an exception. But if one turns to SNaN, the code may throw an exception on SSE instructions once a
-         * floating-point exception was unmasked.
-         *
-         * By default, the C++ run-time libraries mask all floating-point exceptions. And I don't change it.
-         *
-         * I believe this all is totally unnecessary -- initializing `m_coordinates` with NaN. Code never uses this
-         * ctor but always use another one, which initialize `m_coordinates` with a specific floating-point value.
-         * Having this ctor available just forces code to do additinal checks before use vertex coordinates, just like
-         * this:
-         *
-         * if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(m_coordinate, m_coordinate))))
-         * { ... }
-         *
-         * Both `CMPPS` and `MOVMSKPS` are far from being the fastest instructions.
-         */
-        *(reinterpret_cast<uint32_t*> (value.data)) = 0x7FC00000;
-        m_coordinates = _mm_load_ps(value.data);
-        m_coordinates = _mm_shuffle_ps(m_coordinates, m_coordinates, 0);
-        value.data[0] = 1.0f;
-        m_mass = _mm_load_ps(value.data);
-        m_mass = _mm_shuffle_ps(m_mass, m_mass, 0);
-        // Set `m_force` and `m_velocity` to zero.
-        m_force = getZeroVector();
-        m_velocity = m_force;
         // Set `m_color` to gray.
         value = {0.501960814f, 0.501960814f, 0.501960814f, 1.0f};
         m_color = _mm_load_ps(value.data);
@@ -72,22 +50,6 @@ public:
         m_textColor = _mm_load_ps(value.data);
     }
 
-    /*
-     * VC++ 2015 Update 1, assigning a `__m128` variable to another `__m128` variable: when the VC++ compiler makes
-     * "debug" build (x86 or x64) the compiler generates the `MOVUPS` instruction (for my current Debug settings).
-     * Although all the affected memory location are aligned on a 16-byte boundary. But when CL makes "release" build
-     * (x86 or x64), it generates the `MOVAPS` instruction (one that I need). So it ain't required to use `_mm_load_ps`
-     * and `_mm_store_ps` intrinsics.
-     *
-     * Moreover, sometime even Debug builds use `MOVAPS` instruction.
-     */
-    vertex(_In_ STLADD string_type&& name, _In_ __m128 coordinates)
-        :
-        vertex(std::move(name))
-    {
-        m_coordinates = coordinates;
-    }
-
     vertex& operator =(_In_ const vertex&) = delete;
 
     vertex& operator =(_In_ vertex&& right) noexcept
@@ -101,39 +63,27 @@ public:
 
     void swap(_Inout_ vertex& right) noexcept
     {
-        // `m_coordinates` can be NaN, but `XORPS` doesn't fail on NaNs.
         // 'Cos this method uses XOR-swapping never call it to swap an object with itself.
-        m_coordinates = _mm_xor_ps(m_coordinates, right.m_coordinates);
-        right.m_coordinates = _mm_xor_ps(m_coordinates, right.m_coordinates);
-        m_coordinates = _mm_xor_ps(m_coordinates, right.m_coordinates);
         m_color = _mm_xor_ps(m_color, right.m_color);
         right.m_color = _mm_xor_ps(m_color, right.m_color);
         m_color = _mm_xor_ps(m_color, right.m_color);
         m_textColor = _mm_xor_ps(m_textColor, right.m_textColor);
         right.m_textColor = _mm_xor_ps(m_textColor, right.m_textColor);
         m_textColor = _mm_xor_ps(m_textColor, right.m_textColor);
-        m_mass = _mm_xor_ps(m_mass, right.m_mass);
-        right.m_mass = _mm_xor_ps(m_mass, right.m_mass);
-        m_mass = _mm_xor_ps(m_mass, right.m_mass);
-        m_force = _mm_xor_ps(m_force, right.m_force);
-        right.m_force = _mm_xor_ps(m_force, right.m_force);
-        m_force = _mm_xor_ps(m_force, right.m_force);
-        m_velocity = _mm_xor_ps(m_velocity, right.m_velocity);
-        right.m_velocity = _mm_xor_ps(m_velocity, right.m_velocity);
-        m_velocity = _mm_xor_ps(m_velocity, right.m_velocity);
+        std::swap(m_physics, right.m_physics);
+        std::swap(m_id, right.m_id);
         std::swap(m_name, right.m_name);
         std::swap(m_data, right.m_data);
-        std::swap(m_fixed, right.m_fixed);
     }
 
     __m128 __vectorcall getCoordinates() const noexcept
     {
-        return m_coordinates;
+        return m_physics->getCoordinates(m_id);
     }
 
     void __vectorcall setCoordinates(_In_ const __m128 value) noexcept
     {
-        m_coordinates = value;
+        m_physics->setCoordinates(m_id, value);
     }
 
     __m128 __vectorcall getColor() const noexcept
@@ -158,32 +108,32 @@ public:
 
     __m128 __vectorcall getMass() const noexcept
     {
-        return m_mass;
+        return m_physics->getMass(m_id);
     }
 
     void __vectorcall setMass(_In_ __m128 value) noexcept
     {
-        m_mass = value;
+        m_physics->setMass(m_id, _mm_cvtss_f32(value));
     }
 
     __m128 __vectorcall getForce() const noexcept
     {
-        return m_force;
+        return m_physics->getForce(m_id);
     }
 
     void __vectorcall setForce(_In_ const __m128 value) noexcept
     {
-        m_force = value;
+        m_physics->setForce(m_id, value);
     }
 
     __m128 __vectorcall getVelocity() const noexcept
     {
-        return m_velocity;
+        return m_physics->getVelocity(m_id);
     }
 
     void __vectorcall setVelocity(_In_ const __m128 value) noexcept
     {
-        m_velocity = value;
+        m_physics->setVelocity(m_id, value);
     }
 
     const STLADD string_type* getName() const noexcept
@@ -203,18 +153,22 @@ public:
 
     bool getFixed() const noexcept
     {
-        return m_fixed;
+        return m_physics->getFixed(m_id);
     }
 
     void setFixed(_In_ bool value) noexcept
     {
-        m_fixed = value;
+        m_physics->setFixed(m_id, value);
     }
 
     void __vectorcall applyForce(_In_ const __m128 value) noexcept
     {
-        // `value` must not be zero.
-        m_force = _mm_add_ps(m_force, _mm_mul_ps(value, _mm_rcp_ps(m_mass)));
+        m_physics->applyForce(m_id, value);
+    }
+
+    size_t getId() const noexcept
+    {
+        return m_id;
     }
 
 
@@ -228,16 +182,17 @@ private:
      * allocates a memory without knowing what C++ type will be construct in that memory. That's why I didn't declare
      * `vertex` class with `__declspec(align(16))` attribute / `alignas(16)` specifier. Anyway the class has it
      * implicitly because of C++ compiler math.
+     *
+     * `m_physics` and `m_id` take the first 16 bytes, where the coordinates used to be, so `m_color` and `m_textColor`
+     * keep their offsets (see `ARBORVIS_VERSION`).
      */
-    __m128 m_coordinates;
+    // Physical parameters of the vertices of the graph, and index of this vertex parameters in it.
+    physics_state* m_physics;
+    size_t m_id;
     __m128 m_color;
     __m128 m_textColor;
-    __m128 m_mass;
-    __m128 m_force;
-    __m128 m_velocity;
     STLADD string_type m_name;
     void* m_data;
-    bool m_fixed;
 };
 
 ARBOR_END
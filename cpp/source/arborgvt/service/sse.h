@@ -24,4 +24,21 @@ public:
             return false;
         }
     }
+
+    static bool avx2() noexcept
+    {
+        int info[4];
+        __cpuid(info, 0x00);
+        if (0x07 <= info[0])
+        {
+            __cpuid(info, 0x01);
+            // AVX and OSXSAVE flags; then the OS must save YMM registers on context switches.
+            if ((0x18000000 == (0x18000000 & info[2])) && (0b0110 == (0b0110 & _xgetbv(0))))
+            {
+                __cpuidex(info, 0x07, 0x00);
+                return 0 != (0x20 & info[1]);
+            }
+        }
+        return false;
+    }
 };
@@ -0,0 +1,220 @@
+﻿#include "service/thrdpool.h"
+
+MISCUTIL_BEGIN
+
+/**
+ * Creates the pool.
+ *
+ * Parameters:
+ * >threadsNumber
+ * Number of threads in the pool, including the thread that calls `run` method. Zero value is treated as one.
+ *
+ * Returns:
+ * N/A.
+ */
+thread_pool::thread_pool(_In_ const size_t threadsNumber)
+    :
+    m_workers {},
+    m_lock {},
+    m_taskReady {},
+    m_taskDone {},
+    m_task {nullptr},
+    m_context {nullptr},
+    m_generation {0},
+    m_pending {0},
+    m_exception {},
+    m_stop {false}
+{
+    startWorkers(threadsNumber ? threadsNumber - 1 : 0);
+}
+
+
+/**
+ * Stops all worker threads and waits for them.
+ */
+thread_pool::~thread_pool()
+{
+    stopWorkers();
+}
+
+
+/**
+ * Changes number of threads in the pool.
+ *
+ * Parameters:
+ * >threadsNumber
+ * New number of threads in the pool, including the thread that calls `run` method. Zero value is treated as one.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The method stops all current worker threads and starts new ones. Don't call it while the `run` method works.
+ */
+void thread_pool::setThreadsNumber(_In_ const size_t threadsNumber)
+{
+    size_t workersNumber = threadsNumber ? threadsNumber - 1 : 0;
+    if (m_workers.size() != workersNumber)
+    {
+        stopWorkers();
+        startWorkers(workersNumber);
+    }
+}
+
+
+/**
+ * Runs the specified task on all threads of the pool and waits until the threads have finished it.
+ *
+ * Parameters:
+ * >task
+ * Task to run.
+ * >context
+ * Task argument.
+ *
+ * Returns:
+ * N/A.
+ */
+void thread_pool::runTask(_In_ task_t task, _In_ void* context)
+{
+    size_t count = getThreadsNumber();
+    if (1 == count)
+    {
+        task(context, 0, 1);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock {m_lock};
+        m_task = task;
+        m_context = context;
+        m_pending = m_workers.size();
+        m_exception = nullptr;
+        ++m_generation;
+    }
+    m_taskReady.notify_all();
+    std::exception_ptr exception {};
+    try
+    {
+        task(context, 0, count);
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+    std::unique_lock<std::mutex> lock {m_lock};
+    m_taskDone.wait(lock, [this] () -> bool {return !m_pending;});
+    if (!exception)
+    {
+        exception = m_exception;
+    }
+    m_exception = nullptr;
+    lock.unlock();
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+
+/**
+ * Starts the specified number of worker threads.
+ *
+ * Parameters:
+ * >workersNumber
+ * Number of worker threads.
+ *
+ * Returns:
+ * N/A.
+ */
+void thread_pool::startWorkers(_In_ const size_t workersNumber)
+{
+    m_workers.reserve(workersNumber);
+    for (size_t i = 1; workersNumber >= i; ++i)
+    {
+        m_workers.emplace_back(&thread_pool::workerProc, this, i, m_generation);
+    }
+}
+
+
+/**
+ * Stops all worker threads and waits for them.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ */
+void thread_pool::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock {m_lock};
+        m_stop = true;
+    }
+    m_taskReady.notify_all();
+    for (auto it = m_workers.begin(); m_workers.end() != it; ++it)
+    {
+        it->join();
+    }
+    m_workers.clear();
+    m_stop = false;
+}
+
+
+/**
+ * Worker thread procedure.
+ *
+ * Parameters:
+ * >index
+ * Ordinal number of the thread in the pool.
+ * >generation
+ * Value of the `m_generation` when the thread was started.
+ *
+ * Returns:
+ * N/A.
+ */
+void thread_pool::workerProc(_In_ const size_t index, _In_ size_t generation)
+{
+    for (;;)
+    {
+        task_t task;
+        void* context;
+        size_t count;
+        {
+            std::unique_lock<std::mutex> lock {m_lock};
+            m_taskReady.wait(lock, [this, generation] () -> bool {return m_stop || (m_generation != generation);});
+            if (m_stop)
+            {
+                return;
+            }
+            generation = m_generation;
+            task = m_task;
+            context = m_context;
+            count = m_workers.size() + 1;
+        }
+        std::exception_ptr exception {};
+        try
+        {
+            task(context, index, count);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock {m_lock};
+            if (exception && !m_exception)
+            {
+                m_exception = exception;
+            }
+            done = !--m_pending;
+        }
+        if (done)
+        {
+            m_taskDone.notify_one();
+        }
+    }
+}
+
+MISCUTIL_END
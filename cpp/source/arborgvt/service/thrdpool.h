@@ -0,0 +1,84 @@
+﻿#pragma once
+#include "ns/miscutil.h"
+#include "service/stladdon.h"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+MISCUTIL_BEGIN
+
+/**
+ * `thread_pool` class runs a task on several threads at once.
+ *
+ * Remarks:
+ * The pool uses static partitioning. The `run` method calls the task once on each thread of the pool, passing to it
+ * ordinal number of the thread and number of threads in the pool. It's the task who decides which part of the whole
+ * work corresponds to the ordinal number. The thread that calls `run` is a pool thread too (with zero ordinal number),
+ * so a pool of one thread doesn't start any worker thread and runs the task synchronously.
+ *
+ * The `run` method returns after all threads have finished the task. If the task throws an exception on any thread, the
+ * `run` method re-throws the first caught exception on the calling thread.
+ *
+ * Only one thread may call `run` or `setThreadsNumber` at a time.
+ *
+ * In order to make the code more platform-independent I use `std::thread` from C++ library and not MSFT Windows
+ * specific thread pool API.
+ */
+class thread_pool
+{
+public:
+    explicit thread_pool(_In_ const size_t threadsNumber);
+    thread_pool(_In_ const thread_pool&) = delete;
+    thread_pool& operator =(_In_ const thread_pool&) = delete;
+    ~thread_pool();
+
+    size_t getThreadsNumber() const noexcept
+    {
+        return m_workers.size() + 1;
+    }
+
+    void __fastcall setThreadsNumber(_In_ const size_t threadsNumber);
+
+    /*
+     * `T` is a callable type with the `void (_In_ const size_t index, _In_ const size_t count)` signature. The task is
+     * passed by reference and isn't copied, so running a lambda doesn't allocate memory.
+     */
+    template <typename T>
+    void run(_In_ T& task)
+    {
+        runTask(&invoke<T>, &task);
+    }
+
+
+private:
+    typedef void (*task_t)(_In_ void* context, _In_ const size_t index, _In_ const size_t count);
+    typedef std::vector<std::thread, STLADD default_allocator<std::thread>> threads_cont_t;
+
+    template <typename T>
+    static void invoke(_In_ void* context, _In_ const size_t index, _In_ const size_t count)
+    {
+        (*static_cast<T*> (context))(index, count);
+    }
+
+    void __fastcall runTask(_In_ task_t task, _In_ void* context);
+    void __fastcall startWorkers(_In_ const size_t workersNumber);
+    void stopWorkers();
+    void __fastcall workerProc(_In_ const size_t index, _In_ size_t generation);
+
+    threads_cont_t m_workers;
+    std::mutex m_lock;
+    std::condition_variable m_taskReady;
+    std::condition_variable m_taskDone;
+    task_t m_task;
+    void* m_context;
+    // Incremented by each `runTask` call; a worker compares it with its own copy to find out that a new task is ready.
+    size_t m_generation;
+    // Number of workers that haven't finished the current task yet.
+    size_t m_pending;
+    std::exception_ptr m_exception;
+    bool m_stop;
+};
+
+MISCUTIL_END
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "ns/wapi.h"
+#include "service/winapi/uh.h"
+#include <Windows.h>
+
+WAPI_BEGIN
+
+/**
+ * Type traits class for 'HANDLE to file' type. Unlike other handles, an invalid file handle is INVALID_HANDLE_VALUE.
+ */
+class file_traits: public unique_handle_traits<HANDLE>
+{
+public:
+    static type invalid() noexcept
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    static void close(_In_ const type handle) noexcept
+    {
+        CloseHandle(handle);
+    }
+};
+
+typedef unique_handle<file_traits> file_t;
+
+WAPI_END
@@ -1,5 +1,36 @@
 ﻿#include "ui/nowindow/avisimpl/avisimpl.h"
 
+/**
+ * Retrieves pointers to the supported interfaces on this object.
+ *
+ * Parameters:
+ * >iid
+ * The identifier of the interface being requested.
+ * >object
+ * The address of a pointer variable that receives the interface pointer requested in the `iid` parameter.
+ *
+ * Returns:
+ * Standard HRESULT code.
+ *
+ * Remarks:
+ * `ATLADD implements` answers for the interfaces it's instantiated with only, not for their bases; so the
+ * `IArborVisual`, which the `IArborVisual2` extends, is answered here.
+ */
+HRESULT arbor_visual_impl::QueryInterface(_In_ const IID& iid, _Deref_out_opt_ void** object) noexcept
+{
+    if (__uuidof(IArborVisual) == iid)
+    {
+        *object = static_cast<IArborVisual*> (this);
+        AddRef();
+        return S_OK;
+    }
+    else
+    {
+        return implements::QueryInterface(iid, object);
+    }
+}
+
+
 /**
  * Creates a target window object where graph is rendered. The window is created asynchronously.
  *
@@ -252,6 +283,143 @@ HRESULT arbor_visual_impl::addVertex(
 }
 
 
+/**
+ * Gets parameters of the graph simulation.
+ *
+ * Parameters:
+ * >parameters
+ * Pointer to variable that receives the parameters.
+ *
+ * Returns:
+ * Standard HRESULT code.
+ */
+HRESULT arbor_visual_impl::getParameters(_Out_ ARBOR simulation_parameters* parameters)
+{
+    if (m_window)
+    {
+        *parameters = m_window->getParameters();
+        return S_OK;
+    }
+    else
+    {
+        *parameters = ARBOR graph::getDefaultParameters();
+        return E_POINTER;
+    }
+}
+
+
+/**
+ * Changes parameters of the graph simulation.
+ *
+ * Parameters:
+ * >parameters
+ * New parameters.
+ *
+ * Returns:
+ * Standard HRESULT code. `E_INVALIDARG` if the `parameters` are invalid (see the `ARBOR graph::setParameters` method).
+ *
+ * Remarks:
+ * The new parameters take effect on the next step of the simulation.
+ */
+HRESULT arbor_visual_impl::setParameters(_In_ const ARBOR simulation_parameters& parameters)
+{
+    if (m_window)
+    {
+        return m_window->setParameters(parameters) ? S_OK : E_INVALIDARG;
+    }
+    else
+    {
+        return E_POINTER;
+    }
+}
+
+
+/**
+ * Sets an object notified when the graph simulation starts and stops.
+ *
+ * Parameters:
+ * >events
+ * The object; nullptr removes the previous one.
+ *
+ * Returns:
+ * Standard HRESULT code.
+ *
+ * Remarks:
+ * Methods of the `events` are called on the simulation thread, which doesn't hold any graph lock then. The object is
+ * kept (referenced) until it's replaced by another one or the graph window is destroyed.
+ */
+HRESULT arbor_visual_impl::setEvents(_In_opt_ IArborVisualEvents* events)
+{
+    if (m_window)
+    {
+        if (events)
+        {
+            ATLADD com_ptr<IArborVisualEvents> p {events};
+            m_window->setStateCallbacks([p] () -> void { p->onStart(); }, [p] () -> void { p->onStop(); });
+        }
+        else
+        {
+            m_window->setStateCallbacks(std::function<void ()> {}, std::function<void ()> {});
+        }
+        return S_OK;
+    }
+    else
+    {
+        return E_POINTER;
+    }
+}
+
+
+/**
+ * Saves coordinates and velocities of the graph vertices, keyed by the vertex names, to a file.
+ *
+ * Parameters:
+ * >fileName
+ * Name of the file; an existing file is overwritten.
+ *
+ * Returns:
+ * Standard HRESULT code.
+ */
+HRESULT arbor_visual_impl::saveLayout(_In_z_ LPCWSTR fileName)
+{
+    if (m_window)
+    {
+        return m_window->saveLayout(fileName);
+    }
+    else
+    {
+        return E_POINTER;
+    }
+}
+
+
+/**
+ * Loads coordinates and velocities of the graph vertices from a file saved by the `saveLayout` method.
+ *
+ * Parameters:
+ * >fileName
+ * Name of the file.
+ *
+ * Returns:
+ * Standard HRESULT code. `S_FALSE` if no vertex of the file is in the graph, `HRESULT_FROM_WIN32(ERROR_INVALID_DATA)`
+ * if the file isn't a layout file.
+ *
+ * Remarks:
+ * The graph must be built before its layout is loaded (see the `ARBOR graph::loadLayout` method); vertices that aren't
+ * in the file are placed near their neighbours.
+ */
+HRESULT arbor_visual_impl::loadLayout(_In_z_ LPCWSTR fileName)
+{
+    if (m_window)
+    {
+        return m_window->loadLayout(fileName);
+    }
+    else
+    {
+        return E_POINTER;
+    }
+}
+
 /**
  * Creates a new window. The method is executing on a dedicated thread.
  *
@@ -1,17 +1,20 @@
 ﻿#pragma once
 #include "dlllayer/arborvis.h"
 #include "graph/edge.h"
+#include "graph/params.h"
 #include "graph/vertex.h"
+#include "service/com/comptr.h"
 #include "service/com/impl.h"
 #include "ui/window/child/onscreen/graphwnd.h"
+#include <functional>
 #include <memory>
 #include <thread>
 
 /**
  * `arbor_visual_impl` class.
- * Only impements the `IArborVisual`.
+ * Only impements the `IArborVisual2` (and the `IArborVisual` it extends).
  */
-class arbor_visual_impl: public ATLADD implements<IArborVisual>
+class arbor_visual_impl: public ATLADD implements<IArborVisual2>
 {
 public:
     ~arbor_visual_impl()
@@ -19,6 +22,8 @@ public:
         m_thread.join();
     }
 
+    virtual HRESULT __stdcall QueryInterface(_In_ const IID& iid, _Deref_out_opt_ void** object) noexcept override;
+
     virtual HRESULT STDMETHODCALLTYPE createWindow(
         _In_opt_ HWND parent,
         _In_ DWORD style,
@@ -51,6 +56,11 @@ public:
         _In_ float mass,
         _In_ bool fixed,
         _Outptr_result_maybenull_ ARBOR vertex** v);
+    virtual HRESULT STDMETHODCALLTYPE getParameters(_Out_ ARBOR simulation_parameters* parameters) override;
+    virtual HRESULT STDMETHODCALLTYPE setParameters(_In_ const ARBOR simulation_parameters& parameters) override;
+    virtual HRESULT STDMETHODCALLTYPE setEvents(_In_opt_ IArborVisualEvents* events) override;
+    virtual HRESULT STDMETHODCALLTYPE saveLayout(_In_z_ LPCWSTR fileName) override;
+    virtual HRESULT STDMETHODCALLTYPE loadLayout(_In_z_ LPCWSTR fileName) override;
 
 
 private:
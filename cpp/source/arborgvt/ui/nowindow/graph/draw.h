@@ -11,12 +11,9 @@
 class element_draw
 {
 public:
-    void __vectorcall createDeviceResources(_In_ ID2D1DeviceContext* deviceContext, _In_ const __m128 color)
+    void createDeviceResources(_In_ ID2D1DeviceContext* deviceContext)
     {
-        sse_t value;
-        _mm_store_ps(value.data, color);
-        deviceContext->CreateSolidColorBrush(
-            reinterpret_cast<D2D1_COLOR_F*> (value.data), nullptr, m_brush.getAddressOf());
+        deviceContext->CreateSolidColorBrush(m_color, nullptr, m_brush.getAddressOf());
     }
 
     void releaseDeviceResources()
@@ -41,7 +38,24 @@ public:
 
 
 protected:
+    explicit element_draw(_In_ const D2D1_COLOR_F& color)
+        :
+        m_brush {},
+        m_color (color)
+    {
+    }
+
+    static D2D1_COLOR_F __vectorcall toColor(_In_ const __m128 value) noexcept
+    {
+        sse_t temp;
+        _mm_store_ps(temp.data, value);
+        return D2D1::ColorF {temp.data[0], temp.data[1], temp.data[2], temp.data[3]};
+    }
+
     ATLADD com_ptr<ID2D1SolidColorBrush> m_brush;
+    // Colors are copied from the parent object when this object is created, so device resources can be (re)created
+    // without access to the graph.
+    D2D1_COLOR_F m_color;
 };
 
 /**
@@ -50,9 +64,10 @@ protected:
 class edge_draw: public element_draw
 {
 public:
-    void createDeviceResources(_In_ ID2D1DeviceContext* deviceContext, _In_ const ARBOR edge& object)
+    explicit edge_draw(_In_ const ARBOR edge& object)
+        :
+        base_class_t(toColor(object.getColor()))
     {
-        base_class_t::createDeviceResources(deviceContext, object.getColor());
     }
 
 
@@ -63,20 +78,19 @@ private:
 class vertex_draw: public element_draw
 {
 public:
-    explicit vertex_draw(_In_ ATLADD com_ptr<IDWriteTextLayout>&& textLayout)
+    vertex_draw(_In_ ATLADD com_ptr<IDWriteTextLayout>&& textLayout, _In_ const ARBOR vertex& object)
         :
+        base_class_t(toColor(object.getColor())),
         m_textBrush {},
-        m_textLayout {std::move(textLayout)}
+        m_textLayout {std::move(textLayout)},
+        m_textColor (toColor(object.getTextColor()))
     {
     }
 
-    void createDeviceResources(_In_ ID2D1DeviceContext* deviceContext, _In_ const ARBOR vertex& object)
+    void createDeviceResources(_In_ ID2D1DeviceContext* deviceContext)
     {
-        base_class_t::createDeviceResources(deviceContext, object.getColor());
-        sse_t value;
-        _mm_store_ps(value.data, object.getTextColor());
-        deviceContext->CreateSolidColorBrush(
-            reinterpret_cast<D2D1_COLOR_F*> (value.data), nullptr, m_textBrush.getAddressOf());
+        base_class_t::createDeviceResources(deviceContext);
+        deviceContext->CreateSolidColorBrush(m_textColor, nullptr, m_textBrush.getAddressOf());
     }
 
     void releaseDeviceResources()
@@ -136,4 +150,5 @@ private:
 
     ATLADD com_ptr<ID2D1SolidColorBrush> m_textBrush;
     ATLADD com_ptr<IDWriteTextLayout> m_textLayout;
+    D2D1_COLOR_F m_textColor;
 };
@@ -113,6 +113,9 @@ BOOL graph_window::ProcessWindowMessage(
  *
  * Returns:
  * To continue creation of the window returns 0. To destroy the window returns -1.
+ *
+ * Remarks:
+ * The handler starts the graph's simulation thread, which invalidates this window after each step.
  */
 LRESULT graph_window::createHandler()
 {
@@ -132,11 +135,36 @@ LRESULT graph_window::createHandler()
 #if defined(_DEBUG) || defined(SHOW_FPS)
         createTextFormatForBodyText(m_framesPerSecondTextFormat.getAddressOf());
 #endif
+        m_graph.startSimulation(
+            [this] () -> void
+            {
+                // `InvalidateRect` can be called by any thread; WM_PAINT messages are coalesced by the system.
+                Invalidate(FALSE);
+            });
     }
     return result;
 }
 
 
+/**
+ * WM_DESTROY message handler.
+ *
+ * Parameters:
+ * None.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The graph's simulation thread is stopped while the HWND is still valid, because the thread invalidates it.
+ */
+void graph_window::destroyHandler()
+{
+    m_graph.stopSimulation();
+    base_class_t::destroyHandler();
+}
+
+
 /**
  * Renders this window.
  *
@@ -157,7 +185,6 @@ void graph_window::draw()
     // Here XMM's the first and the second zeros can be omitted.
     sse_t value = {targetSize.width, targetSize.height, 0.0f, 0.0f};
     __m128 size = _mm_load_ps(value.data);
-    __m128 viewBound = m_graph.getViewBound();
 
     m_direct2DContext->Clear(D2D1::ColorF {GetSysColor(COLOR_WINDOW), 1.0f});
     /*
@@ -178,120 +205,102 @@ void graph_window::draw()
      * made by SSE instructions. Especially, when size of the graph (and therefore size of the lookup table) will be big
      * enough.
      *
-     * This method may change graph's objects (it sets user-defined data for vertices and edges). Therefore this method
-     * has to obtain _exclusive_ locks before it can access vertices and/or edges. Thus no one can change graph while
-     * this method renders it. This method must obtain vertices lock first and then edges lock -- only this order is
-     * allowed; otherwise a deadlock may occur.
+     * Positions are read from the last layout snapshot published by the graph, not from the graph itself, so this
+     * method takes no lock while it renders: a frame never waits for a physics step (and a step never waits for a
+     * frame), and no frame is skipped. The locks are taken only when the snapshot has vertices or edges this method
+     * doesn't know yet (see the `updateElements` method).
+     *
+     * New frames are requested by the graph's simulation thread after each step, and by this method while the view
+     * area moves. So nothing is rendered while the graph is at rest and the view animation is finished.
      */
     {
-        // Begin scopes for locks (they exploit RAII).
-        STLADD lock_guard_exclusive<WAPI srw_lock> verticesLock {m_graph.getVerticesLock(), std::try_to_lock};
-        if (verticesLock)
+        const ARBOR layout_snapshot& snapshot = m_graph.acquireSnapshot();
+        if (snapshot.getGeneration() != m_generation)
+        {
+            // The graph has been cleared.
+            m_vertices.clear();
+            m_edges.clear();
+            m_viewBound = ARBOR getZeroVector();
+            m_generation = snapshot.getGeneration();
+        }
+        updateElements(snapshot);
+        __m128 viewBound = ARBOR graph::getNextViewBound(m_viewBound, snapshot.getGraphBound(), size);
+        if (0b1111 != _mm_movemask_ps(_mm_cmpeq_ps(viewBound, m_viewBound)))
         {
-            // I see no sense to draw only vertices (under a designated lock) on the first step and then draw edges
-            // having locks on the both containers.
-            STLADD lock_guard_exclusive<WAPI srw_lock> edgesLock {m_graph.getEdgesLock(), std::try_to_lock};
-            if (edgesLock)
+            // The view animation isn't finished, it needs the next frame even if the graph is at rest.
+            m_viewBound = viewBound;
+            Invalidate(FALSE);
+        }
+        size_t verticesNumber = (std::min)(snapshot.getVerticesNumber(), m_vertices.size());
+        for (size_t i = 0; verticesNumber > i; ++i)
+        {
+            const vertex_draw* draw = m_vertices[i].get();
+            __m128 coordinate = snapshot.getCoordinates(i);
+            if (draw && (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinate, coordinate)))))
             {
-                for (auto it = m_graph.verticesBegin(); m_graph.verticesEnd() != it; ++it)
+                coordinate = graphToLogical(coordinate, size, m_viewBound);
+                D2D1_ELLIPSE area;
+                if (SUCCEEDED(draw->getArea(coordinate, &area)))
                 {
-                    __m128 coordinate = it->getCoordinates();
-                    if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(coordinate, coordinate))))
+                    /*
+                     * Be aware that `vertex_draw::getXXXXBrush` method below uses COM reference counting that can be
+                     * omitted here, 'cos `brush` is definitely local-only COM object.
+                     *
+                     * If you can guarantee that 'out' parameter of `vertex_draw::getXXXXBrush` method is always local
+                     * only, you can safely modify `getBrush` in a way that it will not use COM reference counting.
+                     */
+                    ATLADD com_ptr<ID2D1SolidColorBrush> brush {};
+                    if (S_OK == draw->getBrush(brush.getAddressOf()))
+                    {
+                        m_direct2DContext->FillEllipse(area, brush.get());
+                    }
+                    brush.reset();
+                    if (S_OK == draw->getTextBrush(brush.getAddressOf()))
                     {
-                        coordinate = graphToLogical(coordinate, size, viewBound);
-                        auto draw = static_cast<vertex_draw*> (it->getData());
-                        if (!draw)
+                        if (m_areaStrokeStyle)
                         {
-                            /*
-                             * If a vertex was added after device resources had created...
-                             *
-                             * This method may modify `m_graph`'s elements; that's why `draw` is non-const method.
-                             * I don't want to issue additional loops on each `WM_PAINT` before a render stage -- this
-                             * is a waste of CPU resources.
-                             */
-                            ATLADD com_ptr<IDWriteTextLayout> layout {};
-                            if (SUCCEEDED(createTextLayout(it->getName(), layout.getAddressOf())))
-                            {
-                                draw = new vertex_draw {std::move(layout)};
-                                m_vertices.emplace_back(draw);
-                                it->setData(draw);
-                                draw->createDeviceResources(m_direct2DContext.get(), *it);
-                            }
+                            m_direct2DContext->DrawEllipse(area, brush.get(), 1.0f, m_areaStrokeStyle.get());
                         }
-                        D2D1_ELLIPSE area;
-                        if (SUCCEEDED(draw->getArea(coordinate, &area)))
+                        ATLADD com_ptr<IDWriteTextLayout> layout {};
+                        if (S_OK == draw->getTextLayout(layout.getAddressOf()))
                         {
-                            /*
-                             * Be aware that `vertex_draw::getXXXXBrush` method below uses COM reference counting that
-                             * can be omitted here, 'cos `brush` is definitely local-only COM object.
-                             *
-                             * If you can guarantee that 'out' parameter of `vertex_draw::getXXXXBrush` method is always
-                             * local only, you can safely modify `getBrush` in a way that it will not use COM reference
-                             * counting.
-                             */
-                            ATLADD com_ptr<ID2D1SolidColorBrush> brush {};
-                            if (S_OK == draw->getBrush(brush.getAddressOf()))
-                            {
-                                m_direct2DContext->FillEllipse(area, brush.get());
-                            }
-                            brush.reset();
-                            if (S_OK == draw->getTextBrush(brush.getAddressOf()))
+                            DWRITE_TEXT_METRICS metrics;
+                            if (SUCCEEDED(layout->GetMetrics(&metrics)))
                             {
-                                if (m_areaStrokeStyle)
-                                {
-                                    m_direct2DContext->DrawEllipse(area, brush.get(), 1.0f, m_areaStrokeStyle.get());
-                                }
-                                ATLADD com_ptr<IDWriteTextLayout> layout {};
-                                if (S_OK == draw->getTextLayout(layout.getAddressOf()))
-                                {
-                                    DWRITE_TEXT_METRICS metrics;
-                                    if (SUCCEEDED(layout->GetMetrics(&metrics)))
-                                    {
-                                        D2D1_POINT_2F origin = D2D1::Point2F(
-                                            area.point.x - (metrics.width * 0.5f),
-                                            area.point.y - (metrics.height * 0.5f));
-                                        m_direct2DContext->DrawTextLayout(
-                                            origin, layout.get(), brush.get(), D2D1_DRAW_TEXT_OPTIONS_NONE);
-                                    }
-                                }
+                                D2D1_POINT_2F origin = D2D1::Point2F(
+                                    area.point.x - (metrics.width * 0.5f), area.point.y - (metrics.height * 0.5f));
+                                m_direct2DContext->DrawTextLayout(
+                                    origin, layout.get(), brush.get(), D2D1_DRAW_TEXT_OPTIONS_NONE);
                             }
                         }
                     }
                 }
-                for (auto it = m_graph.edgesBegin(); m_graph.edgesEnd() != it; ++it)
+            }
+        }
+        for (auto it = m_edges.cbegin(); m_edges.cend() != it; ++it)
+        {
+            if ((verticesNumber > it->tail) && (verticesNumber > it->head))
+            {
+                // Get tail and head ellipses.
+                const vertex_draw* tailDraw = m_vertices[it->tail].get();
+                const vertex_draw* headDraw = m_vertices[it->head].get();
+                __m128 tailCoordinate = snapshot.getCoordinates(it->tail);
+                __m128 headCoordinate = snapshot.getCoordinates(it->head);
+                if (tailDraw && headDraw &&
+                    (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(tailCoordinate, tailCoordinate)))) &&
+                    (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(headCoordinate, headCoordinate)))))
                 {
-                    const ARBOR vertex* tail = (*it)->getTail();
-                    __m128 tailCoordinate = tail->getCoordinates();
-                    if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(tailCoordinate, tailCoordinate))))
+                    tailCoordinate = graphToLogical(tailCoordinate, size, m_viewBound);
+                    headCoordinate = graphToLogical(headCoordinate, size, m_viewBound);
+                    D2D1_ELLIPSE tailArea;
+                    D2D1_ELLIPSE headArea;
+                    if (SUCCEEDED(tailDraw->getArea(tailCoordinate, &tailArea)) &&
+                        SUCCEEDED(headDraw->getArea(headCoordinate, &headArea)))
                     {
-                        const ARBOR vertex* head = (*it)->getHead();
-                        __m128 headCoordinate = head->getCoordinates();
-                        if (0b0011 == (0b0011 & _mm_movemask_ps(_mm_cmpeq_ps(headCoordinate, headCoordinate))))
+                        ATLADD com_ptr<ID2D1SolidColorBrush> brush {};
+                        if (S_OK == it->draw->getBrush(brush.getAddressOf()))
                         {
-                            tailCoordinate = graphToLogical(tailCoordinate, size, viewBound);
-                            headCoordinate = graphToLogical(headCoordinate, size, viewBound);
-                            // Get tail and head ellipses.
-                            auto tailDraw = static_cast<vertex_draw*> (tail->getData());
-                            auto headDraw = static_cast<vertex_draw*> (head->getData());
-                            D2D1_ELLIPSE tailArea;
-                            D2D1_ELLIPSE headArea;
-                            if (SUCCEEDED(tailDraw->getArea(tailCoordinate, &tailArea)) &&
-                                SUCCEEDED(headDraw->getArea(headCoordinate, &headArea)))
-                            {
-                                auto draw = static_cast<edge_draw*> ((*it)->getData());
-                                if (!draw)
-                                {
-                                    draw = new edge_draw {};
-                                    m_edges.emplace_back(draw);
-                                    (*it)->setData(draw);
-                                    draw->createDeviceResources(m_direct2DContext.get(), **it);
-                                }
-                                ATLADD com_ptr<ID2D1SolidColorBrush> brush {};
-                                if (S_OK == draw->getBrush(brush.getAddressOf()))
-                                {
-                                    connectAreas(tailArea, headArea, (*it)->getDirected(), brush.get());
-                                }
-                            }
+                            connectAreas(tailArea, headArea, it->directed, brush.get());
                         }
                     }
                 }
@@ -307,10 +316,19 @@ void graph_window::draw()
     auto durationInMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration);
     auto durationInSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(duration);
     double fps = 1.0 / durationInSeconds.count();
-    int length = _sctprintf(TEXT("%.4f FPS (%I64i µs per frame)"), fps, durationInMicroseconds.count()) + 1;
+    int length = _sctprintf(
+        TEXT("%.4f FPS (%I64i µs per frame, %I64i µs per physics step)"),
+        fps,
+        durationInMicroseconds.count(),
+        m_graph.getStepDuration().count()) + 1;
     STLADD t_char_unique_ptr_t text {new TCHAR[length]};
-    length =
-        _stprintf_s(text.get(), length, TEXT("%.4f FPS (%I64i µs per frame)"), fps, durationInMicroseconds.count());
+    length = _stprintf_s(
+        text.get(),
+        length,
+        TEXT("%.4f FPS (%I64i µs per frame, %I64i µs per physics step)"),
+        fps,
+        durationInMicroseconds.count(),
+        m_graph.getStepDuration().count());
     D2D1_MATRIX_3X2_F transform;
     m_direct2DContext->GetTransform(&transform);
     m_direct2DContext->DrawText(
@@ -320,11 +338,6 @@ void graph_window::draw()
         D2D1::RectF(-transform._31, -transform._32, targetSize.width, targetSize.height),
         m_framesPerSecondBrush.get());
 #endif
-    if (m_graph.active())
-    {
-        m_graph.update(size);
-        Invalidate(FALSE);
-    }
 }
 
 
@@ -338,36 +351,21 @@ void graph_window::draw()
  * N/A.
  *
  * Remarks:
- * This method may create device-independent resources (for example, `IDWriteTextLayout` objects) bound to a vertex or
- * to an edge. But the method does it only once, if an object doesn't have an initialized device-independent resource.
+ * Resources are created for the vertices and edges this window already knows; the ones added to the graph later get
+ * theirs when a frame meets them (see the `updateElements` method). The graph isn't accessed, so no lock is taken.
  */
 void graph_window::createDeviceResources()
 {
-    for (auto it = m_graph.verticesBegin(); m_graph.verticesEnd() != it; ++it)
+    for (auto it = m_vertices.begin(); m_vertices.end() != it; ++it)
     {
-        auto draw = static_cast<vertex_draw*> (it->getData());
-        if (!draw)
+        if (*it)
         {
-            ATLADD com_ptr<IDWriteTextLayout> layout {};
-            if (SUCCEEDED(createTextLayout(it->getName(), layout.getAddressOf())))
-            {
-                draw = new vertex_draw {std::move(layout)};
-                m_vertices.emplace_back(draw);
-                it->setData(draw);
-            }
+            (*it)->createDeviceResources(m_direct2DContext.get());
         }
-        draw->createDeviceResources(m_direct2DContext.get(), *it);
     }
-    for (auto it = m_graph.edgesBegin(); m_graph.edgesEnd() != it; ++it)
+    for (auto it = m_edges.begin(); m_edges.end() != it; ++it)
     {
-        auto draw = static_cast<edge_draw*> ((*it)->getData());
-        if (!draw)
-        {
-            draw = new edge_draw {};
-            m_edges.emplace_back(draw);
-            (*it)->setData(draw);
-        }
-        draw->createDeviceResources(m_direct2DContext.get(), **it);
+        it->draw->createDeviceResources(m_direct2DContext.get());
     }
 #if defined(_DEBUG) || defined(SHOW_FPS)
     m_direct2DContext->CreateSolidColorBrush(
@@ -395,18 +393,90 @@ void graph_window::releaseDeviceResources()
         m_vertices.end(),
         [] (_In_ auto& value) -> void
         {
-            value->releaseDeviceResources();
+            if (value)
+            {
+                value->releaseDeviceResources();
+            }
         });
     std::for_each(
         m_edges.begin(),
         m_edges.end(),
         [] (_In_ auto& value) -> void
         {
-            value->releaseDeviceResources();
+            value.draw->releaseDeviceResources();
         });
 }
 
 
+/**
+ * Creates drawing objects for vertices and edges of the graph that this window doesn't know yet.
+ *
+ * Parameters:
+ * >snapshot
+ * The layout snapshot to be rendered.
+ *
+ * Returns:
+ * N/A.
+ *
+ * Remarks:
+ * The method does nothing if the `snapshot` has no vertex or edge beyond the `m_vertices` and `m_edges`, so usually a
+ * frame doesn't access the graph at all. Otherwise the method tries to obtain _shared_ locks on the graph's vertices
+ * and then on its edges (only this order is allowed; otherwise a deadlock may occur). If a lock is held by another
+ * thread (a physics step is made or the graph is being changed), the method gives up and the new elements are drawn by
+ * one of the next frames, so a frame never waits for the locks. The graph may already have more elements than the
+ * `snapshot`, they're created too; and if the graph has been cleared after the `snapshot` was made, nothing is created.
+ *
+ * A vertex whose text layout can't be created gets no drawing object, so it isn't drawn (and neither are its edges).
+ */
+void graph_window::updateElements(_In_ const ARBOR layout_snapshot& snapshot)
+{
+    if ((snapshot.getVerticesNumber() > m_vertices.size()) || (snapshot.getEdgesNumber() > m_edges.size()))
+    {
+        STLADD lock_guard_shared<WAPI srw_lock> verticesLock {m_graph.getVerticesLock(), std::try_to_lock};
+        if (verticesLock)
+        {
+            STLADD lock_guard_shared<WAPI srw_lock> edgesLock {m_graph.getEdgesLock(), std::try_to_lock};
+            if (edgesLock && (m_graph.getGeneration() == m_generation))
+            {
+                size_t known = m_vertices.size();
+                for (auto it = m_graph.verticesBegin(); m_graph.verticesEnd() != it; ++it)
+                {
+                    size_t id = it->getId();
+                    if (known <= id)
+                    {
+                        if (m_vertices.size() <= id)
+                        {
+                            m_vertices.resize(id + 1);
+                        }
+                        ATLADD com_ptr<IDWriteTextLayout> layout {};
+                        if (SUCCEEDED(createTextLayout(it->getName(), layout.getAddressOf())))
+                        {
+                            m_vertices[id].reset(new vertex_draw {std::move(layout), *it});
+                            m_vertices[id]->createDeviceResources(m_direct2DContext.get());
+                        }
+                    }
+                }
+                size_t index = 0;
+                for (auto it = m_graph.edgesBegin(); m_graph.edgesEnd() != it; ++it, ++index)
+                {
+                    if (m_edges.size() <= index)
+                    {
+                        const ARBOR edge& object = **it;
+                        m_edges.push_back(
+                            edge_item {
+                                object.getTail()->getId(),
+                                object.getHead()->getId(),
+                                object.getDirected(),
+                                std::make_unique<edge_draw>(object)});
+                        m_edges.back().draw->createDeviceResources(m_direct2DContext.get());
+                    }
+                }
+            }
+        }
+    }
+}
+
+
 /**
  * Transforms a point in the Direct2D render target's coordinate space (logical coordinates of the D2D device context)
  * to the graph coordinate space.
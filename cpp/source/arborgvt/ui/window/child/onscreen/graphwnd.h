@@ -26,6 +26,7 @@ public:
         m_graph {},
         m_vertices {},
         m_edges {},
+        m_generation {0},
         m_areaStrokeStyle {},
         m_dpiChangedMessage {dpiChangedMessage}
 #if defined(_DEBUG) || defined(SHOW_FPS)
@@ -37,6 +38,7 @@ public:
         m_framesPerSecondBrush {}
 #endif
     {
+        m_viewBound = ARBOR getZeroVector();
     }
 
     static void* operator new(_In_ const size_t size)
@@ -97,16 +99,40 @@ public:
         return m_graph.addVertex(std::move(name), bkgndColor, textColor, mass, fixed);
     }
 
-    void clear() noexcept
+    void clear()
     {
         m_graph.clear();
-        m_vertices.clear();
-        m_edges.clear();
+    }
+
+    ARBOR simulation_parameters getParameters()
+    {
+        return m_graph.getParameters();
+    }
+
+    bool setParameters(_In_ const ARBOR simulation_parameters& parameters)
+    {
+        return m_graph.setParameters(parameters);
+    }
+
+    HRESULT saveLayout(_In_z_ LPCTSTR fileName)
+    {
+        return m_graph.saveLayout(fileName);
+    }
+
+    HRESULT loadLayout(_In_z_ LPCTSTR fileName)
+    {
+        return m_graph.loadLayout(fileName);
+    }
+
+    void setStateCallbacks(_In_ std::function<void ()>&& startCallback, _In_ std::function<void ()>&& stopCallback)
+    {
+        m_graph.setStateCallbacks(std::move(startCallback), std::move(stopCallback));
     }
 
 
 protected:
     virtual LRESULT createHandler() override;
+    virtual void destroyHandler() override;
     virtual void draw() override;
 
     virtual void createDeviceResources() override;
@@ -117,14 +143,22 @@ private:
     typedef child_window_impl<graph_window> base_class_t;
     typedef std::vector<std::unique_ptr<vertex_draw>, STLADD default_allocator<std::unique_ptr<vertex_draw>>>
         vertices_draw_cont_t;
-    typedef std::vector<std::unique_ptr<edge_draw>, STLADD default_allocator<std::unique_ptr<edge_draw>>>
-        edges_draw_cont_t;
+    // An edge known to the renderer: identifiers of its vertices and its drawing object.
+    struct edge_item
+    {
+        size_t tail;
+        size_t head;
+        bool directed;
+        std::unique_ptr<edge_draw> draw;
+    };
+    typedef std::vector<edge_item, STLADD default_allocator<edge_item>> edges_draw_cont_t;
 
     static __m128 __vectorcall logicalToGraph(
         _In_ const __m128 value, _In_ const __m128 logicalSize, _In_ const __m128 viewBound);
     static __m128 __vectorcall graphToLogical(
         _In_ const __m128 value, _In_ const __m128 logicalSize, _In_ const __m128 viewBound);
 
+    void updateElements(_In_ const ARBOR layout_snapshot& snapshot);
     void scrollHandler(_In_ int bar, _In_ const WORD scrollingRequest, _In_ const WORD position);
     void scrollContent(_In_ int bar, _In_ const int pos);
     HRESULT createTextLayout(
@@ -155,8 +189,15 @@ private:
     static constexpr float m_margin = 100.0f;
 
     ARBOR graph m_graph;
+    // View area of the graph, it's moved toward the graph area of the last snapshot (see the
+    // `ARBOR graph::getNextViewBound` method) by each frame.
+    __m128 m_viewBound;
+    // Drawing objects of the vertices, indexed by a vertex identifier (an element is empty if a text layout of the
+    // vertex can't be created), and of the edges, in order of the graph's edges. Both are of the `m_generation`
+    // generation of the graph.
     vertices_draw_cont_t m_vertices;
     edges_draw_cont_t m_edges;
+    uint32_t m_generation;
     ATLADD com_ptr<ID2D1StrokeStyle1> m_areaStrokeStyle;
     UINT m_dpiChangedMessage;
 